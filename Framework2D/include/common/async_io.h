@@ -0,0 +1,116 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/image.h"
+#include "common/image_io.h"
+#include "common/tiled_image.h"
+
+namespace USTC_CG
+{
+// A load or save running in the background. The UI polls ready() once per
+// frame, shows progress() meanwhile, and calls get() once it is ready.
+template<typename T>
+class IoTask
+{
+   public:
+    IoTask() = default;
+
+    // False before the task is started and after get()
+    bool valid() const
+    {
+        return future_.valid();
+    }
+    bool ready() const
+    {
+        return valid() && future_.wait_for(std::chrono::seconds(0)) ==
+                              std::future_status::ready;
+    }
+    // Fraction done, in [0, 1]
+    float progress() const
+    {
+        return progress_ ? progress_->load() : 0.0f;
+    }
+    const std::string& filename() const
+    {
+        return filename_;
+    }
+    // Blocks until the result is there
+    T get()
+    {
+        return future_.get();
+    }
+
+   private:
+    friend class AsyncImageIO;
+
+    std::future<T> future_;
+    std::shared_ptr<std::atomic<float>> progress_;
+    std::string filename_;
+};
+
+// Loads and saves images off the UI thread.
+//
+// Jobs run on a few threads of their own: they spend most of their time in
+// the serial stb decoder or waiting for the disk, which must not hold the
+// workers of the TileScheduler. The parallel parts of a job (e.g. the strips
+// of a JPG encoding) still go to the TileScheduler when it is idle, and run
+// serially on the job's thread when it is not, so that neither the UI nor a
+// job waits for the other.
+class AsyncImageIO
+{
+   public:
+    explicit AsyncImageIO(int num_threads = 2);
+    // Finishes the queued jobs, so that no save is lost on exit
+    ~AsyncImageIO();
+
+    AsyncImageIO(const AsyncImageIO&) = delete;
+    AsyncImageIO& operator=(const AsyncImageIO&) = delete;
+
+    static AsyncImageIO& instance();
+
+    // Decode a file into an image (see load_image); nullptr on failure.
+    IoTask<std::shared_ptr<Image>> load(
+        const std::string& filename,
+        int channels = 4);
+    // Encode an image (see save_image). The image must not change until the
+    // task is ready: pass a copy of an image being edited.
+    IoTask<bool> save(
+        std::shared_ptr<const Image> image,
+        const std::string& filename,
+        int jpg_quality = 95);
+    // Decode an image file and write it as a tiled image (see
+    // convert_to_tiled()). The task is named after the output.
+    IoTask<bool> convert_to_tiled(
+        const std::string& input,
+        const std::string& output);
+    // Write a tiled image as PNG (see export_png()). Edits written to the
+    // image meanwhile may or may not be in the result.
+    IoTask<bool> export_png(
+        std::shared_ptr<const TiledImage> image,
+        const std::string& filename);
+
+   private:
+    template<typename T>
+    IoTask<T> submit(
+        const std::string& filename,
+        std::function<T(const IoProgress&)> job);
+    void worker_loop();
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<std::function<void()>> jobs_;
+    bool stop_ = false;
+};
+}  // namespace USTC_CG
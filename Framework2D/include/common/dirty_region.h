@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "common/tile.h"
+
+namespace USTC_CG
+{
+// The rectangles of an image changed since the last clear(), so that
+// incremental consumers (e.g. texture uploads) only process those. It has no
+// GL dependency and can be exercised headless.
+//
+// Overlapping or touching rectangles are merged. Beyond kMaxRects, the two
+// rectangles whose bounding box wastes the least area are merged, and once
+// the rectangles cover most of the image they collapse into the whole
+// image, which one upload handles best.
+class DirtyRegion
+{
+   public:
+    static constexpr std::size_t kMaxRects = 8;
+
+    // Track a width x height image, clean.
+    void reset(int width, int height);
+
+    // Mark a rectangle, clipped to the image.
+    void add(Tile rect);
+    // Mark the whole image.
+    void add_all();
+    void clear();
+
+    bool empty() const;
+    // Whether the rectangles cover the whole image
+    bool whole() const;
+    const std::vector<Tile>& rects() const;
+    // Number of pixels covered (the rectangles are disjoint)
+    std::size_t area() const;
+    // Pixels of the image
+    std::size_t total_area() const;
+
+   private:
+    int width_ = 0, height_ = 0;
+    std::vector<Tile> rects_;
+};
+}  // namespace USTC_CG
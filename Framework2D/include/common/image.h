@@ -1,24 +1,41 @@
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
 #include <memory>     // For std::unique_ptr
+#include <span>
 #include <stdexcept>  // For exceptions
 #include <vector>
 
+#include "common/dirty_region.h"
+
 namespace USTC_CG
 {
 class Image
 {
    public:
+    // Memory layout of the pixel data.
+    // - kInterleaved: RGBARGBA... (AoS), the layout expected by OpenGL/stb.
+    // - kPlanar: RRR...GGG...BBB... (SoA), one contiguous plane per channel,
+    //   which lets per-channel kernels stream memory and auto-vectorize.
+    enum Layout
+    {
+        kInterleaved = 0,
+        kPlanar = 1
+    };
+
     Image() = default;
 
     // Constructor with width, height, and channels
-    Image(int width, int height, int channels)
+    Image(int width, int height, int channels, Layout layout = kInterleaved)
         : width_(width),
           height_(height),
           channels_(channels),
-          image_data_(
-              std::make_unique<unsigned char[]>(width * height * channels))
+          layout_(layout),
+          image_data_(std::make_unique<unsigned char[]>(
+              byte_size(width, height, channels)))
     {
+        reset_dirty();
     }
 
     // Constructor with width, height, channels, and external data
@@ -26,12 +43,15 @@ class Image
         int width,
         int height,
         int channels,
-        std::unique_ptr<unsigned char[]> image_data)
+        std::unique_ptr<unsigned char[]> image_data,
+        Layout layout = kInterleaved)
         : width_(width),
           height_(height),
           channels_(channels),
+          layout_(layout),
           image_data_(std::move(image_data))
     {
+        reset_dirty();
     }
 
     // Method to initialize or reinitialize from external data
@@ -39,40 +59,48 @@ class Image
         int width,
         int height,
         int channels,
-        std::unique_ptr<unsigned char[]> image_data)
+        std::unique_ptr<unsigned char[]> image_data,
+        Layout layout = kInterleaved)
     {
         width_ = width;
         height_ = height;
         channels_ = channels;
+        layout_ = layout;
         image_data_ = std::move(image_data);
+        reset_dirty();
     }
 
     Image(const Image& other)
         : width_(other.width_),
           height_(other.height_),
           channels_(other.channels_),
-          image_data_(std::make_unique<unsigned char[]>(
-              other.width_ * other.height_ * other.channels_))
+          layout_(other.layout_),
+          image_data_(std::make_unique<unsigned char[]>(other.size()))
     {
         std::copy(
             other.image_data_.get(),
-            other.image_data_.get() + width_ * height_ * channels_,
+            other.image_data_.get() + other.size(),
             image_data_.get());
+        reset_dirty();
     }
 
     Image& operator=(const Image& other)
     {
         if (this != &other)
         {
+            // Reuse the buffer when the size does not change, so repeated
+            // restores (e.g. from a back-up image) do not hit the allocator.
+            if (size() != other.size() || !image_data_)
+                image_data_ = std::make_unique<unsigned char[]>(other.size());
             width_ = other.width_;
             height_ = other.height_;
             channels_ = other.channels_;
-            image_data_ =
-                std::make_unique<unsigned char[]>(width_ * height_ * channels_);
+            layout_ = other.layout_;
             std::copy(
                 other.image_data_.get(),
-                other.image_data_.get() + width_ * height_ * channels_,
+                other.image_data_.get() + other.size(),
                 image_data_.get());
+            reset_dirty();
         }
         return *this;
     }
@@ -95,12 +123,157 @@ class Image
     {
         return channels_;
     }
+    Layout layout() const
+    {
+        return layout_;
+    }
+
+    // Total number of bytes of the pixel data.
+    std::size_t size() const
+    {
+        return byte_size(width_, height_, channels_);
+    }
 
     unsigned char* data() const
     {
         return image_data_.get();
     }
 
+    // Distance (in bytes) between two horizontally adjacent pixels of the
+    // same channel: `channels()` when interleaved, 1 when planar.
+    std::size_t pixel_stride() const
+    {
+        return layout_ == kInterleaved ? static_cast<std::size_t>(channels_)
+                                       : 1;
+    }
+    // Distance (in bytes) between two channels of the same pixel: 1 when
+    // interleaved, one whole plane when planar.
+    std::size_t channel_stride() const
+    {
+        return layout_ == kInterleaved ? 1 : plane_size();
+    }
+    // Number of bytes in one row of an interleaved image, or in one row of a
+    // single plane of a planar image.
+    std::size_t row_stride() const
+    {
+        return static_cast<std::size_t>(width_) * pixel_stride();
+    }
+
+    // Non-allocating views. All of them are bounds checked once per call, so
+    // a kernel pays for the check per row rather than per pixel.
+
+    // The y-th row of an interleaved image (width * channels bytes).
+    std::span<unsigned char> row(int y)
+    {
+        check_row(y);
+        require_layout(kInterleaved);
+        return { image_data_.get() + y * row_stride(), row_stride() };
+    }
+    std::span<const unsigned char> row(int y) const
+    {
+        check_row(y);
+        require_layout(kInterleaved);
+        return { image_data_.get() + y * row_stride(), row_stride() };
+    }
+
+    // The whole plane of one channel in a planar image (width * height bytes).
+    std::span<unsigned char> plane(int channel)
+    {
+        check_channel(channel);
+        require_layout(kPlanar);
+        return { image_data_.get() + channel * plane_size(), plane_size() };
+    }
+    std::span<const unsigned char> plane(int channel) const
+    {
+        check_channel(channel);
+        require_layout(kPlanar);
+        return { image_data_.get() + channel * plane_size(), plane_size() };
+    }
+
+    // The y-th row of one channel plane in a planar image (width bytes).
+    std::span<unsigned char> plane_row(int channel, int y)
+    {
+        check_row(y);
+        return plane(channel).subspan(y * row_stride(), row_stride());
+    }
+    std::span<const unsigned char> plane_row(int channel, int y) const
+    {
+        check_row(y);
+        return plane(channel).subspan(y * row_stride(), row_stride());
+    }
+
+    // The channel values of pixel (x, y) in an interleaved image.
+    std::span<unsigned char> pixel_span(int x, int y)
+    {
+        check_pixel(x, y);
+        require_layout(kInterleaved);
+        return { pixel_unchecked(x, y), static_cast<std::size_t>(channels_) };
+    }
+    std::span<const unsigned char> pixel_span(int x, int y) const
+    {
+        check_pixel(x, y);
+        require_layout(kInterleaved);
+        return { pixel_unchecked(x, y), static_cast<std::size_t>(channels_) };
+    }
+
+    // Unchecked fast path: no bounds check, no allocation, no exception. The
+    // caller guarantees 0 <= x < width, 0 <= y < height, 0 <= c < channels.
+    // Works for both layouts.
+    unsigned char* pixel_unchecked(int x, int y) const
+    {
+        return image_data_.get() + pixel_offset(x, y);
+    }
+    unsigned char& at_unchecked(int x, int y, int channel) const
+    {
+        return image_data_[pixel_offset(x, y) + channel * channel_stride()];
+    }
+
+    // Convert the pixel data to another layout (no-op if already in it).
+    void convert_layout(Layout layout)
+    {
+        if (layout == layout_ || !image_data_)
+            return;
+        auto converted = std::make_unique<unsigned char[]>(size());
+        const std::size_t pixels = plane_size();
+        const std::size_t channels = static_cast<std::size_t>(channels_);
+        const unsigned char* src = image_data_.get();
+        unsigned char* dst = converted.get();
+        for (std::size_t c = 0; c < channels; ++c)
+        {
+            if (layout == kPlanar)
+                for (std::size_t i = 0; i < pixels; ++i)
+                    dst[c * pixels + i] = src[i * channels + c];
+            else
+                for (std::size_t i = 0; i < pixels; ++i)
+                    dst[i * channels + c] = src[c * pixels + i];
+        }
+        image_data_ = std::move(converted);
+        layout_ = layout;
+    }
+
+    // Areas changed since the last clear_dirty(), for consumers that update
+    // incrementally (e.g. the texture of an ImageWidget). New, initialized
+    // and assigned images are all dirty; code writing part of the pixels
+    // marks the rectangle it wrote.
+    void mark_dirty(const Tile& rect)
+    {
+        dirty_.add(rect);
+    }
+    void mark_dirty()
+    {
+        dirty_.add_all();
+    }
+    const DirtyRegion& dirty() const
+    {
+        return dirty_;
+    }
+    void clear_dirty()
+    {
+        dirty_.clear();
+    }
+
+    // Compatibility shim: allocates and bounds checks on every call, prefer
+    // the span views or the unchecked accessors in whole-image loops.
     std::vector<unsigned char> get_pixel(int x, int y) const
     {
         if (x < 0 || x >= width_ || y < 0 || y >= height_)
@@ -108,13 +281,9 @@ class Image
             throw std::out_of_range("Pixel coordinates out of bounds");
         }
         std::vector<unsigned char> pixelValues(channels_);
-        std::size_t index =
-            static_cast<std::size_t>(y) * static_cast<std::size_t>(width_) +
-            static_cast<std::size_t>(x);
-        index *= static_cast<std::size_t>(channels_);
         for (int channel = 0; channel < channels_; ++channel)
         {
-            pixelValues[channel] = image_data_[index + channel];
+            pixelValues[channel] = at_unchecked(x, y, channel);
         }
         return pixelValues;
     }
@@ -126,26 +295,74 @@ class Image
             throw std::out_of_range("Pixel coordinates out of bounds");
         }
         // Allow 3 channel input when channels.size()==4 (RGB -> RGBA)
-        size_t channels_reset = channels_;
-        if (values.size() == 3 && static_cast<size_t>(channels_) == 4)
+        int channels_reset = channels_;
+        if (values.size() == 3 && channels_ == 4)
             channels_reset = 3;
         else if (values.size() != static_cast<size_t>(channels_))
         {
             throw std::invalid_argument(
                 "Number of values does not match the number of channels");
         }
-        std::size_t index =
-            static_cast<std::size_t>(y) * static_cast<std::size_t>(width_) +
-            static_cast<std::size_t>(x);
-        index *= static_cast<std::size_t>(channels_);
         for (int channel = 0; channel < channels_reset; ++channel)
         {
-            image_data_[index + channel] = values[channel];
+            at_unchecked(x, y, channel) = values[channel];
         }
     }
 
    private:
+    static std::size_t byte_size(int width, int height, int channels)
+    {
+        return static_cast<std::size_t>(width) *
+               static_cast<std::size_t>(height) *
+               static_cast<std::size_t>(channels);
+    }
+
+    std::size_t plane_size() const
+    {
+        return static_cast<std::size_t>(width_) *
+               static_cast<std::size_t>(height_);
+    }
+
+    std::size_t pixel_offset(int x, int y) const
+    {
+        return (static_cast<std::size_t>(y) * static_cast<std::size_t>(width_) +
+                static_cast<std::size_t>(x)) *
+               pixel_stride();
+    }
+
+    void check_row(int y) const
+    {
+        if (y < 0 || y >= height_)
+            throw std::out_of_range("Row index out of bounds");
+    }
+
+    void check_channel(int channel) const
+    {
+        if (channel < 0 || channel >= channels_)
+            throw std::out_of_range("Channel index out of bounds");
+    }
+
+    void check_pixel(int x, int y) const
+    {
+        if (x < 0 || x >= width_ || y < 0 || y >= height_)
+            throw std::out_of_range("Pixel coordinates out of bounds");
+    }
+
+    void reset_dirty()
+    {
+        dirty_.reset(width_, height_);
+        dirty_.add_all();
+    }
+
+    void require_layout(Layout layout) const
+    {
+        if (layout_ != layout)
+            throw std::logic_error("Accessor does not match the image layout");
+    }
+
     int width_ = 0, height_ = 0, channels_ = 0;
+    Layout layout_ = kInterleaved;
     std::unique_ptr<unsigned char[]> image_data_;
+    DirtyRegion dirty_;
 };
 }  // namespace USTC_CG
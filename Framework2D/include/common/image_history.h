@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "common/image.h"
+#include "common/tile.h"
+
+namespace USTC_CG
+{
+// Undo history of an image, as copy-on-write tiles.
+//
+// Each step is a grid of shared pointers to kTileSize x kTileSize blocks of
+// pixels. Committing a step copies only the tiles of the changed rectangle,
+// and even those are shared with the previous step when their pixels are
+// equal, so a deep history costs the edited tiles, not full images. Moving
+// between steps compares tile pointers and writes back only the tiles that
+// differ; restoring a rectangle (e.g. to discard a preview drawn over the
+// current step) costs the size of the rectangle.
+class ImageHistory
+{
+   public:
+    static constexpr int kTileSize = 64;
+
+    // Start the history with `image` as its only step.
+    void reset(const Image& image);
+
+    // Record the pixels of `image` in `changed` (clipped to the image) as a
+    // new step after the current one, dropping the steps that could be
+    // redone; nothing is recorded if these pixels did not change. The rest
+    // of the image must equal the current step.
+    void commit(const Image& image, const Tile& changed);
+    // Same, for an edit that may have changed any pixel.
+    void commit(const Image& image);
+
+    // Write the current step over `rect` of `image`.
+    void restore(Image& image, const Tile& rect) const;
+
+    bool can_undo() const;
+    bool can_redo() const;
+    // Move to the previous or next step, updating `image` (which must equal
+    // the current step) and marking the tiles written dirty.
+    bool undo(Image& image);
+    bool redo(Image& image);
+    void go_to(Image& image, std::size_t step);
+    std::size_t step() const;
+    std::size_t num_steps() const;
+
+    // Oldest steps are dropped beyond this number (64 by default)
+    void set_max_steps(std::size_t max_steps);
+    // Bytes of the distinct tiles held by all the steps
+    std::size_t memory() const;
+
+   private:
+    using TileData = std::shared_ptr<const std::vector<unsigned char>>;
+    using Step = std::vector<TileData>;
+
+    Tile tile_rect(std::size_t t) const;
+    // Pixels of `rect` (inside tile t) from the image to a tile buffer, or
+    // the other way around
+    void read(const Image& image, std::size_t t, std::vector<unsigned char>&)
+        const;
+    void write(
+        Image& image,
+        std::size_t t,
+        const std::vector<unsigned char>& data,
+        const Tile& rect) const;
+
+    int width_ = 0, height_ = 0;
+    int tiles_x_ = 0, tiles_y_ = 0;
+    std::vector<Step> steps_;
+    std::size_t current_ = 0;
+    std::size_t max_steps_ = 64;
+};
+}  // namespace USTC_CG
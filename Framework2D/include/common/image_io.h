@@ -0,0 +1,41 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "common/image.h"
+
+namespace USTC_CG
+{
+// Receives the fraction of a load or save done so far, in [0, 1]. It may be
+// called from worker threads.
+using IoProgress = std::function<void(float)>;
+
+// Whether the file is a tiled image (.uti, see TiledImage), by its extension
+bool is_tiled_image(const std::string& filename);
+
+// Decode an image file (png, jpg, bmp, tga, ...) with stb_image, forcing
+// `channels` channels; tiled images are read whole and must have that many
+// channels (ImageWidget instead keeps them on disk and reads the part in
+// view). Returns nullptr if the file cannot be decoded. The progress follows
+// the bytes read from the file.
+std::shared_ptr<Image> load_image(
+    const std::string& filename,
+    int channels = 4,
+    const IoProgress& progress = nullptr);
+
+// Encode an image with stb_image_write. The format is chosen by the file
+// extension (.png, .jpg/.jpeg, .bmp, .tga, .uti for a tiled image), falling
+// back to PNG. Returns false on failure.
+//
+// JPG images are encoded by horizontal strips in parallel: each strip is an
+// independent stb scan, and the strips are joined with restart markers into
+// one baseline JPEG that every decoder reads. The progress follows the
+// strips; the other formats report it once done.
+bool save_image(
+    const Image& image,
+    const std::string& filename,
+    int jpg_quality = 95,
+    const IoProgress& progress = nullptr);
+}  // namespace USTC_CG
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <array>
+
+#include "common/image.h"
+
+namespace USTC_CG
+{
+// Whole-image kernels working in place, row-major, without per-pixel
+// allocation. Interleaved 4-channel images take the SIMD paths (SSE2/AVX2,
+// chosen at runtime); every other format falls back to plain loops which the
+// compiler is free to auto-vectorize.
+namespace image_ops
+{
+// Instruction set used by the kernels.
+enum SimdLevel
+{
+    kScalar = 0,
+    kSSE2 = 1,
+    kAVX2 = 2,
+};
+
+// The best level supported by the running CPU.
+SimdLevel detect_simd_level();
+// The level currently used by the kernels (defaults to detect_simd_level()).
+SimdLevel simd_level();
+// Force a level, e.g. to compare kernels in a benchmark. Levels above the
+// detected one are clamped.
+void set_simd_level(SimdLevel level);
+const char* simd_level_name(SimdLevel level);
+
+// Invert the color channels (the alpha channel of RGBA images is kept).
+void invert(Image& image);
+
+// Mirror the image. `is_horizontal` flips left/right (x -> width - 1 - x),
+// `is_vertical` flips top/bottom (y -> height - 1 - y).
+void mirror(Image& image, bool is_horizontal, bool is_vertical);
+
+// Replace the color channels with the Rec.601 luminance
+// Y = (77 R + 150 G + 29 B) / 256. Alpha is kept.
+void gray_scale(Image& image);
+
+// Reorder channels: output channel c takes the value of input channel
+// order[c], e.g. { 2, 1, 0, 3 } converts RGBA <-> BGRA. Only the first
+// `channels()` entries are used.
+void swizzle(Image& image, const std::array<int, 4>& order);
+}  // namespace image_ops
+}  // namespace USTC_CG
@@ -8,18 +8,33 @@
 #include <vector>
 
 #include "imgui.h"
+#include "common/async_io.h"
 #include "common/image.h"
+#include "common/tiled_image.h"
 #include "common/widget.h"
 
 namespace USTC_CG
 {
 
 // Represents an image component that can be rendered within a GUI.
+//
+// Tiled images (.uti, see TiledImage) are not read whole: data_ holds the
+// part of the file in view, which is read again when the view moves (drag
+// with the middle mouse button) or is resized (fit_view()), and update()
+// writes the edited rectangles of the view back to the file. The size, the
+// pixels and the positions seen by subclasses are those of the view.
 class ImageWidget : public Widget
 {
    public:
     // Constructs an Image component with a given label and image file.
-    explicit ImageWidget(const std::string& label, const std::string& filename);
+    // `data` holds the pixels of the file when they were already decoded
+    // (e.g. by AsyncImageIO), the file is read otherwise; a tiled image is
+    // opened writable if possible, read-only otherwise (its edits are then
+    // lost when the view moves).
+    explicit ImageWidget(
+        const std::string& label,
+        const std::string& filename,
+        std::shared_ptr<Image> data = nullptr);
     virtual ~ImageWidget();  // Destructor to manage resources.
 
     // Renders the image component.
@@ -31,9 +46,31 @@ class ImageWidget : public Widget
     // Retrieves the size (width, height) of the loaded image.
     ImVec2 get_image_size() const;
 
+    // Bytes sent to the texture by the last update(), and the bytes saved
+    // compared to uploading the whole image
+    struct UploadStats
+    {
+        std::size_t uploaded_bytes = 0;
+        std::size_t saved_bytes = 0;
+    };
+
+    // Refresh the texture: only the dirty rectangles of the image when some
+    // were marked, the whole image otherwise. For a tiled image, the same
+    // rectangles are written back to the file first.
     void update();
+    const UploadStats& last_upload() const;
+
+    // Save in the background. The image is copied first, so editing can go
+    // on meanwhile. A tiled image is exported whole, as PNG (the extension
+    // of `filename` is replaced by .png).
+    IoTask<bool> save_to_disk(const std::string& filename);
 
-    void save_to_disk(const std::string& filename);
+    bool is_tiled() const;
+    // The rectangle of a tiled image in view
+    const Tile& view() const;
+    // Resize the view of a tiled image to `size` (e.g. the room left in the
+    // window), within the image. Does nothing for other images.
+    void fit_view(const ImVec2& size);
 
    private:
     // Draws the loaded image.
@@ -41,11 +78,38 @@ class ImageWidget : public Widget
 
     // Loads the image file into OpenGL texture memory.
     void load_gltexture();
+    // Uploads the dirty rectangles of the image into the texture.
+    void update_gltexture();
+
+    // Tiled images: open the file and read the initial view
+    void open_tiled(const std::string& filename);
+    // Move the view to `rect` (shifted into the image) and read it
+    void set_view(const Tile& rect);
+    // Middle mouse drags move the view
+    void pan_view();
+    // Write the dirty rectangles of the view to the file
+    void write_back();
+
+    std::shared_ptr<TiledImage> tiled_;
+    Tile view_;
+    // Mouse motion not yet turned into whole pixels of panning
+    ImVec2 pan_ = ImVec2(0.0f, 0.0f);
+    bool panning_ = false;
 
    protected:
+    // Called once a new view of a tiled image replaced the pixels of data_
+    // (same object, maybe another size), for subclasses to drop the state
+    // tied to the previous ones.
+    virtual void view_changed()
+    {
+    }
+
     std::string filename_;                 // Path to the image file.
     std::shared_ptr<Image> data_;          // Raw pixel data of the image.
     GLuint tex_id_ = 0;                    // OpenGL texture identifier.
+    // Size of the texture storage, to know when sub-uploads are valid
+    int tex_width_ = 0, tex_height_ = 0, tex_channels_ = 0;
+    UploadStats last_upload_;
 
     ImVec2 position_ = ImVec2(0.0f, 0.0f);  // Position of the image in the GUI.
     int image_width_ = 0, image_height_ = 0;  // Dimensions of the loaded image.
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace USTC_CG
+{
+// A whole file mapped into memory (mmap, or a file mapping on Windows).
+//
+// Pages are read by the OS on first access and evicted under memory
+// pressure, so a reader only pays, in I/O and resident memory, for the bytes
+// it touches. A writable mapping writes through to the file.
+class MappedFile
+{
+   public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    // Map an existing, non-empty file. Returns false on failure.
+    bool open(const std::string& filename, bool writable = false);
+    void close();
+
+    bool is_open() const
+    {
+        return data_ != nullptr;
+    }
+    bool writable() const
+    {
+        return writable_;
+    }
+    unsigned char* data() const
+    {
+        return data_;
+    }
+    std::size_t size() const
+    {
+        return size_;
+    }
+
+   private:
+    void swap(MappedFile& other) noexcept;
+
+    unsigned char* data_ = nullptr;
+    std::size_t size_ = 0;
+    bool writable_ = false;
+#ifdef _WIN32
+    void* file_ = nullptr;
+    void* mapping_ = nullptr;
+#else
+    int file_ = -1;
+#endif
+};
+}  // namespace USTC_CG
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace USTC_CG
+{
+// Streaming PNG encoder: rows are written as they are produced, so an image
+// of any size is saved with O(row) memory.
+//
+// The pixels are stored in uncompressed deflate blocks (every decoder reads
+// them), which trades file size for a constant, tiny cost per byte; use
+// save_image() for images that fit in memory and should be compressed.
+class PngWriter
+{
+   public:
+    PngWriter() = default;
+    // Finishes the file if close() was not called
+    ~PngWriter();
+
+    PngWriter(const PngWriter&) = delete;
+    PngWriter& operator=(const PngWriter&) = delete;
+
+    // Start a width x height image of 1 (gray), 2 (gray, alpha), 3 (RGB) or
+    // 4 (RGBA) channels. Returns false on failure.
+    bool open(
+        const std::string& filename,
+        int width,
+        int height,
+        int channels);
+    // Append the next rows, top to bottom, interleaved (width * channels
+    // bytes each, consecutive).
+    bool write_rows(const unsigned char* rows, int count = 1);
+    // Write the end of the file. Returns false if a row is missing or any
+    // write failed.
+    bool close();
+
+    bool is_open() const
+    {
+        return file_ != nullptr;
+    }
+
+   private:
+    // Emit the pending bytes as one stored block, in its own IDAT chunk
+    void flush_block();
+    void write_chunk(
+        const char* type,
+        const unsigned char* data,
+        std::size_t size);
+
+    std::FILE* file_ = nullptr;
+    bool ok_ = false;
+    std::size_t row_size_ = 0;
+    int height_ = 0, rows_ = 0;
+    // Bytes of the zlib stream (filter byte + row) not emitted yet, and how
+    // many remain after them
+    std::vector<unsigned char> block_;
+    std::uint64_t remaining_ = 0;
+    bool first_block_ = true;
+    std::uint32_t adler_a_ = 1, adler_b_ = 0;
+};
+}  // namespace USTC_CG
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace USTC_CG
+{
+// Timings of named zones (a frame, a warp, a clone, a texture upload...),
+// recorded by ScopedTimer.
+//
+// Each zone keeps its last kHistory samples in a fixed ring buffer, so
+// recording never allocates and the memory does not grow with the run
+// time. Zones can be recorded from any thread. stats() summarizes a zone
+// and write_chrome_trace() dumps all the samples for chrome://tracing or
+// Perfetto.
+class Profiler
+{
+   public:
+    using Clock = std::chrono::steady_clock;
+    static constexpr std::size_t kHistory = 512;
+
+    struct Sample
+    {
+        // Microseconds since the profiler started
+        double start = 0, duration = 0;
+        std::uint32_t thread = 0;
+    };
+    // Milliseconds, over the samples in the ring buffer
+    struct Stats
+    {
+        std::size_t count = 0;
+        double last = 0, mean = 0, max = 0;
+        double p50 = 0, p95 = 0, p99 = 0;
+    };
+
+    static Profiler& instance();
+
+    // Recording is on by default; when off, timers cost a branch.
+    void set_enabled(bool enabled);
+    bool enabled() const;
+
+    // Index of the zone `name`, created on first use. Indices are stable.
+    int zone(const std::string& name);
+    void record(int zone, Clock::time_point start, Clock::time_point end);
+
+    // Zones in creation order
+    std::size_t num_zones() const;
+    std::string zone_name(int zone) const;
+    Stats stats(int zone) const;
+    // Durations in milliseconds, oldest first (e.g. for a plot)
+    std::vector<float> history(int zone) const;
+    // Forget all the samples, keep the zones
+    void clear();
+
+    // Write every sample as a complete event of the Chrome trace format.
+    bool write_chrome_trace(const std::string& filename) const;
+
+   private:
+    struct Zone
+    {
+        std::string name;
+        mutable std::mutex mutex;
+        std::array<Sample, kHistory> samples;
+        // Samples recorded so far; the ring holds the last kHistory of them
+        std::size_t count = 0;
+    };
+
+    Profiler();
+    Zone& zone_at(int zone) const;
+    std::vector<Sample> samples(const Zone& zone) const;
+
+    const Clock::time_point epoch_;
+    std::atomic<bool> enabled_ = true;
+    mutable std::mutex mutex_;  // guards the list of zones
+    std::vector<std::unique_ptr<Zone>> zones_;
+    std::unordered_map<std::string, int> index_;
+};
+
+// Records the time from its construction to its destruction in a zone.
+//
+//     void WarpingWidget::warping()
+//     {
+//         ScopedTimer timer("warping");
+//         ...
+//     }
+class ScopedTimer
+{
+   public:
+    explicit ScopedTimer(const std::string& zone);
+    explicit ScopedTimer(int zone);
+    ~ScopedTimer();
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+   private:
+    int zone_ = -1;
+    Profiler::Clock::time_point start_;
+};
+}  // namespace USTC_CG
@@ -0,0 +1,23 @@
+#pragma once
+
+namespace USTC_CG
+{
+// A rectangular block of pixels [x0, x1) x [y0, y1).
+struct Tile
+{
+    int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+
+    int width() const
+    {
+        return x1 - x0;
+    }
+    int height() const
+    {
+        return y1 - y0;
+    }
+    bool empty() const
+    {
+        return x1 <= x0 || y1 <= y0;
+    }
+};
+}  // namespace USTC_CG
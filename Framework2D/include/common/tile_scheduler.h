@@ -0,0 +1,109 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "common/tile.h"
+
+namespace USTC_CG
+{
+// A small work-stealing thread pool that runs per-pixel work over an image
+// split into square tiles.
+//
+// Every tile is handed to exactly one invocation of the functor, so as long
+// as the functor only writes the pixels of its own tile (or, more generally,
+// writes that do not depend on which thread runs which tile), the output is
+// bit-identical to a serial run regardless of scheduling.
+class TileScheduler
+{
+   public:
+    static constexpr int kDefaultTileSize = 64;
+
+    // num_threads == 0 uses one thread per hardware core (the calling thread
+    // counts as one of them).
+    explicit TileScheduler(int num_threads = 0);
+    ~TileScheduler();
+
+    TileScheduler(const TileScheduler&) = delete;
+    TileScheduler& operator=(const TileScheduler&) = delete;
+
+    // Process-wide scheduler sized to the core count.
+    static TileScheduler& instance();
+
+    int num_threads() const
+    {
+        return static_cast<int>(workers_.size()) + 1;
+    }
+
+    // Run `fn(tile)` for every tile covering a width x height image and wait
+    // for completion. Calls made from inside a running task, or while another
+    // thread runs a job on the pool, execute serially on the calling thread.
+    void parallel_for_tiles(
+        int width,
+        int height,
+        const std::function<void(const Tile&)>& fn,
+        int tile_size = kDefaultTileSize);
+
+    // Run `fn(begin, end)` over [0, count) split into chunks of `grain`.
+    void parallel_for(
+        std::size_t count,
+        const std::function<void(std::size_t, std::size_t)>& fn,
+        std::size_t grain = 4096);
+
+    // Convenience wrapper: `fn(x, y)` for every pixel, tile by tile, row-major
+    // inside each tile.
+    template<typename Fn>
+    void for_each_pixel(int width, int height, Fn&& fn)
+    {
+        parallel_for_tiles(
+            width,
+            height,
+            [&fn](const Tile& tile)
+            {
+                for (int y = tile.y0; y < tile.y1; ++y)
+                    for (int x = tile.x0; x < tile.x1; ++x)
+                        fn(x, y);
+            });
+    }
+
+   private:
+    // Per-thread queue of task indices. The owner pops from the front, idle
+    // threads steal from the back.
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<std::size_t> tasks;
+    };
+
+    // Run `task(i)` for i in [0, count), blocking until all are done.
+    void run(std::size_t count, const std::function<void(std::size_t)>& task);
+    void worker_loop(int index);
+    // Drain the own queue, then steal from the others. Returns when no task
+    // is left anywhere.
+    void work(int index);
+    bool pop(int index, std::size_t& task);
+    bool steal(int thief, std::size_t& task);
+
+    std::vector<std::thread> workers_;
+    std::vector<std::unique_ptr<Queue>> queues_;  // one per thread
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    std::mutex run_mutex_;  // held by the caller whose job is on the pool
+    const std::function<void(std::size_t)>* task_ = nullptr;
+    std::size_t generation_ = 0;
+    std::size_t pending_ = 0;  // tasks not finished yet
+    int active_workers_ = 0;   // workers inside work() for this generation
+    std::exception_ptr error_;  // first exception thrown by a task
+    bool stop_ = false;
+};
+}  // namespace USTC_CG
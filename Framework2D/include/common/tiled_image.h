@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <string>
+
+#include "common/image.h"
+#include "common/image_io.h"
+#include "common/mapped_file.h"
+#include "common/tile.h"
+
+namespace USTC_CG
+{
+// An image stored on disk as square tiles (.uti files) and accessed through
+// a memory mapping, for images far larger than RAM (e.g. 30k x 30k mosaics).
+//
+// File layout (little endian):
+//   header  "UTI1", then width, height, channels and tile size as uint32,
+//           padded to kHeaderSize bytes
+//   tiles   row by row, each tile_size x tile_size interleaved pixels; the
+//           tiles on the right and bottom borders are padded
+// Tiles sit at fixed offsets and are not compressed, so reading one is a
+// pointer into the mapping: only the tiles a view or an edit touches are
+// ever paged in. read() turns any rectangle into an ordinary Image, and
+// write() puts an edited Image back.
+class TiledImage
+{
+   public:
+    static constexpr int kDefaultTileSize = 256;
+    static constexpr std::size_t kHeaderSize = 64;
+
+    // Create a file for a width x height image (black, the disk space is
+    // allocated lazily where supported) and open it writable.
+    bool create(
+        const std::string& filename,
+        int width,
+        int height,
+        int channels,
+        int tile_size = kDefaultTileSize);
+    // Open an existing file. Returns false if it is not a valid tiled image.
+    bool open(const std::string& filename, bool writable = false);
+    void close();
+
+    bool is_open() const
+    {
+        return file_.is_open();
+    }
+    bool writable() const
+    {
+        return file_.writable();
+    }
+    int width() const
+    {
+        return width_;
+    }
+    int height() const
+    {
+        return height_;
+    }
+    int channels() const
+    {
+        return channels_;
+    }
+    int tile_size() const
+    {
+        return tile_size_;
+    }
+    int tiles_x() const
+    {
+        return tiles_x_;
+    }
+    int tiles_y() const
+    {
+        return tiles_y_;
+    }
+
+    // Pixels of tile (tx, ty) covered by the image
+    Tile tile_rect(int tx, int ty) const;
+    // The tile in the mapping: tile_size rows of tile_size * channels bytes
+    std::span<const unsigned char> tile(int tx, int ty) const;
+    std::span<unsigned char> tile(int tx, int ty);
+
+    // Copy `rect` (clipped to the image) into a new image.
+    Image read(
+        const Tile& rect,
+        Image::Layout layout = Image::kInterleaved) const;
+    // Copy rows [y0, y1) into `rows`, width * channels bytes each.
+    void read_rows(int y0, int y1, unsigned char* rows) const;
+    // Write `image` (same number of channels) with its top-left pixel at
+    // (x, y), clipped to the image. Returns false if the file is read-only.
+    bool write(const Image& image, int x, int y);
+    // Same, from width x height interleaved pixels in rows `row_bytes`
+    // apart (0: consecutive rows), e.g. a rectangle of a larger image.
+    bool write(
+        const unsigned char* pixels,
+        int width,
+        int height,
+        int x,
+        int y,
+        std::size_t row_bytes = 0);
+
+   private:
+    std::size_t tile_bytes() const;
+
+    MappedFile file_;
+    int width_ = 0, height_ = 0, channels_ = 0;
+    int tile_size_ = 0, tiles_x_ = 0, tiles_y_ = 0;
+};
+
+// Decode an image file (png, jpg, ...) and write it as a tiled image. The
+// decoder needs the whole source in memory once; later edits do not.
+bool convert_to_tiled(
+    const std::string& input,
+    const std::string& output,
+    int channels = 4,
+    int tile_size = TiledImage::kDefaultTileSize);
+
+// Write a tiled image as PNG, one row of tiles at a time (see PngWriter).
+// The progress follows the rows of tiles.
+bool export_png(
+    const TiledImage& image,
+    const std::string& output,
+    const IoProgress& progress = nullptr);
+}  // namespace USTC_CG
@@ -3,8 +3,13 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+#include <exception>
+#include <iostream>
 #include <string>
 
+#include "common/async_io.h"
+#include "common/profiler.h"
+
 namespace USTC_CG
 {
 
@@ -39,10 +44,48 @@ class Window
     // Handles the rendering of each frame.
     void render();
 
+    // Overlay of the Profiler (toggled with F3): frame time, the zones
+    // recorded by ScopedTimer and their percentiles, and a button to dump
+    // them as a Chrome trace.
+    void draw_profiler();
+
+    // One line of a file panel: what is done to which file, and how far.
+    static void
+    draw_progress(const char* action, const std::string& filename, float done);
+    // The result of a ready I/O task. An exception thrown by its job (e.g.
+    // out of memory on a huge image) is printed and gives `failed` instead,
+    // rather than leaving the frame.
+    template<typename T>
+    static T take_result(IoTask<T>& task, T failed = T{});
+
     std::string name_;              // Name (title) of the window.
     GLFWwindow* window_ = nullptr;  // Pointer to the GLFW window.
     int width_ = 1280;              // Width of the window.
     int height_ = 720;              // Height of the window.
+
+    bool show_profiler_ = false;
+    // Start of the previous frame: the frame time is the interval between
+    // two frames, waits for vsync and events included
+    Profiler::Clock::time_point frame_start_;
+    std::string trace_status_;
 };
 
+template<typename T>
+T Window::take_result(IoTask<T>& task, T failed)
+{
+    try
+    {
+        return task.get();
+    }
+    catch (const std::exception& e)
+    {
+        std::cout << "Error on file " << task.filename() << ": " << e.what()
+                  << std::endl;
+    }
+    catch (...)
+    {
+        std::cout << "Error on file " << task.filename() << std::endl;
+    }
+    return failed;
+}
 }  // namespace USTC_CG
@@ -1,17 +1,33 @@
 #include "canvas_widget.h"
 
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 
+#include "common/profiler.h"
 #include "imgui.h"
+#include "shapes/ellipse.h"
+#include "shapes/freehand.h"
 #include "shapes/line.h"
 #include "shapes/rect.h"
 
 namespace USTC_CG
 {
+namespace
+{
+constexpr float kMinZoom = 1.0f / 4096;
+constexpr float kMaxZoom = 256.0f;
+// Zoom factor of a wheel notch
+constexpr float kZoomStep = 1.2f;
+// Distances on the screen, in pixels
+constexpr float kPickPixels = 3.0f;
+constexpr float kStrokeTolerancePixels = 0.5f;
+}  // namespace
+
 void Canvas::draw()
 {
     draw_background();
+    update_view();
     // HW1_TODO: more interaction events
     if (is_hovered_ && ImGui::IsMouseClicked(ImGuiMouseButton_Left))
         mouse_click_event();
@@ -36,6 +52,17 @@ void Canvas::show_background(bool flag)
     show_background_ = flag;
 }
 
+void Canvas::reset_view()
+{
+    pan_ = ImVec2(0.f, 0.f);
+    zoom_ = 1.0f;
+}
+
+float Canvas::zoom() const
+{
+    return zoom_;
+}
+
 void Canvas::set_default()
 {
     draw_status_ = false;
@@ -54,11 +81,34 @@ void Canvas::set_rect()
     shape_type_ = kRect;
 }
 
+void Canvas::set_ellipse()
+{
+    draw_status_ = false;
+    shape_type_ = kEllipse;
+}
+
+void Canvas::set_freehand()
+{
+    draw_status_ = false;
+    shape_type_ = kFreehand;
+}
+
 // HW1_TODO: more shape types, implements
 
 void Canvas::clear_shape_list()
 {
-    shape_list_.clear();
+    scene_.clear();
+    hovered_shape_ = {};
+}
+
+Scene& Canvas::scene()
+{
+    return scene_;
+}
+
+const Scene& Canvas::scene() const
+{
+    return scene_;
 }
 
 void Canvas::draw_background()
@@ -74,22 +124,51 @@ void Canvas::draw_background()
     /// Invisible button over the canvas to capture mouse interactions.
     ImGui::SetCursorScreenPos(canvas_min_);
     ImGui::InvisibleButton(
-        label_.c_str(), canvas_size_, ImGuiButtonFlags_MouseButtonLeft);
+        label_.c_str(),
+        canvas_size_,
+        ImGuiButtonFlags_MouseButtonLeft | ImGuiButtonFlags_MouseButtonMiddle);
     // Record the current status of the invisible button
     is_hovered_ = ImGui::IsItemHovered();
     is_active_ = ImGui::IsItemActive();
 }
 
+void Canvas::update_view()
+{
+    ImGuiIO& io = ImGui::GetIO();
+    if (is_hovered_ && io.MouseWheel != 0)
+    {
+        // Keep the point under the mouse in place
+        const ImVec2 mouse = mouse_pos_in_canvas();
+        zoom_ = std::clamp(
+            zoom_ * std::pow(kZoomStep, io.MouseWheel), kMinZoom, kMaxZoom);
+        pan_ = ImVec2(
+            io.MousePos.x - canvas_min_.x - mouse.x * zoom_,
+            io.MousePos.y - canvas_min_.y - mouse.y * zoom_);
+    }
+    if (is_active_ && ImGui::IsMouseDown(ImGuiMouseButton_Middle))
+        pan_ = ImVec2(pan_.x + io.MouseDelta.x, pan_.y + io.MouseDelta.y);
+}
+
 void Canvas::draw_shapes()
 {
-    Shape::Config s = { .bias = { canvas_min_.x, canvas_min_.y } };
+    Shape::Config s = { .bias = { canvas_min_.x + pan_.x,
+                                  canvas_min_.y + pan_.y },
+                        .scale = zoom_ };
     ImDrawList* draw_list = ImGui::GetWindowDrawList();
 
+    // Pick the shape under the mouse, within a few pixels of its outline
+    hovered_shape_ = {};
+    if (is_hovered_ && shape_type_ == kDefault)
+    {
+        const ImVec2 mouse = mouse_pos_in_canvas();
+        hovered_shape_ = scene_.pick(mouse.x, mouse.y, kPickPixels / zoom_);
+    }
+
     // ClipRect can hide the drawing content outside of the rectangular area
     draw_list->PushClipRect(canvas_min_, canvas_max_, true);
-    for (const auto& shape : shape_list_)
     {
-        shape->draw(s);
+        ScopedTimer timer("draw shapes");
+        scene_.draw(draw_list, s, canvas_min_, canvas_max_, hovered_shape_);
     }
     if (draw_status_ && current_shape_)
     {
@@ -123,7 +202,20 @@ void Canvas::mouse_click_event()
                     start_point_.x, start_point_.y, end_point_.x, end_point_.y);
                 break;
             }
-            // HW1_TODO: case USTC_CG::Canvas::kEllipse:
+            case USTC_CG::Canvas::kEllipse:
+            {
+                current_shape_ = std::make_shared<Ellipse>(
+                    start_point_.x, start_point_.y, end_point_.x, end_point_.y);
+                break;
+            }
+            case USTC_CG::Canvas::kFreehand:
+            {
+                current_shape_ = std::make_shared<Freehand>(
+                    start_point_.x,
+                    start_point_.y,
+                    kStrokeTolerancePixels / zoom_);
+                break;
+            }
             default: break;
         }
     }
@@ -132,7 +224,7 @@ void Canvas::mouse_click_event()
         draw_status_ = false;
         if (current_shape_)
         {
-            shape_list_.push_back(current_shape_);
+            scene_.add(*current_shape_);
             current_shape_.reset();
         }
     }
@@ -154,13 +246,24 @@ void Canvas::mouse_move_event()
 void Canvas::mouse_release_event()
 {
     // HW1_TODO: Drawing rule for more primitives
+    // A stroke ends when the button is released
+    if (draw_status_ && shape_type_ == kFreehand)
+    {
+        draw_status_ = false;
+        if (current_shape_)
+        {
+            scene_.add(*current_shape_);
+            current_shape_.reset();
+        }
+    }
 }
 
 ImVec2 Canvas::mouse_pos_in_canvas() const
 {
     ImGuiIO& io = ImGui::GetIO();
     const ImVec2 mouse_pos_in_canvas(
-        io.MousePos.x - canvas_min_.x, io.MousePos.y - canvas_min_.y);
+        (io.MousePos.x - canvas_min_.x - pan_.x) / zoom_,
+        (io.MousePos.y - canvas_min_.y - pan_.y) / zoom_);
     return mouse_pos_in_canvas;
 }
 }  // namespace USTC_CG
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include <memory>
 #include <vector>
 
+#include "scene/scene.h"
 #include "shapes/shape.h"
 #include "common/widget.h"
 
@@ -12,6 +13,10 @@ namespace USTC_CG
 {
 
 // Canvas class for drawing shapes.
+//
+// Shapes are stored in canvas (world) coordinates; the view maps them to
+// the screen as canvas * zoom + pan, from the top-left corner of the
+// widget. The wheel zooms around the mouse, the middle button pans.
 class Canvas : public Widget
 {
    public:
@@ -29,12 +34,15 @@ class Canvas : public Widget
         kRect = 2,
         kEllipse = 3,
         kPolygon = 4,
+        kFreehand = 5,
     };
 
     // Shape type setters.
     void set_default();
     void set_line();
     void set_rect();
+    void set_ellipse();
+    void set_freehand();
     // HW1_TODO: more shape types.
 
     // Clears all shapes from the canvas.
@@ -46,17 +54,27 @@ class Canvas : public Widget
     // Controls the visibility of the canvas background.
     void show_background(bool flag);
 
+    // View transform; reset_view() goes back to zoom 1, origin top-left.
+    void reset_view();
+    float zoom() const;
+
+    // Shapes of the canvas, and what the last frame drew of them.
+    Scene& scene();
+    const Scene& scene() const;
+
    private:
     // Drawing functions.
     void draw_background();
     void draw_shapes();
+    // Zoom with the wheel, pan with the middle button
+    void update_view();
 
     // Event handlers for mouse interactions.
     void mouse_click_event();
     void mouse_move_event();
     void mouse_release_event();
 
-    // Calculates mouse's relative position in the canvas.
+    // Calculates mouse's position in canvas coordinates.
     ImVec2 mouse_pos_in_canvas() const;
 
     // Canvas attributes.
@@ -70,16 +88,22 @@ class Canvas : public Widget
     ImU32 border_color_ = IM_COL32(255, 255, 255, 255);
     bool show_background_ = true;  // Controls background visibility.
 
+    // View transform: screen = canvas_min_ + pan_ + canvas * zoom_.
+    ImVec2 pan_ = ImVec2(0.f, 0.f);
+    float zoom_ = 1.0f;
+
     // Mouse interaction status.
     bool is_hovered_, is_active_;
 
     // Current shape being drawn.
-    ShapeType shape_type_;
+    ShapeType shape_type_ = kDefault;
     ImVec2 start_point_, end_point_;
     std::shared_ptr<Shape> current_shape_;
 
-    // List of shapes drawn on the canvas.
-    std::vector<std::shared_ptr<Shape>> shape_list_;
+    // Shapes drawn on the canvas, tessellated once and indexed by box.
+    Scene scene_;
+    // Shape under the mouse in the default mode, if any.
+    ShapeHandle hovered_shape_;
 };
 
 }  // namespace USTC_CG
@@ -1,7 +1,12 @@
 #include "minidraw_window.h"
 
+#include <ImGuiFileDialog.h>
+
+#include <filesystem>
 #include <iostream>
 
+#include "scene/drawing_io.h"
+
 namespace USTC_CG
 {
 MiniDraw::MiniDraw(const std::string& window_name) : Window(window_name)
@@ -16,6 +21,10 @@ MiniDraw::~MiniDraw()
 void MiniDraw::draw()
 {
     draw_canvas();
+    if (flag_open_file_dialog_)
+        draw_open_drawing_file_dialog();
+    if (flag_save_file_dialog_)
+        draw_save_drawing_file_dialog();
 }
 
 void MiniDraw::draw_canvas()
@@ -41,14 +50,46 @@ void MiniDraw::draw_canvas()
             std::cout << "Set shape to Rect" << std::endl;
             p_canvas_->set_rect();
         }
+        ImGui::SameLine();
+        if (ImGui::Button("Ellipse"))
+        {
+            std::cout << "Set shape to Ellipse" << std::endl;
+            p_canvas_->set_ellipse();
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Freehand"))
+        {
+            std::cout << "Set shape to Freehand" << std::endl;
+            p_canvas_->set_freehand();
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Open.."))
+            flag_open_file_dialog_ = true;
+        ImGui::SameLine();
+        if (ImGui::Button("Save As.."))
+            flag_save_file_dialog_ = true;
+        ImGui::SameLine();
+        if (ImGui::Button("Reset View"))
+            p_canvas_->reset_view();
 
         // HW1_TODO: More primitives
-        //    - Ellipse
         //    - Polygon
-        //    - Freehand(optional)
         
         // Canvas component
-        ImGui::Text("Press left mouse to add shapes.");
+        ImGui::Text(
+            "Press left mouse to add shapes, wheel to zoom, middle mouse to "
+            "pan.");
+        const Scene::Stats& stats = p_canvas_->scene().last_draw();
+        ImGui::SameLine();
+        ImGui::TextDisabled(
+            "zoom %.3g, %zu shapes, %zu drawn, %zu tessellated, %zu "
+            "vertices, %zu dots",
+            p_canvas_->zoom(),
+            stats.shapes,
+            stats.drawn,
+            stats.tessellated,
+            stats.vertices,
+            stats.dots);
         // Set the canvas to fill the rest of the window
         const auto& canvas_min = ImGui::GetCursorScreenPos();
         const auto& canvas_size = ImGui::GetContentRegionAvail();
@@ -57,4 +98,66 @@ void MiniDraw::draw_canvas()
     }
     ImGui::End();
 }
+
+void MiniDraw::draw_open_drawing_file_dialog()
+{
+    IGFD::FileDialogConfig config;
+    config.path = ".";
+    config.flags = ImGuiFileDialogFlags_Modal;
+    ImGuiFileDialog::Instance()->OpenDialog(
+        "ChooseDrawingOpenFileDlg", "Choose Drawing File", ".mdw", config);
+    ImVec2 main_size = ImGui::GetMainViewport()->WorkSize;
+    ImVec2 dlg_size(main_size.x / 2, main_size.y / 2);
+    if (ImGuiFileDialog::Instance()->Display(
+            "ChooseDrawingOpenFileDlg", ImGuiWindowFlags_NoCollapse, dlg_size))
+    {
+        if (ImGuiFileDialog::Instance()->IsOk())
+        {
+            std::string filePathName =
+                ImGuiFileDialog::Instance()->GetFilePathName();
+            if (!load_drawing(filePathName, p_canvas_->scene()))
+                std::cout << "Failed to load " << filePathName << std::endl;
+        }
+        ImGuiFileDialog::Instance()->Close();
+        flag_open_file_dialog_ = false;
+    }
+}
+
+void MiniDraw::draw_save_drawing_file_dialog()
+{
+    IGFD::FileDialogConfig config;
+    config.path = ".";
+    config.flags = ImGuiFileDialogFlags_Modal;
+    ImGuiFileDialog::Instance()->OpenDialog(
+        "ChooseDrawingSaveFileDlg",
+        "Save Drawing As...",
+        ".mdw,.json,.svg",
+        config);
+    ImVec2 main_size = ImGui::GetMainViewport()->WorkSize;
+    ImVec2 dlg_size(main_size.x / 2, main_size.y / 2);
+    if (ImGuiFileDialog::Instance()->Display(
+            "ChooseDrawingSaveFileDlg", ImGuiWindowFlags_NoCollapse, dlg_size))
+    {
+        if (ImGuiFileDialog::Instance()->IsOk())
+        {
+            std::string filePathName =
+                ImGuiFileDialog::Instance()->GetFilePathName();
+            // The format follows the extension
+            const std::string extension =
+                std::filesystem::path(filePathName).extension().string();
+            const Scene& scene = p_canvas_->scene();
+            bool saved = false;
+            if (extension == ".json")
+                saved = export_json(scene, filePathName);
+            else if (extension == ".svg")
+                saved = export_svg(scene, filePathName);
+            else
+                saved = save_drawing(scene, filePathName);
+            if (!saved)
+                std::cout << "Failed to save " << filePathName << std::endl;
+        }
+        ImGuiFileDialog::Instance()->Close();
+        flag_save_file_dialog_ = false;
+    }
+}
 }  // namespace USTC_CG
\ No newline at end of file
@@ -17,9 +17,13 @@ class MiniDraw : public Window
 
    private:
     void draw_canvas();
+    void draw_open_drawing_file_dialog();
+    void draw_save_drawing_file_dialog();
 
     std::shared_ptr<Canvas> p_canvas_ = nullptr;
 
     bool flag_show_canvas_view_ = true;
+    bool flag_open_file_dialog_ = false;
+    bool flag_save_file_dialog_ = false;
 };
 }  // namespace USTC_CG
\ No newline at end of file
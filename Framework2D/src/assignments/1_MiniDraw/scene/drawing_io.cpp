@@ -0,0 +1,475 @@
+#include "scene/drawing_io.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "common/mapped_file.h"
+
+namespace USTC_CG
+{
+namespace
+{
+constexpr char kMagic[4] = { 'M', 'D', 'W', '1' };
+constexpr std::uint32_t kVersion = 1;
+
+enum SectionType
+{
+    kLines = 1,
+    kRects = 2,
+    kEllipses = 3,
+    kPolylines = 4,
+    kPoints = 5,
+    kOrder = 6,
+};
+
+struct Header
+{
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t section_count;
+    std::uint32_t reserved;
+};
+struct Section
+{
+    std::uint32_t type;
+    std::uint32_t record_size;
+    std::uint64_t offset;
+    std::uint64_t count;
+};
+struct PolylineRecord
+{
+    std::uint32_t first;
+    std::uint32_t count;
+    std::uint32_t flags;
+};
+constexpr std::uint32_t kClosed = 1;
+
+static_assert(sizeof(Header) == 16 && sizeof(Section) == 24);
+static_assert(sizeof(ShapeStore::Line) == 16);
+static_assert(sizeof(ShapeStore::Rect) == 16);
+static_assert(sizeof(ShapeStore::Ellipse) == 16);
+static_assert(sizeof(ImVec2) == 8);
+static_assert(std::is_trivially_copyable_v<ShapeStore::Line>);
+static_assert(std::is_trivially_copyable_v<ShapeStore::Rect>);
+static_assert(std::is_trivially_copyable_v<ShapeStore::Ellipse>);
+
+constexpr std::size_t kAlignment = 8;
+constexpr int kSectionCount = 6;
+
+std::uint64_t align(std::uint64_t offset)
+{
+    return (offset + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+// Buffered text output, numbers formatted with std::to_chars
+class TextWriter
+{
+   public:
+    explicit TextWriter(const std::string& filename)
+        : out_(filename, std::ios::binary | std::ios::trunc)
+    {
+        buffer_.reserve(kBufferSize);
+    }
+
+    TextWriter& operator<<(std::string_view text)
+    {
+        buffer_.append(text);
+        if (buffer_.size() >= kBufferSize)
+            flush();
+        return *this;
+    }
+    TextWriter& operator<<(float value)
+    {
+        char digits[32];
+        const auto result =
+            std::to_chars(digits, digits + sizeof(digits), value);
+        return *this << std::string_view(digits, result.ptr - digits);
+    }
+    TextWriter& operator<<(int value)
+    {
+        char digits[16];
+        const auto result =
+            std::to_chars(digits, digits + sizeof(digits), value);
+        return *this << std::string_view(digits, result.ptr - digits);
+    }
+    // Returns false if anything failed to be written
+    bool close()
+    {
+        flush();
+        out_.close();
+        return !out_.fail();
+    }
+
+   private:
+    static constexpr std::size_t kBufferSize = 1 << 16;
+
+    void flush()
+    {
+        out_.write(
+            buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+        buffer_.clear();
+    }
+
+    std::ofstream out_;
+    std::string buffer_;
+};
+
+// Records of a section, or an empty span if the section is missing
+template <typename T>
+bool section_span(
+    const MappedFile& file,
+    const Section* section,
+    std::span<const T>& records)
+{
+    records = {};
+    if (!section)
+        return true;
+    if (section->record_size != sizeof(T) ||
+        section->offset % alignof(T) != 0 || section->offset > file.size() ||
+        section->count > (file.size() - section->offset) / sizeof(T))
+        return false;
+    records = { reinterpret_cast<const T*>(file.data() + section->offset),
+                static_cast<std::size_t>(section->count) };
+    return true;
+}
+}  // namespace
+
+bool save_drawing(const Scene& scene, const std::string& filename)
+{
+    const ShapeStore& store = scene.store();
+
+    // Rank of each shape in the drawing order, by slot
+    const std::vector<ShapeHandle> ordered = scene.ordered();
+    std::uint32_t slots = 0;
+    for (ShapeHandle handle : ordered)
+        slots = std::max(slots, handle.slot + 1);
+    std::vector<std::uint32_t> rank(slots);
+    for (std::size_t i = 0; i < ordered.size(); ++i)
+        rank[ordered[i].slot] = static_cast<std::uint32_t>(i);
+
+    // Each kind is written along a Z-order curve, so that the R-tree is
+    // packed from a nearly sorted array when the drawing is loaded
+    std::vector<std::uint32_t> order;
+    order.reserve(ordered.size());
+    auto spatial_order = [&](ShapeStore::Kind kind)
+    {
+        const std::span<const ShapeHandle> handles = store.handles(kind);
+        std::vector<Box> boxes(handles.size());
+        for (std::size_t i = 0; i < handles.size(); ++i)
+            boxes[i] = scene.box(handles[i]);
+        std::vector<std::uint32_t> indices = z_order(boxes);
+        for (std::uint32_t i : indices)
+            order.push_back(rank[handles[i].slot]);
+        return indices;
+    };
+    auto gather = [](auto items, const std::vector<std::uint32_t>& indices)
+    {
+        std::vector<typename decltype(items)::value_type> sorted;
+        sorted.reserve(indices.size());
+        for (std::uint32_t i : indices)
+            sorted.push_back(items[i]);
+        return sorted;
+    };
+    const auto lines =
+        gather(store.lines(), spatial_order(ShapeStore::kLine));
+    const auto rects =
+        gather(store.rects(), spatial_order(ShapeStore::kRect));
+    const auto ellipses =
+        gather(store.ellipses(), spatial_order(ShapeStore::kEllipse));
+    const auto polylines =
+        gather(store.polylines(), spatial_order(ShapeStore::kPolyline));
+
+    // Polylines are renumbered on the points actually used
+    std::vector<PolylineRecord> polyline_records;
+    polyline_records.reserve(polylines.size());
+    std::uint32_t points = 0;
+    for (const ShapeStore::Polyline& polyline : polylines)
+    {
+        polyline_records.push_back(
+            { points, polyline.count, polyline.closed ? kClosed : 0u });
+        points += polyline.count;
+    }
+
+    Section sections[kSectionCount] = {
+        { kLines, sizeof(ShapeStore::Line), 0, lines.size() },
+        { kRects, sizeof(ShapeStore::Rect), 0, rects.size() },
+        { kEllipses, sizeof(ShapeStore::Ellipse), 0, ellipses.size() },
+        { kPolylines, sizeof(PolylineRecord), 0, polyline_records.size() },
+        { kPoints, sizeof(ImVec2), 0, points },
+        { kOrder, sizeof(std::uint32_t), 0, order.size() },
+    };
+    std::uint64_t offset = sizeof(Header) + sizeof(sections);
+    for (Section& section : sections)
+    {
+        section.offset = align(offset);
+        offset = section.offset + section.count * section.record_size;
+    }
+
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    if (!out)
+        return false;
+    std::uint64_t written = 0;
+    auto write = [&](const void* data, std::uint64_t size)
+    {
+        out.write(
+            static_cast<const char*>(data), static_cast<std::streamsize>(size));
+        written += size;
+    };
+    auto pad_to = [&](std::uint64_t position)
+    {
+        static constexpr char zeros[kAlignment] = {};
+        write(zeros, position - written);
+    };
+
+    Header header;
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.section_count = kSectionCount;
+    header.reserved = 0;
+    write(&header, sizeof(header));
+    write(sections, sizeof(sections));
+    pad_to(sections[0].offset);
+    write(lines.data(), lines.size() * sizeof(ShapeStore::Line));
+    pad_to(sections[1].offset);
+    write(rects.data(), rects.size() * sizeof(ShapeStore::Rect));
+    pad_to(sections[2].offset);
+    write(ellipses.data(), ellipses.size() * sizeof(ShapeStore::Ellipse));
+    pad_to(sections[3].offset);
+    write(
+        polyline_records.data(),
+        polyline_records.size() * sizeof(PolylineRecord));
+    pad_to(sections[4].offset);
+    for (const ShapeStore::Polyline& polyline : polylines)
+        write(
+            store.points(polyline).data(),
+            store.points(polyline).size_bytes());
+    pad_to(sections[5].offset);
+    write(order.data(), order.size() * sizeof(std::uint32_t));
+    out.close();
+    return !out.fail();
+}
+
+bool load_drawing(const std::string& filename, Scene& scene)
+{
+    MappedFile file;
+    if (!file.open(filename))
+        return false;
+    Header header;
+    if (file.size() < sizeof(Header))
+        return false;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+        header.version != kVersion ||
+        header.section_count >
+            (file.size() - sizeof(Header)) / sizeof(Section))
+        return false;
+
+    // The last section of each known type wins
+    std::vector<Section> sections(header.section_count);
+    std::memcpy(
+        sections.data(),
+        file.data() + sizeof(Header),
+        sections.size() * sizeof(Section));
+    const Section* found[kSectionCount + 1] = {};
+    for (const Section& section : sections)
+        if (section.type >= kLines && section.type <= kOrder)
+            found[section.type] = &section;
+
+    std::span<const ShapeStore::Line> lines;
+    std::span<const ShapeStore::Rect> rects;
+    std::span<const ShapeStore::Ellipse> ellipses;
+    std::span<const PolylineRecord> polyline_records;
+    std::span<const ImVec2> points;
+    std::span<const std::uint32_t> order;
+    if (!section_span(file, found[kLines], lines) ||
+        !section_span(file, found[kRects], rects) ||
+        !section_span(file, found[kEllipses], ellipses) ||
+        !section_span(file, found[kPolylines], polyline_records) ||
+        !section_span(file, found[kPoints], points) ||
+        !section_span(file, found[kOrder], order))
+        return false;
+    const std::size_t count = lines.size() + rects.size() + ellipses.size() +
+                              polyline_records.size();
+    if (order.size() != count ||
+        count > std::numeric_limits<std::uint32_t>::max() ||
+        points.size() > std::numeric_limits<std::uint32_t>::max())
+        return false;
+    // The order is a permutation of 0..count-1, as the saver writes it
+    std::vector<bool> seen(count, false);
+    for (std::uint32_t rank : order)
+    {
+        if (rank >= count || seen[rank])
+            return false;
+        seen[rank] = true;
+    }
+
+    std::vector<ShapeStore::Polyline> polylines(polyline_records.size());
+    for (std::size_t i = 0; i < polylines.size(); ++i)
+    {
+        // Polylines of no points are kept, as the store holds them
+        const PolylineRecord& record = polyline_records[i];
+        if (record.first > points.size() ||
+            record.count > points.size() - record.first)
+            return false;
+        polylines[i].first = record.first;
+        polylines[i].count = record.count;
+        polylines[i].closed = (record.flags & kClosed) != 0;
+    }
+    scene.assign(lines, rects, ellipses, polylines, points, order);
+    return true;
+}
+
+bool export_json(const Scene& scene, const std::string& filename)
+{
+    const ShapeStore& store = scene.store();
+    TextWriter out(filename);
+    auto point = [&](ImVec2 p) -> TextWriter&
+    { return out << "[" << p.x << ", " << p.y << "]"; };
+
+    out << "{\n  \"shapes\": [";
+    bool first = true;
+    for (ShapeHandle handle : scene.ordered())
+    {
+        out << (first ? "\n    " : ",\n    ");
+        first = false;
+        switch (store.kind(handle))
+        {
+            case ShapeStore::kLine:
+            {
+                const ShapeStore::Line& line = store.line(handle);
+                out << "{ \"type\": \"line\", \"start\": ";
+                point(line.start) << ", \"end\": ";
+                point(line.end) << " }";
+                break;
+            }
+            case ShapeStore::kRect:
+            {
+                const ShapeStore::Rect& rect = store.rect(handle);
+                out << "{ \"type\": \"rect\", \"start\": ";
+                point(rect.start) << ", \"end\": ";
+                point(rect.end) << " }";
+                break;
+            }
+            case ShapeStore::kEllipse:
+            {
+                const ShapeStore::Ellipse& ellipse = store.ellipse(handle);
+                out << "{ \"type\": \"ellipse\", \"center\": ";
+                point(ellipse.center) << ", \"radii\": ";
+                point(ellipse.radii) << " }";
+                break;
+            }
+            case ShapeStore::kPolyline:
+            {
+                const ShapeStore::Polyline& polyline = store.polyline(handle);
+                out << "{ \"type\": \"polyline\", \"closed\": "
+                    << (polyline.closed ? "true" : "false")
+                    << ", \"points\": [";
+                bool first_point = true;
+                for (const ImVec2& p : store.points(polyline))
+                {
+                    out << (first_point ? "" : ", ");
+                    first_point = false;
+                    point(p);
+                }
+                out << "] }";
+                break;
+            }
+        }
+    }
+    out << "\n  ]\n}\n";
+    return out.close();
+}
+
+bool export_svg(
+    const Scene& scene,
+    const std::string& filename,
+    const Shape::Config& config)
+{
+    const ShapeStore& store = scene.store();
+    const std::vector<ShapeHandle> ordered = scene.ordered();
+
+    // The view box holds every shape and its line width
+    Box bounds;
+    if (!ordered.empty())
+    {
+        bounds = { std::numeric_limits<float>::max(),
+                   std::numeric_limits<float>::max(),
+                   std::numeric_limits<float>::lowest(),
+                   std::numeric_limits<float>::lowest() };
+        for (ShapeHandle handle : ordered)
+            bounds = bounds.merged(scene.box(handle));
+    }
+    const float margin = config.line_thickness / 2;
+    const float width = bounds.max_x - bounds.min_x + 2 * margin;
+    const float height = bounds.max_y - bounds.min_y + 2 * margin;
+
+    TextWriter out(filename);
+    out << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" << width
+        << "\" height=\"" << height << "\" viewBox=\""
+        << bounds.min_x - margin << " " << bounds.min_y - margin << " "
+        << width << " " << height << "\">\n";
+    out << "<g fill=\"none\" stroke=\"rgb("
+        << static_cast<int>(config.line_color[0]) << ","
+        << static_cast<int>(config.line_color[1]) << ","
+        << static_cast<int>(config.line_color[2]) << ")\" stroke-opacity=\""
+        << config.line_color[3] / 255.0f << "\" stroke-width=\""
+        << config.line_thickness << "\">\n";
+    for (ShapeHandle handle : ordered)
+    {
+        switch (store.kind(handle))
+        {
+            case ShapeStore::kLine:
+            {
+                const ShapeStore::Line& line = store.line(handle);
+                out << "<line x1=\"" << line.start.x << "\" y1=\""
+                    << line.start.y << "\" x2=\"" << line.end.x
+                    << "\" y2=\"" << line.end.y << "\"/>\n";
+                break;
+            }
+            case ShapeStore::kRect:
+            {
+                const ShapeStore::Rect& rect = store.rect(handle);
+                out << "<rect x=\"" << std::min(rect.start.x, rect.end.x)
+                    << "\" y=\"" << std::min(rect.start.y, rect.end.y)
+                    << "\" width=\"" << std::abs(rect.end.x - rect.start.x)
+                    << "\" height=\""
+                    << std::abs(rect.end.y - rect.start.y) << "\"/>\n";
+                break;
+            }
+            case ShapeStore::kEllipse:
+            {
+                const ShapeStore::Ellipse& ellipse = store.ellipse(handle);
+                out << "<ellipse cx=\"" << ellipse.center.x << "\" cy=\""
+                    << ellipse.center.y << "\" rx=\""
+                    << std::abs(ellipse.radii.x) << "\" ry=\""
+                    << std::abs(ellipse.radii.y) << "\"/>\n";
+                break;
+            }
+            case ShapeStore::kPolyline:
+            {
+                const ShapeStore::Polyline& polyline = store.polyline(handle);
+                out << (polyline.closed ? "<polygon" : "<polyline")
+                    << " points=\"";
+                bool first_point = true;
+                for (const ImVec2& p : store.points(polyline))
+                {
+                    out << (first_point ? "" : " ") << p.x << "," << p.y;
+                    first_point = false;
+                }
+                out << "\"/>\n";
+                break;
+            }
+        }
+    }
+    out << "</g>\n</svg>\n";
+    return out.close();
+}
+}  // namespace USTC_CG
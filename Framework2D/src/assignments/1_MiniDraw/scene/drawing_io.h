@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+
+#include "scene/scene.h"
+#include "shapes/shape.h"
+
+namespace USTC_CG
+{
+// Binary drawing file (.mdw), little-endian:
+//   magic "MDW1", uint32 version, uint32 section count, uint32 reserved,
+//   then per section: uint32 type, uint32 record size, uint64 offset,
+//   uint64 record count.
+// Sections are 8-byte aligned arrays of packed records: lines, rects and
+// ellipses as 4 floats (the layout of the ShapeStore structs), polylines as
+// uint32 first point, point count and flags (bit 0: closed), points as 2
+// floats, and the drawing order of each shape as uint32 (a permutation of
+// 0..count-1), lines first, then rects, ellipses and polylines. Readers
+// skip the sections they do not know.
+//
+// The file is mapped and its arrays copied into the store as they are; the
+// R-tree is packed in one pass. Returns false if the file cannot be written
+// or read, or is not a valid drawing (the scene is then unchanged). Every
+// scene saved can be loaded back, polylines of no points included.
+bool save_drawing(const Scene& scene, const std::string& filename);
+bool load_drawing(const std::string& filename, Scene& scene);
+
+// Interchange formats, written shape by shape from bottom to top. JSON
+// holds the geometry only, SVG uses the line style of `config`.
+bool export_json(const Scene& scene, const std::string& filename);
+bool export_svg(
+    const Scene& scene,
+    const std::string& filename,
+    const Shape::Config& config = {});
+}  // namespace USTC_CG
@@ -0,0 +1,496 @@
+#include "scene/rtree.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace USTC_CG
+{
+namespace
+{
+// Spread the 16 bits of v to the even bits of the result
+std::uint32_t spread_bits(std::uint32_t v)
+{
+    v = (v | (v << 8)) & 0x00FF00FFu;
+    v = (v | (v << 4)) & 0x0F0F0F0Fu;
+    v = (v | (v << 2)) & 0x33333333u;
+    v = (v | (v << 1)) & 0x55555555u;
+    return v;
+}
+
+// Sort by the upper 32 bits, 11 bits per pass
+void radix_sort(std::vector<std::uint64_t>& keys)
+{
+    constexpr int kBits = 11;
+    constexpr std::uint64_t kMask = (1u << kBits) - 1;
+    std::vector<std::uint64_t> buffer(keys.size());
+    for (int shift = 32; shift < 64; shift += kBits)
+    {
+        std::size_t offsets[(1u << kBits) + 1] = {};
+        for (std::uint64_t key : keys)
+            ++offsets[((key >> shift) & kMask) + 1];
+        for (std::size_t i = 1; i <= (1u << kBits); ++i)
+            offsets[i] += offsets[i - 1];
+        for (std::uint64_t key : keys)
+            buffer[offsets[(key >> shift) & kMask]++] = key;
+        keys.swap(buffer);
+    }
+}
+
+// Sort keys made of a few sorted runs (e.g. the shapes of each kind of a
+// saved drawing) by merging the runs. Returns false if there are too many.
+bool merge_runs(std::vector<std::uint64_t>& keys)
+{
+    constexpr std::size_t kMaxRuns = 16;
+    std::vector<std::size_t> runs = { 0 };
+    for (std::size_t i = 1; i < keys.size(); ++i)
+    {
+        if (keys[i] < keys[i - 1])
+        {
+            if (runs.size() == kMaxRuns)
+                return false;
+            runs.push_back(i);
+        }
+    }
+    runs.push_back(keys.size());
+    while (runs.size() > 2)
+    {
+        std::vector<std::size_t> merged = { 0 };
+        for (std::size_t r = 2; r < runs.size(); r += 2)
+        {
+            std::inplace_merge(
+                keys.begin() + runs[r - 2],
+                keys.begin() + runs[r - 1],
+                keys.begin() + runs[r]);
+            merged.push_back(runs[r]);
+        }
+        if (runs.size() % 2 == 0)
+            merged.push_back(runs.back());
+        runs = std::move(merged);
+    }
+    return true;
+}
+}  // namespace
+
+std::vector<std::uint32_t> z_order(std::span<const Box> boxes)
+{
+    float min_x = std::numeric_limits<float>::max(), min_y = min_x;
+    float max_x = std::numeric_limits<float>::lowest(), max_y = max_x;
+    for (const Box& box : boxes)
+    {
+        const float x = (box.min_x + box.max_x) / 2;
+        const float y = (box.min_y + box.max_y) / 2;
+        min_x = std::min(min_x, x);
+        min_y = std::min(min_y, y);
+        max_x = std::max(max_x, x);
+        max_y = std::max(max_y, y);
+    }
+    const float scale_x = max_x > min_x ? 65535.0f / (max_x - min_x) : 0.0f;
+    const float scale_y = max_y > min_y ? 65535.0f / (max_y - min_y) : 0.0f;
+    std::vector<std::uint64_t> keys(boxes.size());
+    for (std::size_t i = 0; i < boxes.size(); ++i)
+    {
+        const Box& box = boxes[i];
+        const auto x = static_cast<std::uint32_t>(
+            ((box.min_x + box.max_x) / 2 - min_x) * scale_x);
+        const auto y = static_cast<std::uint32_t>(
+            ((box.min_y + box.max_y) / 2 - min_y) * scale_y);
+        const std::uint64_t code = spread_bits(x) | (spread_bits(y) << 1);
+        keys[i] = (code << 32) | i;
+    }
+    if (!merge_runs(keys))
+        radix_sort(keys);
+    std::vector<std::uint32_t> order(keys.size());
+    for (std::size_t i = 0; i < keys.size(); ++i)
+        order[i] = static_cast<std::uint32_t>(keys[i]);
+    return order;
+}
+
+Box Box::merged(const Box& other) const
+{
+    return { std::min(min_x, other.min_x),
+             std::min(min_y, other.min_y),
+             std::max(max_x, other.max_x),
+             std::max(max_y, other.max_y) };
+}
+
+void RTree::insert(int id, const Box& box)
+{
+    if (root_ < 0)
+        root_ = new_node(true, -1);
+    const int leaf = choose_leaf(box);
+    nodes_[leaf].entries.push_back({ box, id });
+    ++size_;
+    if (nodes_[leaf].entries.size() > kMaxEntries)
+        split(leaf);
+    else
+        adjust(leaf);
+}
+
+bool RTree::remove(int id, const Box& box)
+{
+    if (root_ < 0)
+        return false;
+    const int leaf = find_leaf(root_, id, box);
+    if (leaf < 0)
+        return false;
+    std::vector<Entry>& entries = nodes_[leaf].entries;
+    entries.erase(std::find_if(
+        entries.begin(),
+        entries.end(),
+        [&](const Entry& entry) { return entry.child == id; }));
+    --size_;
+
+    // Condense: nodes left with too few entries are dissolved and their
+    // items inserted again
+    std::vector<Entry> orphans;
+    int node = leaf;
+    while (node != root_)
+    {
+        const int parent = nodes_[node].parent;
+        if (nodes_[node].entries.size() < kMinEntries)
+        {
+            std::vector<Entry>& siblings = nodes_[parent].entries;
+            siblings.erase(siblings.begin() + slot(node));
+            collect(node, orphans);
+        }
+        else
+        {
+            nodes_[parent].entries[slot(node)].box = bounds(node);
+        }
+        node = parent;
+    }
+    // A root with a single child is replaced by it
+    while (!nodes_[root_].leaf && nodes_[root_].entries.size() == 1)
+    {
+        const int child = nodes_[root_].entries[0].child;
+        nodes_[root_].entries.clear();
+        free_node(root_);
+        root_ = child;
+        nodes_[root_].parent = -1;
+    }
+    size_ -= orphans.size();
+    for (const Entry& entry : orphans)
+        insert(entry.child, entry.box);
+    return true;
+}
+
+void RTree::clear()
+{
+    nodes_.clear();
+    free_.clear();
+    root_ = -1;
+    size_ = 0;
+}
+
+void RTree::build(std::span<const Box> boxes)
+{
+    clear();
+    if (boxes.empty())
+        return;
+
+    const std::vector<std::uint32_t> order = z_order(boxes);
+
+    // Pack each level into nodes of (nearly) equal sizes, so that none has
+    // fewer than kMinEntries entries, then the level above
+    std::vector<int> level;
+    auto pack = [&](std::size_t count, bool leaf, auto&& entry)
+    {
+        const std::size_t groups = (count + kMaxEntries - 1) / kMaxEntries;
+        std::vector<int> parents;
+        parents.reserve(groups);
+        std::size_t next = 0;
+        for (std::size_t g = 0; g < groups; ++g)
+        {
+            const int node = new_node(leaf, -1);
+            const std::size_t end = count * (g + 1) / groups;
+            for (; next < end; ++next)
+                nodes_[node].entries.push_back(entry(next, node));
+            parents.push_back(node);
+        }
+        level = std::move(parents);
+    };
+    pack(
+        boxes.size(),
+        true,
+        [&](std::size_t i, int)
+        {
+            return Entry{ boxes[order[i]], static_cast<int>(order[i]) };
+        });
+    while (level.size() > 1)
+    {
+        const std::vector<int> children = std::move(level);
+        pack(
+            children.size(),
+            false,
+            [&](std::size_t i, int parent)
+            {
+                nodes_[children[i]].parent = parent;
+                return Entry{ bounds(children[i]), children[i] };
+            });
+    }
+    root_ = level.front();
+    size_ = boxes.size();
+}
+
+void RTree::query(const Box& box, std::vector<int>& ids) const
+{
+    if (root_ < 0)
+        return;
+    std::vector<int> stack = { root_ };
+    while (!stack.empty())
+    {
+        const Node& node = nodes_[stack.back()];
+        stack.pop_back();
+        for (const Entry& entry : node.entries)
+        {
+            if (!entry.box.intersects(box))
+                continue;
+            if (node.leaf)
+                ids.push_back(entry.child);
+            else
+                stack.push_back(entry.child);
+        }
+    }
+}
+
+void RTree::query(
+    const Box& box,
+    float min_size,
+    float min_node_size,
+    std::vector<int>& ids,
+    std::vector<Box>& clusters) const
+{
+    if (root_ < 0)
+        return;
+    std::vector<int> stack = { root_ };
+    while (!stack.empty())
+    {
+        const Node& node = nodes_[stack.back()];
+        stack.pop_back();
+        const float size = node.leaf ? min_size : min_node_size;
+        for (const Entry& entry : node.entries)
+        {
+            if (!entry.box.intersects(box))
+                continue;
+            if (entry.box.max_x - entry.box.min_x < size &&
+                entry.box.max_y - entry.box.min_y < size)
+                clusters.push_back(entry.box);
+            else if (node.leaf)
+                ids.push_back(entry.child);
+            else
+                stack.push_back(entry.child);
+        }
+    }
+}
+
+int RTree::new_node(bool leaf, int parent)
+{
+    int node = 0;
+    if (!free_.empty())
+    {
+        node = free_.back();
+        free_.pop_back();
+    }
+    else
+    {
+        node = static_cast<int>(nodes_.size());
+        nodes_.emplace_back();
+    }
+    nodes_[node].leaf = leaf;
+    nodes_[node].parent = parent;
+    nodes_[node].entries.reserve(kMaxEntries + 1);
+    return node;
+}
+
+void RTree::free_node(int node)
+{
+    nodes_[node].entries.clear();
+    free_.push_back(node);
+}
+
+Box RTree::bounds(int node) const
+{
+    const std::vector<Entry>& entries = nodes_[node].entries;
+    Box box = entries.front().box;
+    for (const Entry& entry : entries)
+        box = box.merged(entry.box);
+    return box;
+}
+
+std::size_t RTree::slot(int node) const
+{
+    const std::vector<Entry>& entries = nodes_[nodes_[node].parent].entries;
+    return static_cast<std::size_t>(
+        std::find_if(
+            entries.begin(),
+            entries.end(),
+            [&](const Entry& entry) { return entry.child == node; }) -
+        entries.begin());
+}
+
+int RTree::choose_leaf(const Box& box) const
+{
+    // Descend into the child whose box grows the least, then the smallest
+    int node = root_;
+    while (!nodes_[node].leaf)
+    {
+        const Entry* best = nullptr;
+        float best_growth = std::numeric_limits<float>::max();
+        float best_area = std::numeric_limits<float>::max();
+        for (const Entry& entry : nodes_[node].entries)
+        {
+            const float area = entry.box.area();
+            const float growth = entry.box.merged(box).area() - area;
+            if (growth < best_growth ||
+                (growth == best_growth && area < best_area))
+            {
+                best = &entry;
+                best_growth = growth;
+                best_area = area;
+            }
+        }
+        node = best->child;
+    }
+    return node;
+}
+
+void RTree::split(int node)
+{
+    std::vector<Entry> entries = std::move(nodes_[node].entries);
+    nodes_[node].entries.clear();
+
+    // Seeds: the pair that would waste the most area together
+    std::size_t seed_a = 0, seed_b = 1;
+    float worst = -std::numeric_limits<float>::max();
+    for (std::size_t i = 0; i < entries.size(); ++i)
+    {
+        for (std::size_t j = i + 1; j < entries.size(); ++j)
+        {
+            const float waste = entries[i].box.merged(entries[j].box).area() -
+                                entries[i].box.area() - entries[j].box.area();
+            if (waste > worst)
+            {
+                worst = waste;
+                seed_a = i;
+                seed_b = j;
+            }
+        }
+    }
+    const int sibling = new_node(nodes_[node].leaf, nodes_[node].parent);
+    Node* groups[2] = { &nodes_[node], &nodes_[sibling] };
+    Box boxes[2] = { entries[seed_a].box, entries[seed_b].box };
+    groups[0]->entries.push_back(entries[seed_a]);
+    groups[1]->entries.push_back(entries[seed_b]);
+    entries.erase(entries.begin() + seed_b);
+    entries.erase(entries.begin() + seed_a);
+
+    // Then, one at a time, the entry with the strongest preference goes to
+    // the group it enlarges the least, unless a group needs all the rest
+    while (!entries.empty())
+    {
+        for (int g = 0; g < 2; ++g)
+        {
+            if (groups[g]->entries.size() + entries.size() == kMinEntries)
+            {
+                for (const Entry& entry : entries)
+                    boxes[g] = boxes[g].merged(entry.box);
+                groups[g]->entries.insert(
+                    groups[g]->entries.end(), entries.begin(), entries.end());
+                entries.clear();
+                break;
+            }
+        }
+        if (entries.empty())
+            break;
+        std::size_t pick = 0;
+        float preference = -1;
+        for (std::size_t i = 0; i < entries.size(); ++i)
+        {
+            const float d0 =
+                boxes[0].merged(entries[i].box).area() - boxes[0].area();
+            const float d1 =
+                boxes[1].merged(entries[i].box).area() - boxes[1].area();
+            if (std::abs(d0 - d1) > preference)
+            {
+                preference = std::abs(d0 - d1);
+                pick = i;
+            }
+        }
+        const float d0 =
+            boxes[0].merged(entries[pick].box).area() - boxes[0].area();
+        const float d1 =
+            boxes[1].merged(entries[pick].box).area() - boxes[1].area();
+        const int g = d0 < d1   ? 0
+                      : d1 < d0 ? 1
+                      : groups[0]->entries.size() <= groups[1]->entries.size()
+                          ? 0
+                          : 1;
+        boxes[g] = boxes[g].merged(entries[pick].box);
+        groups[g]->entries.push_back(entries[pick]);
+        entries.erase(entries.begin() + pick);
+    }
+    if (!nodes_[sibling].leaf)
+        for (const Entry& entry : nodes_[sibling].entries)
+            nodes_[entry.child].parent = sibling;
+
+    if (node == root_)
+    {
+        root_ = new_node(false, -1);
+        nodes_[root_].entries.push_back({ boxes[0], node });
+        nodes_[root_].entries.push_back({ boxes[1], sibling });
+        nodes_[node].parent = nodes_[sibling].parent = root_;
+        return;
+    }
+    const int parent = nodes_[node].parent;
+    nodes_[parent].entries[slot(node)].box = boxes[0];
+    nodes_[parent].entries.push_back({ boxes[1], sibling });
+    if (nodes_[parent].entries.size() > kMaxEntries)
+        split(parent);
+    else
+        adjust(parent);
+}
+
+void RTree::adjust(int node)
+{
+    while (node != root_)
+    {
+        const int parent = nodes_[node].parent;
+        nodes_[parent].entries[slot(node)].box = bounds(node);
+        node = parent;
+    }
+}
+
+int RTree::find_leaf(int node, int id, const Box& box) const
+{
+    for (const Entry& entry : nodes_[node].entries)
+    {
+        if (nodes_[node].leaf)
+        {
+            if (entry.child == id)
+                return node;
+        }
+        else if (entry.box.contains(box))
+        {
+            const int leaf = find_leaf(entry.child, id, box);
+            if (leaf >= 0)
+                return leaf;
+        }
+    }
+    return -1;
+}
+
+void RTree::collect(int node, std::vector<Entry>& items)
+{
+    if (nodes_[node].leaf)
+        items.insert(
+            items.end(),
+            nodes_[node].entries.begin(),
+            nodes_[node].entries.end());
+    else
+        for (const Entry& entry : nodes_[node].entries)
+            collect(entry.child, items);
+    free_node(node);
+}
+}  // namespace USTC_CG
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace USTC_CG
+{
+// Axis-aligned box [min_x, max_x] x [min_y, max_y]
+struct Box
+{
+    float min_x = 0, min_y = 0, max_x = 0, max_y = 0;
+
+    bool intersects(const Box& other) const
+    {
+        return min_x <= other.max_x && other.min_x <= max_x &&
+               min_y <= other.max_y && other.min_y <= max_y;
+    }
+    bool contains(const Box& other) const
+    {
+        return min_x <= other.min_x && other.max_x <= max_x &&
+               min_y <= other.min_y && other.max_y <= max_y;
+    }
+    Box merged(const Box& other) const;
+    float area() const
+    {
+        return (max_x - min_x) * (max_y - min_y);
+    }
+};
+
+// Indices of the boxes, sorted along a Z-order curve of their centres:
+// boxes close in the order are close in the plane.
+std::vector<std::uint32_t> z_order(std::span<const Box> boxes);
+
+// Dynamic R-tree (Guttman, quadratic split) over the boxes of integer ids.
+//
+// Every node holds up to kMaxEntries boxes, each bounding a child node or,
+// in the leaves, an item. A query only descends into the children whose box
+// intersects it, so finding the items of a small area among N costs about
+// O(log N + items found). Nodes live in one array and refer to each other
+// by index.
+class RTree
+{
+   public:
+    static constexpr std::size_t kMaxEntries = 16;
+    static constexpr std::size_t kMinEntries = 6;
+
+    void insert(int id, const Box& box);
+    // `box` must be the box the id was inserted with. Returns false if the
+    // id is not there.
+    bool remove(int id, const Box& box);
+    void clear();
+    // Replace the content by the ids 0, 1... with their boxes, packed into
+    // full nodes along a Z-order curve of the box centres: much faster than
+    // inserting them one by one, and the nodes overlap less.
+    void build(std::span<const Box> boxes);
+    std::size_t size() const
+    {
+        return size_;
+    }
+
+    // Append the ids whose box intersects `box`, in no particular order
+    void query(const Box& box, std::vector<int>& ids) const;
+    // Same, but stops at what is too small to matter: an item whose box is
+    // smaller than `min_size` on both sides, or a node whose box is smaller
+    // than `min_node_size`, is appended to `clusters` as its box instead.
+    // The cost is then bounded by the number of clusters that fit in `box`,
+    // however many items there are.
+    void query(
+        const Box& box,
+        float min_size,
+        float min_node_size,
+        std::vector<int>& ids,
+        std::vector<Box>& clusters) const;
+
+   private:
+    struct Entry
+    {
+        Box box;
+        int child = -1;  // node index, or item id in a leaf
+    };
+    struct Node
+    {
+        bool leaf = true;
+        int parent = -1;
+        std::vector<Entry> entries;
+    };
+
+    int new_node(bool leaf, int parent);
+    void free_node(int node);
+    Box bounds(int node) const;
+    // Index of the entry of `node` in its parent
+    std::size_t slot(int node) const;
+    int choose_leaf(const Box& box) const;
+    // Split an overflowing node, and its ancestors as needed
+    void split(int node);
+    // Recompute the boxes from `node` up to the root
+    void adjust(int node);
+    int find_leaf(int node, int id, const Box& box) const;
+    void collect(int node, std::vector<Entry>& items);
+
+    std::vector<Node> nodes_;
+    std::vector<int> free_;
+    int root_ = -1;
+    std::size_t size_ = 0;
+};
+}  // namespace USTC_CG
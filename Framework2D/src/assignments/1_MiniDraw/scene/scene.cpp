@@ -0,0 +1,615 @@
+#include "scene/scene.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "scene/simplify.h"
+
+namespace USTC_CG
+{
+namespace
+{
+// Points per tessellated piece, so that a piece stays far below the 65536
+// vertices addressable by 16-bit indices
+constexpr std::size_t kChunkPoints = 2048;
+// Tessellations are compacted past this many unused vertices
+constexpr std::size_t kMinDeadVertices = 1 << 16;
+// Zoom levels per octave, and how far (in octaves) the zoom may go from the
+// level of a tessellation before it is made again
+constexpr float kLevelsPerOctave = 4.0f;
+constexpr float kHysteresis = 1.5f / kLevelsPerOctave;
+// Largest distance between an outline and the shape, in pixels
+constexpr float kTolerance = 0.25f;
+// Shapes smaller than this on the screen are drawn as dots
+constexpr float kDotPixels = 2.0f;
+// Nodes of the R-tree narrower than this many dots are drawn as the dots
+// they cover, without looking at their shapes: a node holds at least six
+// shapes, which cover most of the few dots inside such a small box
+constexpr float kClusterDots = 4.0f;
+// Dots per PrimReserve: 4 vertices each, well within 16-bit indices
+constexpr std::size_t kDotBatch = 8192;
+// Shapes tessellated again per frame only because the zoom changed
+constexpr std::size_t kRetessellations = 4096;
+
+float level_scale(float zoom)
+{
+    return std::exp2(
+        std::round(std::log2(zoom) * kLevelsPerOctave) / kLevelsPerOctave);
+}
+
+float distance_to_segment(ImVec2 p, ImVec2 a, ImVec2 b)
+{
+    const float dx = b.x - a.x, dy = b.y - a.y;
+    const float length2 = dx * dx + dy * dy;
+    float t = length2 > 0 ? ((p.x - a.x) * dx + (p.y - a.y) * dy) / length2
+                          : 0.0f;
+    t = std::clamp(t, 0.0f, 1.0f);
+    return std::hypot(p.x - (a.x + t * dx), p.y - (a.y + t * dy));
+}
+
+// Bounding boxes of the outlines, plus a pixel of antialiasing fringe
+Box fringed(Box box)
+{
+    return { box.min_x - 1, box.min_y - 1, box.max_x + 1, box.max_y + 1 };
+}
+
+Box corners_box(ImVec2 a, ImVec2 b)
+{
+    return fringed({ std::min(a.x, b.x),
+                     std::min(a.y, b.y),
+                     std::max(a.x, b.x),
+                     std::max(a.y, b.y) });
+}
+
+Box outline_box(const ShapeStore::Line& line)
+{
+    return corners_box(line.start, line.end);
+}
+
+Box outline_box(const ShapeStore::Rect& rect)
+{
+    return corners_box(rect.start, rect.end);
+}
+
+Box outline_box(const ShapeStore::Ellipse& e)
+{
+    return fringed({ e.center.x - std::abs(e.radii.x),
+                     e.center.y - std::abs(e.radii.y),
+                     e.center.x + std::abs(e.radii.x),
+                     e.center.y + std::abs(e.radii.y) });
+}
+
+Box outline_box(std::span<const ImVec2> points)
+{
+    if (points.empty())
+        return fringed({});
+    Box box = { points[0].x, points[0].y, points[0].x, points[0].y };
+    for (const ImVec2& p : points)
+        box = box.merged({ p.x, p.y, p.x, p.y });
+    return fringed(box);
+}
+}  // namespace
+
+ShapeHandle Scene::add(const Shape& shape)
+{
+    return track(shape.add_to(store_));
+}
+
+ShapeHandle Scene::add(const ShapeStore::Line& line)
+{
+    return track(store_.add(line));
+}
+
+ShapeHandle Scene::add(const ShapeStore::Rect& rect)
+{
+    return track(store_.add(rect));
+}
+
+ShapeHandle Scene::add(const ShapeStore::Ellipse& ellipse)
+{
+    return track(store_.add(ellipse));
+}
+
+ShapeHandle Scene::add_polyline(std::span<const ImVec2> points, bool closed)
+{
+    return track(store_.add_polyline(points, closed));
+}
+
+ShapeHandle Scene::track(ShapeHandle handle)
+{
+    if (handle.slot >= entries_.size())
+    {
+        entries_.resize(handle.slot + 1);
+        boxes_.resize(handle.slot + 1);
+    }
+    Entry& entry = entries_[handle.slot];
+    entry = Entry();
+    entry.handle = handle;
+    entry.order = next_order_++;
+    boxes_[handle.slot] = bounds(handle);
+    tree_.insert(static_cast<int>(handle.slot), boxes_[handle.slot]);
+    return handle;
+}
+
+void Scene::assign(
+    std::span<const ShapeStore::Line> lines,
+    std::span<const ShapeStore::Rect> rects,
+    std::span<const ShapeStore::Ellipse> ellipses,
+    std::span<const ShapeStore::Polyline> polylines,
+    std::span<const ImVec2> points,
+    std::span<const std::uint32_t> order)
+{
+    clear();
+    store_.assign(lines, rects, ellipses, polylines, points);
+    entries_.resize(store_.size());
+    boxes_.resize(store_.size());
+    for (int kind = ShapeStore::kLine; kind <= ShapeStore::kPolyline; ++kind)
+    {
+        for (ShapeHandle handle :
+             store_.handles(static_cast<ShapeStore::Kind>(kind)))
+        {
+            Entry& entry = entries_[handle.slot];
+            entry.handle = handle;
+            entry.order = order[handle.slot];
+            next_order_ = std::max(next_order_, entry.order + 1);
+        }
+    }
+    // The slots are 0, 1... in the order of the arrays: one plain loop per
+    // kind. Tessellations are made when the shapes show up.
+    Box* box = boxes_.data();
+    for (const ShapeStore::Line& line : store_.lines())
+        *box++ = outline_box(line);
+    for (const ShapeStore::Rect& rect : store_.rects())
+        *box++ = outline_box(rect);
+    for (const ShapeStore::Ellipse& ellipse : store_.ellipses())
+        *box++ = outline_box(ellipse);
+    for (const ShapeStore::Polyline& polyline : store_.polylines())
+        *box++ = outline_box(store_.points(polyline));
+    tree_.build(boxes_);
+}
+
+void Scene::update(ShapeHandle handle)
+{
+    if (!store_.contains(handle))
+        return;
+    Box& box = boxes_[handle.slot];
+    tree_.remove(static_cast<int>(handle.slot), box);
+    box = bounds(handle);
+    tree_.insert(static_cast<int>(handle.slot), box);
+    entries_[handle.slot].dirty = true;
+}
+
+void Scene::remove(ShapeHandle handle)
+{
+    if (!store_.contains(handle))
+        return;
+    tree_.remove(static_cast<int>(handle.slot), boxes_[handle.slot]);
+    release(entries_[handle.slot]);
+    store_.remove(handle);
+}
+
+void Scene::clear()
+{
+    store_.clear();
+    entries_.clear();
+    boxes_.clear();
+    tree_.clear();
+    vertices_.clear();
+    indices_.clear();
+    chunks_.clear();
+    dead_vertices_ = 0;
+}
+
+std::size_t Scene::size() const
+{
+    return store_.size();
+}
+
+ShapeStore& Scene::store()
+{
+    return store_;
+}
+
+const ShapeStore& Scene::store() const
+{
+    return store_;
+}
+
+ShapeHandle Scene::pick(float x, float y, float tolerance) const
+{
+    const float reach = tolerance + thickness_ / 2;
+    std::vector<ImVec2> points;
+    // From the top, the first shape close enough
+    const std::vector<ShapeHandle> candidates =
+        query({ x - reach, y - reach, x + reach, y + reach });
+    for (auto it = candidates.rbegin(); it != candidates.rend(); ++it)
+    {
+        const bool closed = store_.outline(*it, points);
+        if (points.empty())
+            continue;
+        const std::size_t segments = points.size() - (closed ? 0 : 1);
+        for (std::size_t i = 0; i < segments; ++i)
+        {
+            if (distance_to_segment(
+                    ImVec2(x, y),
+                    points[i],
+                    points[(i + 1) % points.size()]) <= reach)
+                return *it;
+        }
+    }
+    return {};
+}
+
+const Box& Scene::box(ShapeHandle handle) const
+{
+    return boxes_[handle.slot];
+}
+
+std::vector<ShapeHandle> Scene::ordered() const
+{
+    std::vector<const Entry*> entries;
+    entries.reserve(store_.size());
+    for (const Entry& entry : entries_)
+        if (store_.contains(entry.handle))
+            entries.push_back(&entry);
+    std::sort(
+        entries.begin(),
+        entries.end(),
+        [](const Entry* a, const Entry* b) { return a->order < b->order; });
+    std::vector<ShapeHandle> handles;
+    handles.reserve(entries.size());
+    for (const Entry* entry : entries)
+        handles.push_back(entry->handle);
+    return handles;
+}
+
+std::vector<ShapeHandle> Scene::query(const Box& box) const
+{
+    std::vector<int> slots;
+    tree_.query(box, slots);
+    std::sort(
+        slots.begin(),
+        slots.end(),
+        [this](int a, int b) { return entries_[a].order < entries_[b].order; });
+    std::vector<ShapeHandle> handles;
+    handles.reserve(slots.size());
+    for (int slot : slots)
+        handles.push_back(entries_[slot].handle);
+    return handles;
+}
+
+void Scene::draw(
+    ImDrawList* draw_list,
+    const Shape::Config& config,
+    const ImVec2& clip_min,
+    const ImVec2& clip_max,
+    ShapeHandle highlight,
+    ImU32 highlight_color)
+{
+    const ImU32 color = IM_COL32(
+        config.line_color[0],
+        config.line_color[1],
+        config.line_color[2],
+        config.line_color[3]);
+    if (color != color_ || config.line_thickness != thickness_)
+    {
+        // Every tessellation is stale
+        color_ = color;
+        thickness_ = config.line_thickness;
+        for (Entry& entry : entries_)
+            entry.dirty = true;
+    }
+    compact();
+
+    // Boxes hold the outlines only: the line may stick out by half its width
+    const float zoom = config.scale;
+    const ImVec2 offset(config.bias[0], config.bias[1]);
+    const float margin = std::max(thickness_, 1.0f / zoom) / 2;
+    const Box view = { (clip_min.x - offset.x) / zoom - margin,
+                       (clip_min.y - offset.y) / zoom - margin,
+                       (clip_max.x - offset.x) / zoom + margin,
+                       (clip_max.y - offset.y) / zoom + margin };
+    visible_.clear();
+    clusters_.clear();
+    tree_.query(
+        view,
+        kDotPixels / zoom,
+        kClusterDots * dot_size(zoom) / zoom,
+        visible_,
+        clusters_);
+    std::sort(
+        visible_.begin(),
+        visible_.end(),
+        [this](int a, int b) { return entries_[a].order < entries_[b].order; });
+    stats_ = Stats();
+    stats_.shapes = store_.size();
+    stats_.drawn = visible_.size();
+
+    // All the shapes share one colour, so the dots can go below them
+    draw_dots(draw_list, zoom, offset, clip_min, clip_max);
+
+    const float level = level_scale(zoom);
+    std::size_t budget = kRetessellations;
+    auto refresh = [&](Entry& entry)
+    {
+        if (!entry.dirty && entry.scale > 0)
+        {
+            if (std::abs(std::log2(zoom / entry.scale)) <= kHysteresis ||
+                budget == 0)
+                return;
+            --budget;
+        }
+        tessellate(entry, config, level);
+        ++stats_.tessellated;
+    };
+    for (int slot : visible_)
+    {
+        Entry& entry = entries_[slot];
+        refresh(entry);
+        blit(draw_list, entry, zoom, offset);
+    }
+    if (store_.contains(highlight))
+    {
+        Entry& entry = entries_[highlight.slot];
+        refresh(entry);
+        blit(draw_list, entry, zoom, offset, &highlight_color);
+    }
+}
+
+const Scene::Stats& Scene::last_draw() const
+{
+    return stats_;
+}
+
+Box Scene::bounds(ShapeHandle handle) const
+{
+    switch (store_.kind(handle))
+    {
+        case ShapeStore::kLine: return outline_box(store_.line(handle));
+        case ShapeStore::kRect: return outline_box(store_.rect(handle));
+        case ShapeStore::kEllipse: return outline_box(store_.ellipse(handle));
+        case ShapeStore::kPolyline:
+            return outline_box(store_.points(store_.polyline(handle)));
+    }
+    return {};
+}
+
+void Scene::release(Entry& entry)
+{
+    for (std::uint32_t c = 0; c < entry.chunk_count; ++c)
+        dead_vertices_ += chunks_[entry.first_chunk + c].vertex_count;
+    entry.chunk_count = 0;
+    entry.dirty = true;
+}
+
+void Scene::tessellate(
+    Entry& entry,
+    const Shape::Config& config,
+    float scale)
+{
+    if (!scratch_)
+        scratch_ = std::make_unique<ImDrawList>(ImGui::GetDrawListSharedData());
+    release(entry);
+    entry.first_chunk = static_cast<std::uint32_t>(chunks_.size());
+    entry.scale = scale;
+
+    // Only the detail visible at this zoom: ellipses get fewer segments and
+    // strokes fewer points when zoomed out
+    const float tolerance = kTolerance / scale;
+    const bool closed = store_.outline(entry.handle, outline_, tolerance);
+    if (store_.kind(entry.handle) == ShapeStore::kPolyline)
+    {
+        simplify_polyline(outline_, tolerance, kept_);
+        for (std::size_t k = 0; k < kept_.size(); ++k)
+            outline_[k] = outline_[kept_[k]];
+        outline_.resize(kept_.size());
+    }
+    for (ImVec2& p : outline_)
+        p = ImVec2(p.x * scale, p.y * scale);
+
+    // Long outlines are cut in pieces sharing their end points; a closed
+    // outline cut in pieces gets its closing segment as a last piece.
+    auto add_piece = [&](const ImVec2* points, std::size_t count, bool loop)
+    {
+        scratch_->_ResetForNewFrame();
+        scratch_->AddPolyline(
+            points,
+            static_cast<int>(count),
+            color_,
+            loop ? ImDrawFlags_Closed : ImDrawFlags_None,
+            std::max(config.line_thickness * scale, 1.0f));
+        Chunk chunk;
+        chunk.first_vertex = static_cast<std::uint32_t>(vertices_.size());
+        chunk.vertex_count = static_cast<std::uint32_t>(
+            scratch_->VtxBuffer.Size);
+        chunk.first_index = static_cast<std::uint32_t>(indices_.size());
+        chunk.index_count = static_cast<std::uint32_t>(
+            scratch_->IdxBuffer.Size);
+        vertices_.insert(
+            vertices_.end(),
+            scratch_->VtxBuffer.begin(),
+            scratch_->VtxBuffer.end());
+        indices_.insert(
+            indices_.end(),
+            scratch_->IdxBuffer.begin(),
+            scratch_->IdxBuffer.end());
+        chunks_.push_back(chunk);
+        ++entry.chunk_count;
+    };
+    if (outline_.size() <= kChunkPoints)
+    {
+        add_piece(outline_.data(), outline_.size(), closed);
+    }
+    else
+    {
+        for (std::size_t first = 0; first + 1 < outline_.size();
+             first += kChunkPoints - 1)
+            add_piece(
+                outline_.data() + first,
+                std::min(kChunkPoints, outline_.size() - first),
+                false);
+        if (closed)
+        {
+            const ImVec2 ends[] = { outline_.back(), outline_.front() };
+            add_piece(ends, 2, false);
+        }
+    }
+    entry.dirty = false;
+}
+
+void Scene::draw_dots(
+    ImDrawList* draw_list,
+    float zoom,
+    ImVec2 offset,
+    const ImVec2& clip_min,
+    const ImVec2& clip_max)
+{
+    if (clusters_.empty())
+        return;
+    const float side = dot_size(zoom);
+    const int width =
+        static_cast<int>(std::max(clip_max.x - clip_min.x, 1.0f) / side) + 1;
+    const int height =
+        static_cast<int>(std::max(clip_max.y - clip_min.y, 1.0f) / side) + 1;
+    const std::size_t cells = static_cast<std::size_t>(width) * height;
+    dotted_.assign((cells + 63) / 64, 0);
+    dots_.clear();
+    // Cell of a canvas coordinate, along x or y
+    auto cell_of = [&](float canvas, float shift, float clip)
+    {
+        return static_cast<int>(
+            std::floor((canvas * zoom + shift - clip) / side));
+    };
+    for (const Box& box : clusters_)
+    {
+        // Cells of the box less half a dot on each side, so a shape smaller
+        // than a dot gets one, at its centre
+        const float x = (box.min_x + box.max_x) / 2;
+        const float y = (box.min_y + box.max_y) / 2;
+        const float inset = side / 2 / zoom;
+        const int x0 = std::max(
+            cell_of(std::min(box.min_x + inset, x), offset.x, clip_min.x), 0);
+        const int y0 = std::max(
+            cell_of(std::min(box.min_y + inset, y), offset.y, clip_min.y), 0);
+        const int x1 = std::min(
+            cell_of(std::max(box.max_x - inset, x), offset.x, clip_min.x),
+            width - 1);
+        const int y1 = std::min(
+            cell_of(std::max(box.max_y - inset, y), offset.y, clip_min.y),
+            height - 1);
+        for (int cy = y0; cy <= y1; ++cy)
+        {
+            for (int cx = x0; cx <= x1; ++cx)
+            {
+                const std::size_t cell =
+                    static_cast<std::size_t>(cy) * width + cx;
+                const std::uint64_t bit = std::uint64_t(1) << (cell % 64);
+                if (dotted_[cell / 64] & bit)
+                    continue;
+                dotted_[cell / 64] |= bit;
+                dots_.push_back(static_cast<std::uint32_t>(cell));
+            }
+        }
+    }
+
+    // Reserved in batches, each within the 16-bit indices of a draw command
+    for (std::size_t first = 0; first < dots_.size(); first += kDotBatch)
+    {
+        const std::size_t count = std::min(kDotBatch, dots_.size() - first);
+        draw_list->PrimReserve(
+            static_cast<int>(count * 6), static_cast<int>(count * 4));
+        for (std::size_t d = first; d < first + count; ++d)
+        {
+            const ImVec2 corner(
+                clip_min.x + static_cast<float>(dots_[d] % width) * side,
+                clip_min.y + static_cast<float>(dots_[d] / width) * side);
+            draw_list->PrimRect(
+                corner, ImVec2(corner.x + side, corner.y + side), color_);
+        }
+    }
+    stats_.dots = dots_.size();
+}
+
+float Scene::dot_size(float zoom) const
+{
+    return std::ceil(std::max(thickness_ * zoom, kDotPixels));
+}
+
+void Scene::compact()
+{
+    if (dead_vertices_ < kMinDeadVertices ||
+        dead_vertices_ * 2 < vertices_.size())
+        return;
+    std::vector<ImDrawVert> vertices;
+    std::vector<ImDrawIdx> indices;
+    std::vector<Chunk> chunks;
+    vertices.reserve(vertices_.size() - dead_vertices_);
+    for (Entry& entry : entries_)
+    {
+        if (!store_.contains(entry.handle))
+            continue;
+        const std::uint32_t first_chunk =
+            static_cast<std::uint32_t>(chunks.size());
+        for (std::uint32_t c = 0; c < entry.chunk_count; ++c)
+        {
+            Chunk chunk = chunks_[entry.first_chunk + c];
+            vertices.insert(
+                vertices.end(),
+                vertices_.begin() + chunk.first_vertex,
+                vertices_.begin() + chunk.first_vertex + chunk.vertex_count);
+            indices.insert(
+                indices.end(),
+                indices_.begin() + chunk.first_index,
+                indices_.begin() + chunk.first_index + chunk.index_count);
+            chunk.first_vertex = static_cast<std::uint32_t>(
+                vertices.size() - chunk.vertex_count);
+            chunk.first_index = static_cast<std::uint32_t>(
+                indices.size() - chunk.index_count);
+            chunks.push_back(chunk);
+        }
+        entry.first_chunk = first_chunk;
+    }
+    vertices_ = std::move(vertices);
+    indices_ = std::move(indices);
+    chunks_ = std::move(chunks);
+    dead_vertices_ = 0;
+}
+
+void Scene::blit(
+    ImDrawList* draw_list,
+    const Entry& entry,
+    float zoom,
+    ImVec2 offset,
+    const ImU32* color)
+{
+    const float factor = zoom / entry.scale;
+    // With a colour, the same triangles are recoloured; the transparent
+    // fringe of the antialiasing stays transparent.
+    const ImU32 transparent = color ? *color & ~IM_COL32_A_MASK : 0;
+    for (std::uint32_t c = 0; c < entry.chunk_count; ++c)
+    {
+        const Chunk& chunk = chunks_[entry.first_chunk + c];
+        stats_.vertices += chunk.vertex_count;
+        draw_list->PrimReserve(
+            static_cast<int>(chunk.index_count),
+            static_cast<int>(chunk.vertex_count));
+        const unsigned base = draw_list->_VtxCurrentIdx;
+        const ImDrawVert* vertex = vertices_.data() + chunk.first_vertex;
+        for (std::uint32_t i = 0; i < chunk.vertex_count; ++i, ++vertex)
+        {
+            ImU32 col = vertex->col;
+            if (color)
+                col = (col & IM_COL32_A_MASK) ? *color : transparent;
+            draw_list->PrimWriteVtx(
+                ImVec2(
+                    vertex->pos.x * factor + offset.x,
+                    vertex->pos.y * factor + offset.y),
+                vertex->uv,
+                col);
+        }
+        const ImDrawIdx* index = indices_.data() + chunk.first_index;
+        for (std::uint32_t i = 0; i < chunk.index_count; ++i, ++index)
+            draw_list->PrimWriteIdx(static_cast<ImDrawIdx>(base + *index));
+    }
+}
+}  // namespace USTC_CG
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <imgui.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "scene/rtree.h"
+#include "scene/shape_store.h"
+#include "shapes/shape.h"
+
+namespace USTC_CG
+{
+// Retained shapes of a canvas.
+//
+// The geometry lives in a ShapeStore. Each shape keeps its tessellation
+// (the triangles ImGui builds for its outline) in arrays shared by all the
+// shapes, so drawing a frame only copies the vertices of the visible shapes
+// into the draw list, moved to the screen. An R-tree over the bounding
+// boxes finds the visible shapes and the shapes under the mouse.
+//
+// Tessellations are made for a zoom level, a quarter of an octave apart:
+// ellipses get as many segments, and polylines keep as many points, as a
+// quarter of a pixel of error allows at that zoom. A visible shape is
+// tessellated again when it changed, when the line style did, or when the
+// zoom went more than one level and a half away from its tessellation.
+// Only a few thousand are tessellated again per frame for a zoom change;
+// the others are drawn from their old tessellation, scaled, until their
+// turn comes.
+//
+// Shapes smaller than a couple of pixels on the screen are drawn as dots,
+// at most one per dot-sized cell of the screen, and R-tree nodes smaller
+// than a few dots as the dots they cover, without visiting their shapes:
+// a zoomed out view of a million shapes costs about as much as its pixels.
+class Scene
+{
+   public:
+    struct Stats
+    {
+        std::size_t shapes = 0;
+        std::size_t drawn = 0;
+        std::size_t tessellated = 0;
+        std::size_t vertices = 0;
+        // Pixels drawn for the shapes too small to be outlined
+        std::size_t dots = 0;
+    };
+
+    // New shapes go on top of the others
+    ShapeHandle add(const Shape& shape);
+    ShapeHandle add(const ShapeStore::Line& line);
+    ShapeHandle add(const ShapeStore::Rect& rect);
+    ShapeHandle add(const ShapeStore::Ellipse& ellipse);
+    ShapeHandle add_polyline(std::span<const ImVec2> points, bool closed);
+    // Replace the shapes by whole arrays (see ShapeStore::assign), with
+    // order[i] the drawing order of the i-th shape of them all: lines
+    // first, then rects, ellipses and polylines. Larger is on top.
+    void assign(
+        std::span<const ShapeStore::Line> lines,
+        std::span<const ShapeStore::Rect> rects,
+        std::span<const ShapeStore::Ellipse> ellipses,
+        std::span<const ShapeStore::Polyline> polylines,
+        std::span<const ImVec2> points,
+        std::span<const std::uint32_t> order);
+    // The geometry of the shape changed in store(): update its box,
+    // tessellate it again
+    void update(ShapeHandle handle);
+    void remove(ShapeHandle handle);
+    void clear();
+    std::size_t size() const;
+    ShapeStore& store();
+    const ShapeStore& store() const;
+
+    // The topmost shape whose outline passes within `tolerance` of (x, y)
+    // in canvas coordinates, or an invalid handle
+    ShapeHandle pick(float x, float y, float tolerance) const;
+    // Bounding box of the outline of a shape, plus a pixel
+    const Box& box(ShapeHandle handle) const;
+    // All the shapes, from bottom to top
+    std::vector<ShapeHandle> ordered() const;
+    // Shapes whose box intersects `box`, from bottom to top
+    std::vector<ShapeHandle> query(const Box& box) const;
+
+    // Draw the shapes inside [clip_min, clip_max] (screen coordinates);
+    // config.scale and config.bias map canvas to screen coordinates. The
+    // shape `highlight` is drawn again on top, in `highlight_color`.
+    void draw(
+        ImDrawList* draw_list,
+        const Shape::Config& config,
+        const ImVec2& clip_min,
+        const ImVec2& clip_max,
+        ShapeHandle highlight = {},
+        ImU32 highlight_color = IM_COL32(255, 255, 0, 255));
+    const Stats& last_draw() const;
+
+   private:
+    // Vertices and indices of one piece of a tessellation. Indices are 16
+    // bits and local to the piece.
+    struct Chunk
+    {
+        std::uint32_t first_vertex = 0, vertex_count = 0;
+        std::uint32_t first_index = 0, index_count = 0;
+    };
+    // What the scene knows of a shape, indexed by the slot of its handle
+    struct Entry
+    {
+        ShapeHandle handle;
+        // Drawing order: larger is on top
+        std::uint64_t order = 0;
+        std::uint32_t first_chunk = 0, chunk_count = 0;
+        // Zoom level the tessellation was made at, 0 if none
+        float scale = 0.0f;
+        bool dirty = true;
+    };
+
+    ShapeHandle track(ShapeHandle handle);
+    Box bounds(ShapeHandle handle) const;
+    void release(Entry& entry);
+    // Tessellate at the zoom `scale`, in canvas coordinates times `scale`.
+    // Lines are at least a pixel wide, or far zoomed out views would fade.
+    void tessellate(Entry& entry, const Shape::Config& config, float scale);
+    // Drop the tessellations of removed or changed shapes once they are
+    // most of the arrays
+    void compact();
+    void blit(
+        ImDrawList* draw_list,
+        const Entry& entry,
+        float zoom,
+        ImVec2 offset,
+        const ImU32* color = nullptr);
+    // Side of the dots in pixels: the line width, but at least as wide as
+    // the shapes they stand for may be
+    float dot_size(float zoom) const;
+    // Dots on a grid of their size over [clip_min, clip_max): one for each
+    // cell covered by a cluster, or holding the centre of a small one
+    void draw_dots(
+        ImDrawList* draw_list,
+        float zoom,
+        ImVec2 offset,
+        const ImVec2& clip_min,
+        const ImVec2& clip_max);
+
+    ShapeStore store_;
+    std::vector<Entry> entries_;
+    // Bounding boxes, by slot too: the R-tree is built from this array
+    std::vector<Box> boxes_;
+    std::uint64_t next_order_ = 0;
+    RTree tree_;
+    // Tessellations of all the shapes
+    std::vector<ImDrawVert> vertices_;
+    std::vector<ImDrawIdx> indices_;
+    std::vector<Chunk> chunks_;
+    std::size_t dead_vertices_ = 0;
+    // Line style the tessellations were made with
+    float thickness_ = 0.0f;
+    ImU32 color_ = 0;
+    // Tessellates outlines with ImGui's own code, then gets copied
+    std::unique_ptr<ImDrawList> scratch_;
+    std::vector<ImVec2> outline_;
+    std::vector<std::uint32_t> kept_;
+    // Last frame: shapes to outline, clusters to draw as dots, the cells
+    // already dotted (a bit each) and their indices
+    std::vector<int> visible_;
+    std::vector<Box> clusters_;
+    std::vector<std::uint64_t> dotted_;
+    std::vector<std::uint32_t> dots_;
+    Stats stats_;
+};
+}  // namespace USTC_CG
@@ -0,0 +1,352 @@
+#include "scene/shape_store.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <numbers>
+
+namespace USTC_CG
+{
+namespace
+{
+constexpr int kMinEllipseSegments = 12;
+constexpr int kMaxEllipseSegments = 1024;
+}  // namespace
+
+template <typename T>
+ShapeHandle
+ShapeStore::insert(Kind kind, Array<T>& array, const T& item)
+{
+    ShapeHandle handle;
+    if (free_slots_.empty())
+    {
+        handle.slot = static_cast<std::uint32_t>(slots_.size());
+        slots_.emplace_back();
+    }
+    else
+    {
+        handle.slot = free_slots_.back();
+        free_slots_.pop_back();
+    }
+    Slot& slot = slots_[handle.slot];
+    slot.kind = kind;
+    slot.index = static_cast<std::uint32_t>(array.items.size());
+    slot.used = true;
+    handle.generation = slot.generation;
+    array.items.push_back(item);
+    array.handles.push_back(handle);
+    return handle;
+}
+
+template <typename T>
+void ShapeStore::erase(Array<T>& array, std::uint32_t index)
+{
+    // The last item takes the place of the removed one
+    if (index + 1 != array.items.size())
+    {
+        array.items[index] = array.items.back();
+        array.handles[index] = array.handles.back();
+        slots_[array.handles[index].slot].index = index;
+    }
+    array.items.pop_back();
+    array.handles.pop_back();
+}
+
+template <typename T>
+void ShapeStore::assign(
+    Kind kind,
+    Array<T>& array,
+    std::span<const T> items,
+    std::uint32_t& slot)
+{
+    array.items.assign(items.begin(), items.end());
+    array.handles.resize(items.size());
+    for (std::uint32_t i = 0; i < items.size(); ++i, ++slot)
+    {
+        slots_[slot].kind = kind;
+        slots_[slot].index = i;
+        slots_[slot].used = true;
+        array.handles[i] = { slot, slots_[slot].generation };
+    }
+}
+
+ShapeHandle ShapeStore::add(const Line& line)
+{
+    return insert(kLine, lines_, line);
+}
+
+ShapeHandle ShapeStore::add(const Rect& rect)
+{
+    return insert(kRect, rects_, rect);
+}
+
+ShapeHandle ShapeStore::add(const Ellipse& ellipse)
+{
+    return insert(kEllipse, ellipses_, ellipse);
+}
+
+ShapeHandle ShapeStore::add_polyline(
+    std::span<const ImVec2> points,
+    bool closed)
+{
+    Polyline polyline;
+    polyline.first = static_cast<std::uint32_t>(points_.size());
+    polyline.count = static_cast<std::uint32_t>(points.size());
+    polyline.closed = closed;
+    points_.insert(points_.end(), points.begin(), points.end());
+    return insert(kPolyline, polylines_, polyline);
+}
+
+void ShapeStore::remove(ShapeHandle handle)
+{
+    if (!contains(handle))
+        return;
+    Slot& slot = slots_[handle.slot];
+    switch (slot.kind)
+    {
+        case kLine: erase(lines_, slot.index); break;
+        case kRect: erase(rects_, slot.index); break;
+        case kEllipse: erase(ellipses_, slot.index); break;
+        case kPolyline:
+            dead_points_ += polylines_.items[slot.index].count;
+            erase(polylines_, slot.index);
+            compact_points();
+            break;
+    }
+    slot.used = false;
+    ++slot.generation;
+    free_slots_.push_back(handle.slot);
+}
+
+void ShapeStore::clear()
+{
+    // Slots keep their generation, so that old handles stay invalid
+    free_slots_.clear();
+    for (std::size_t s = slots_.size(); s-- > 0;)
+    {
+        if (slots_[s].used)
+            ++slots_[s].generation;
+        slots_[s].used = false;
+        free_slots_.push_back(static_cast<std::uint32_t>(s));
+    }
+    lines_ = {};
+    rects_ = {};
+    ellipses_ = {};
+    polylines_ = {};
+    points_.clear();
+    dead_points_ = 0;
+}
+
+void ShapeStore::assign(
+    std::span<const Line> lines,
+    std::span<const Rect> rects,
+    std::span<const Ellipse> ellipses,
+    std::span<const Polyline> polylines,
+    std::span<const ImVec2> points)
+{
+    clear();
+    const std::size_t count =
+        lines.size() + rects.size() + ellipses.size() + polylines.size();
+    if (slots_.size() < count)
+        slots_.resize(count);
+    free_slots_.clear();
+    for (std::size_t s = slots_.size(); s-- > count;)
+        free_slots_.push_back(static_cast<std::uint32_t>(s));
+    std::uint32_t slot = 0;
+    assign(kLine, lines_, lines, slot);
+    assign(kRect, rects_, rects, slot);
+    assign(kEllipse, ellipses_, ellipses, slot);
+    assign(kPolyline, polylines_, polylines, slot);
+    points_.assign(points.begin(), points.end());
+}
+
+void ShapeStore::reserve(Kind kind, std::size_t count, std::size_t points)
+{
+    auto grow = [count](auto& array)
+    {
+        array.items.reserve(array.items.size() + count);
+        array.handles.reserve(array.handles.size() + count);
+    };
+    switch (kind)
+    {
+        case kLine: grow(lines_); break;
+        case kRect: grow(rects_); break;
+        case kEllipse: grow(ellipses_); break;
+        case kPolyline: grow(polylines_); break;
+    }
+    slots_.reserve(slots_.size() + count);
+    points_.reserve(points_.size() + points);
+}
+
+bool ShapeStore::contains(ShapeHandle handle) const
+{
+    return handle.slot < slots_.size() && slots_[handle.slot].used &&
+           slots_[handle.slot].generation == handle.generation;
+}
+
+std::size_t ShapeStore::size() const
+{
+    return lines_.items.size() + rects_.items.size() +
+           ellipses_.items.size() + polylines_.items.size();
+}
+
+ShapeStore::Kind ShapeStore::kind(ShapeHandle handle) const
+{
+    return slots_[handle.slot].kind;
+}
+
+ShapeStore::Line& ShapeStore::line(ShapeHandle handle)
+{
+    assert(contains(handle) && kind(handle) == kLine);
+    return lines_.items[slots_[handle.slot].index];
+}
+
+ShapeStore::Rect& ShapeStore::rect(ShapeHandle handle)
+{
+    assert(contains(handle) && kind(handle) == kRect);
+    return rects_.items[slots_[handle.slot].index];
+}
+
+ShapeStore::Ellipse& ShapeStore::ellipse(ShapeHandle handle)
+{
+    assert(contains(handle) && kind(handle) == kEllipse);
+    return ellipses_.items[slots_[handle.slot].index];
+}
+
+const ShapeStore::Line& ShapeStore::line(ShapeHandle handle) const
+{
+    assert(contains(handle) && kind(handle) == kLine);
+    return lines_.items[slots_[handle.slot].index];
+}
+
+const ShapeStore::Rect& ShapeStore::rect(ShapeHandle handle) const
+{
+    assert(contains(handle) && kind(handle) == kRect);
+    return rects_.items[slots_[handle.slot].index];
+}
+
+const ShapeStore::Ellipse& ShapeStore::ellipse(ShapeHandle handle) const
+{
+    assert(contains(handle) && kind(handle) == kEllipse);
+    return ellipses_.items[slots_[handle.slot].index];
+}
+
+const ShapeStore::Polyline& ShapeStore::polyline(ShapeHandle handle) const
+{
+    assert(contains(handle) && kind(handle) == kPolyline);
+    return polylines_.items[slots_[handle.slot].index];
+}
+
+std::span<const ImVec2> ShapeStore::points(const Polyline& polyline) const
+{
+    return { points_.data() + polyline.first, polyline.count };
+}
+
+std::span<const ShapeStore::Line> ShapeStore::lines() const
+{
+    return lines_.items;
+}
+
+std::span<const ShapeStore::Rect> ShapeStore::rects() const
+{
+    return rects_.items;
+}
+
+std::span<const ShapeStore::Ellipse> ShapeStore::ellipses() const
+{
+    return ellipses_.items;
+}
+
+std::span<const ShapeStore::Polyline> ShapeStore::polylines() const
+{
+    return polylines_.items;
+}
+
+std::span<const ShapeHandle> ShapeStore::handles(Kind kind) const
+{
+    switch (kind)
+    {
+        case kLine: return lines_.handles;
+        case kRect: return rects_.handles;
+        case kEllipse: return ellipses_.handles;
+        case kPolyline: return polylines_.handles;
+    }
+    return {};
+}
+
+bool ShapeStore::outline(
+    ShapeHandle handle,
+    std::vector<ImVec2>& points,
+    float tolerance) const
+{
+    points.clear();
+    switch (kind(handle))
+    {
+        case kLine:
+        {
+            const Line& l = line(handle);
+            points.assign({ l.start, l.end });
+            return false;
+        }
+        case kRect:
+        {
+            const Rect& r = rect(handle);
+            points.assign({ r.start,
+                            ImVec2(r.end.x, r.start.y),
+                            r.end,
+                            ImVec2(r.start.x, r.end.y) });
+            return true;
+        }
+        case kEllipse:
+        {
+            // A chord of n segments deviates by r (1 - cos(pi / n))
+            const Ellipse& e = ellipse(handle);
+            const float radius = std::max(e.radii.x, e.radii.y);
+            int segments = kMinEllipseSegments;
+            if (radius > tolerance)
+                segments = static_cast<int>(std::ceil(
+                    std::numbers::pi_v<float> /
+                    std::acos(1.0f - tolerance / radius)));
+            segments = std::clamp(
+                segments, kMinEllipseSegments, kMaxEllipseSegments);
+            points.reserve(segments);
+            for (int i = 0; i < segments; ++i)
+            {
+                const float angle =
+                    2 * std::numbers::pi_v<float> * i / segments;
+                points.emplace_back(
+                    e.center.x + e.radii.x * std::cos(angle),
+                    e.center.y + e.radii.y * std::sin(angle));
+            }
+            return true;
+        }
+        case kPolyline:
+        {
+            const Polyline& p = polyline(handle);
+            const std::span<const ImVec2> span = this->points(p);
+            points.assign(span.begin(), span.end());
+            return p.closed;
+        }
+    }
+    return false;
+}
+
+void ShapeStore::compact_points()
+{
+    if (dead_points_ * 2 < points_.size())
+        return;
+    std::vector<ImVec2> points;
+    points.reserve(points_.size() - dead_points_);
+    for (Polyline& polyline : polylines_.items)
+    {
+        const std::uint32_t first = static_cast<std::uint32_t>(points.size());
+        points.insert(
+            points.end(),
+            points_.begin() + polyline.first,
+            points_.begin() + polyline.first + polyline.count);
+        polyline.first = first;
+    }
+    points_ = std::move(points);
+    dead_points_ = 0;
+}
+}  // namespace USTC_CG
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <imgui.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace USTC_CG
+{
+// Reference to a shape of a ShapeStore. The generation tells a handle of a
+// removed shape from the handle of a newer shape reusing its slot.
+struct ShapeHandle
+{
+    static constexpr std::uint32_t kNone = ~0u;
+
+    std::uint32_t slot = kNone;
+    std::uint32_t generation = 0;
+
+    bool valid() const
+    {
+        return slot != kNone;
+    }
+    bool operator==(const ShapeHandle&) const = default;
+};
+
+// Geometry of many shapes, without one allocation or virtual call each.
+//
+// Every kind of shape has its own dense array, so loops over the lines,
+// the rects... run over contiguous plain structs; the points of all the
+// polylines share one array. A removed shape is replaced by the last one of
+// its array, and a table of slots maps the handles to the moving indices.
+// Shapes (shapes/*.h) stay the interface to create and edit a shape
+// interactively; they copy themselves in here when they are done.
+class ShapeStore
+{
+   public:
+    enum Kind
+    {
+        kLine = 0,
+        kRect = 1,
+        kEllipse = 2,
+        kPolyline = 3,
+    };
+
+    struct Line
+    {
+        ImVec2 start, end;
+    };
+    // Two opposite corners, in the order they were drawn
+    struct Rect
+    {
+        ImVec2 start, end;
+    };
+    struct Ellipse
+    {
+        ImVec2 center, radii;
+    };
+    // Points [first, first + count) of points()
+    struct Polyline
+    {
+        std::uint32_t first = 0, count = 0;
+        bool closed = false;
+    };
+
+    ShapeHandle add(const Line& line);
+    ShapeHandle add(const Rect& rect);
+    ShapeHandle add(const Ellipse& ellipse);
+    ShapeHandle add_polyline(std::span<const ImVec2> points, bool closed);
+    void remove(ShapeHandle handle);
+    void clear();
+    // Replace the content by whole arrays, e.g. read from a file; the
+    // polylines index `points`. Their handles are slots 0, 1... in the
+    // order lines, rects, ellipses, polylines.
+    void assign(
+        std::span<const Line> lines,
+        std::span<const Rect> rects,
+        std::span<const Ellipse> ellipses,
+        std::span<const Polyline> polylines,
+        std::span<const ImVec2> points);
+    // Room for `count` more shapes of a kind, and `points` more points
+    void reserve(Kind kind, std::size_t count, std::size_t points = 0);
+
+    bool contains(ShapeHandle handle) const;
+    std::size_t size() const;
+    Kind kind(ShapeHandle handle) const;
+    // The shape of a handle, which must be of that kind
+    Line& line(ShapeHandle handle);
+    Rect& rect(ShapeHandle handle);
+    Ellipse& ellipse(ShapeHandle handle);
+    const Line& line(ShapeHandle handle) const;
+    const Rect& rect(ShapeHandle handle) const;
+    const Ellipse& ellipse(ShapeHandle handle) const;
+    const Polyline& polyline(ShapeHandle handle) const;
+    std::span<const ImVec2> points(const Polyline& polyline) const;
+
+    // Every shape of a kind, and their handles in the same order
+    std::span<const Line> lines() const;
+    std::span<const Rect> rects() const;
+    std::span<const Ellipse> ellipses() const;
+    std::span<const Polyline> polylines() const;
+    std::span<const ShapeHandle> handles(Kind kind) const;
+
+    // Replace `points` by the shape as a polyline in canvas coordinates;
+    // returns whether it is closed. Ellipses get enough points for an error
+    // below `tolerance`.
+    bool outline(
+        ShapeHandle handle,
+        std::vector<ImVec2>& points,
+        float tolerance = 0.25f) const;
+
+   private:
+    struct Slot
+    {
+        Kind kind = kLine;
+        std::uint32_t index = 0;
+        std::uint32_t generation = 0;
+        bool used = false;
+    };
+    template <typename T>
+    struct Array
+    {
+        std::vector<T> items;
+        std::vector<ShapeHandle> handles;
+    };
+
+    template <typename T>
+    ShapeHandle insert(Kind kind, Array<T>& array, const T& item);
+    template <typename T>
+    void erase(Array<T>& array, std::uint32_t index);
+    template <typename T>
+    void assign(
+        Kind kind,
+        Array<T>& array,
+        std::span<const T> items,
+        std::uint32_t& slot);
+    // Drop the points of removed polylines once they are most of the array
+    void compact_points();
+
+    std::vector<Slot> slots_;
+    std::vector<std::uint32_t> free_slots_;
+    Array<Line> lines_;
+    Array<Rect> rects_;
+    Array<Ellipse> ellipses_;
+    Array<Polyline> polylines_;
+    std::vector<ImVec2> points_;
+    std::size_t dead_points_ = 0;
+};
+}  // namespace USTC_CG
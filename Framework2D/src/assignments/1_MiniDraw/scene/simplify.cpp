@@ -0,0 +1,69 @@
+#include "scene/simplify.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace USTC_CG
+{
+namespace
+{
+float distance2_to_segment(ImVec2 p, ImVec2 a, ImVec2 b)
+{
+    const float dx = b.x - a.x, dy = b.y - a.y;
+    const float length2 = dx * dx + dy * dy;
+    float t = length2 > 0 ? ((p.x - a.x) * dx + (p.y - a.y) * dy) / length2
+                          : 0.0f;
+    t = std::clamp(t, 0.0f, 1.0f);
+    const float ex = p.x - (a.x + t * dx), ey = p.y - (a.y + t * dy);
+    return ex * ex + ey * ey;
+}
+}  // namespace
+
+void simplify_polyline(
+    std::span<const ImVec2> points,
+    float tolerance,
+    std::vector<std::uint32_t>& kept)
+{
+    kept.clear();
+    const auto count = static_cast<std::uint32_t>(points.size());
+    if (count <= 2)
+    {
+        for (std::uint32_t i = 0; i < count; ++i)
+            kept.push_back(i);
+        return;
+    }
+    const float tolerance2 = tolerance * tolerance;
+
+    // Ranges (first, last) still to split; the farthest point of a range
+    // from its chord is kept if it is beyond the tolerance
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> ranges = {
+        { 0, count - 1 }
+    };
+    kept.push_back(0);
+    kept.push_back(count - 1);
+    while (!ranges.empty())
+    {
+        const auto [first, last] = ranges.back();
+        ranges.pop_back();
+        float farthest2 = tolerance2;
+        std::uint32_t farthest = 0;
+        for (std::uint32_t i = first + 1; i < last; ++i)
+        {
+            const float d2 =
+                distance2_to_segment(points[i], points[first], points[last]);
+            if (d2 > farthest2)
+            {
+                farthest2 = d2;
+                farthest = i;
+            }
+        }
+        if (farthest == 0)
+            continue;
+        kept.push_back(farthest);
+        ranges.push_back({ first, farthest });
+        ranges.push_back({ farthest, last });
+    }
+    std::sort(kept.begin(), kept.end());
+}
+}  // namespace USTC_CG
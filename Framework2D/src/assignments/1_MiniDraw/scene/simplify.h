@@ -0,0 +1,19 @@
+#pragma once
+
+#include <imgui.h>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace USTC_CG
+{
+// Ramer-Douglas-Peucker: replace `kept` by the indices of the points of a
+// polyline to keep so that no dropped point is farther than `tolerance`
+// from the simplified polyline. The first and last points are always kept.
+// O(n log n) on typical strokes, without recursion.
+void simplify_polyline(
+    std::span<const ImVec2> points,
+    float tolerance,
+    std::vector<std::uint32_t>& kept);
+}  // namespace USTC_CG
@@ -0,0 +1,51 @@
+#include "ellipse.h"
+
+#include <imgui.h>
+
+#include <cmath>
+
+#include "scene/shape_store.h"
+
+namespace USTC_CG
+{
+// Draw the ellipse using ImGui
+void Ellipse::draw(const Config& config) const
+{
+    ImDrawList* draw_list = ImGui::GetWindowDrawList();
+
+    draw_list->AddEllipse(
+        ImVec2(
+            config.bias[0] +
+                (start_point_x_ + end_point_x_) / 2 * config.scale,
+            config.bias[1] +
+                (start_point_y_ + end_point_y_) / 2 * config.scale),
+        ImVec2(
+            std::abs(end_point_x_ - start_point_x_) / 2 * config.scale,
+            std::abs(end_point_y_ - start_point_y_) / 2 * config.scale),
+        IM_COL32(
+            config.line_color[0],
+            config.line_color[1],
+            config.line_color[2],
+            config.line_color[3]),
+        0.f,  // No rotation
+        0,    // Automatic number of segments
+        config.line_thickness * config.scale);
+}
+
+ShapeHandle Ellipse::add_to(ShapeStore& store) const
+{
+    return store.add(ShapeStore::Ellipse{
+        ImVec2(
+            (start_point_x_ + end_point_x_) / 2,
+            (start_point_y_ + end_point_y_) / 2),
+        ImVec2(
+            std::abs(end_point_x_ - start_point_x_) / 2,
+            std::abs(end_point_y_ - start_point_y_) / 2) });
+}
+
+void Ellipse::update(float x, float y)
+{
+    end_point_x_ = x;
+    end_point_y_ = y;
+}
+}  // namespace USTC_CG
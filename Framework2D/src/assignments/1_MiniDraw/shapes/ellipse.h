@@ -0,0 +1,40 @@
+#pragma once
+
+#include "shape.h"
+
+namespace USTC_CG
+{
+class Ellipse : public Shape
+{
+   public:
+    Ellipse() = default;
+
+    // Initialize an ellipse inscribed in the box of two opposite corners
+    Ellipse(
+        float start_point_x,
+        float start_point_y,
+        float end_point_x,
+        float end_point_y)
+        : start_point_x_(start_point_x),
+          start_point_y_(start_point_y),
+          end_point_x_(end_point_x),
+          end_point_y_(end_point_y)
+    {
+    }
+
+    virtual ~Ellipse() = default;
+
+    // Overrides draw function to implement ellipse-specific drawing logic
+    void draw(const Config& config) const override;
+    ShapeHandle add_to(ShapeStore& store) const override;
+
+    // Overrides Shape's update function to move the second corner of the
+    // box during interaction
+    void update(float x, float y) override;
+
+   private:
+    // Opposite corners of the bounding box of the ellipse
+    float start_point_x_ = 0.0f, start_point_y_ = 0.0f;
+    float end_point_x_ = 0.0f, end_point_y_ = 0.0f;
+};
+}  // namespace USTC_CG
@@ -0,0 +1,70 @@
+#include "freehand.h"
+
+#include "scene/shape_store.h"
+#include "scene/simplify.h"
+
+namespace USTC_CG
+{
+Freehand::Freehand(float x, float y, float tolerance) : tolerance_(tolerance)
+{
+    settled_.emplace_back(x, y);
+    tail_.emplace_back(x, y);
+}
+
+// Draw the stroke using ImGui
+void Freehand::draw(const Config& config) const
+{
+    ImDrawList* draw_list = ImGui::GetWindowDrawList();
+
+    std::vector<ImVec2> screen = points();
+    for (ImVec2& p : screen)
+        p = ImVec2(
+            config.bias[0] + p.x * config.scale,
+            config.bias[1] + p.y * config.scale);
+    draw_list->AddPolyline(
+        screen.data(),
+        static_cast<int>(screen.size()),
+        IM_COL32(
+            config.line_color[0],
+            config.line_color[1],
+            config.line_color[2],
+            config.line_color[3]),
+        ImDrawFlags_None,
+        config.line_thickness * config.scale);
+}
+
+ShapeHandle Freehand::add_to(ShapeStore& store) const
+{
+    return store.add_polyline(points(), false);
+}
+
+void Freehand::update(float x, float y)
+{
+    // Positions closer than the tolerance add nothing to the shape
+    const ImVec2& last = tail_.back();
+    const float dx = x - last.x, dy = y - last.y;
+    if (dx * dx + dy * dy <= tolerance_ * tolerance_)
+        return;
+    tail_.emplace_back(x, y);
+
+    simplify_polyline(tail_, tolerance_, kept_);
+    if (kept_.size() < 4)
+        return;
+    // Later positions may still change the last two kept points, not the
+    // ones before
+    const std::size_t settled = kept_.size() - 2;
+    for (std::size_t k = 1; k < settled; ++k)
+        settled_.push_back(tail_[kept_[k]]);
+    tail_.erase(tail_.begin(), tail_.begin() + kept_[settled - 1]);
+}
+
+std::vector<ImVec2> Freehand::points() const
+{
+    std::vector<ImVec2> points = settled_;
+    std::vector<std::uint32_t> kept;
+    simplify_polyline(tail_, tolerance_, kept);
+    for (std::size_t k = 1; k < kept.size(); ++k)
+        points.push_back(tail_[kept[k]]);
+    return points;
+}
+}  // namespace USTC_CG
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <imgui.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "shape.h"
+
+namespace USTC_CG
+{
+// A stroke following the mouse, simplified while it is drawn.
+//
+// Raw mouse positions only accumulate since the last settled point of the
+// simplified stroke: each new position runs Ramer-Douglas-Peucker on that
+// tail alone, and the points of the result before its last two are final.
+// A stroke of thousands of positions thus keeps a few dozen points, and the
+// work per position stays bounded.
+class Freehand : public Shape
+{
+   public:
+    // Start a stroke at (x, y). Dropped points are at most `tolerance`
+    // away from the stroke, in canvas units.
+    Freehand(float x, float y, float tolerance = 0.5f);
+
+    virtual ~Freehand() = default;
+
+    // Overrides draw function to implement stroke-specific drawing logic
+    void draw(const Config& config) const override;
+    ShapeHandle add_to(ShapeStore& store) const override;
+
+    // Overrides Shape's update function to extend the stroke to (x, y)
+    void update(float x, float y) override;
+
+   private:
+    // The simplified stroke, then the raw positions after it
+    std::vector<ImVec2> points() const;
+
+    float tolerance_;
+    // Settled points; tail_ starts at the last one
+    std::vector<ImVec2> settled_;
+    std::vector<ImVec2> tail_;
+    std::vector<std::uint32_t> kept_;
+};
+}  // namespace USTC_CG
@@ -2,6 +2,8 @@
 
 #include <imgui.h>
 
+#include "scene/shape_store.h"
+
 namespace USTC_CG
 {
 // Draw the line using ImGui
@@ -11,14 +13,24 @@ void Line::draw(const Config& config) const
 
     draw_list->AddLine(
         ImVec2(
-            config.bias[0] + start_point_x_, config.bias[1] + start_point_y_),
-        ImVec2(config.bias[0] + end_point_x_, config.bias[1] + end_point_y_),
+            config.bias[0] + start_point_x_ * config.scale,
+            config.bias[1] + start_point_y_ * config.scale),
+        ImVec2(
+            config.bias[0] + end_point_x_ * config.scale,
+            config.bias[1] + end_point_y_ * config.scale),
         IM_COL32(
             config.line_color[0],
             config.line_color[1],
             config.line_color[2],
             config.line_color[3]),
-        config.line_thickness);
+        config.line_thickness * config.scale);
+}
+
+ShapeHandle Line::add_to(ShapeStore& store) const
+{
+    return store.add(ShapeStore::Line{
+        ImVec2(start_point_x_, start_point_y_),
+        ImVec2(end_point_x_, end_point_y_) });
 }
 
 void Line::update(float x, float y)
@@ -26,6 +26,7 @@ class Line : public Shape
 
     // Overrides draw function to implement line-specific drawing logic
     void draw(const Config& config) const override;
+    ShapeHandle add_to(ShapeStore& store) const override;
 
     // Overrides Shape's update function to adjust the end point during
     // interaction
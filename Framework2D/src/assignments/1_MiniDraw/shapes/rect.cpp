@@ -2,6 +2,8 @@
 
 #include <imgui.h>
 
+#include "scene/shape_store.h"
+
 namespace USTC_CG
 {
 // Draw the rectangle using ImGui
@@ -11,8 +13,11 @@ void Rect::draw(const Config& config) const
 
     draw_list->AddRect(
         ImVec2(
-            config.bias[0] + start_point_x_, config.bias[1] + start_point_y_),
-        ImVec2(config.bias[0] + end_point_x_, config.bias[1] + end_point_y_),
+            config.bias[0] + start_point_x_ * config.scale,
+            config.bias[1] + start_point_y_ * config.scale),
+        ImVec2(
+            config.bias[0] + end_point_x_ * config.scale,
+            config.bias[1] + end_point_y_ * config.scale),
         IM_COL32(
             config.line_color[0],
             config.line_color[1],
@@ -20,7 +25,14 @@ void Rect::draw(const Config& config) const
             config.line_color[3]),
         0.f,  // No rounding of corners
         ImDrawFlags_None,
-        config.line_thickness);
+        config.line_thickness * config.scale);
+}
+
+ShapeHandle Rect::add_to(ShapeStore& store) const
+{
+    return store.add(ShapeStore::Rect{
+        ImVec2(start_point_x_, start_point_y_),
+        ImVec2(end_point_x_, end_point_y_) });
 }
 
 void Rect::update(float x, float y)
@@ -27,6 +27,7 @@ class Rect : public Shape
     // Draws the rectangle on the screen
     // Overrides draw function to implement rectangle-specific drawing logic
     void draw(const Config& config) const override;
+    ShapeHandle add_to(ShapeStore& store) const override;
 
     // Overrides Shape's update function to adjust the rectangle size during
     // interaction
@@ -2,6 +2,9 @@
 
 namespace USTC_CG
 {
+class ShapeStore;
+struct ShapeHandle;
+
 class Shape
 {
    public:
@@ -10,6 +13,9 @@ class Shape
     {
         // Offset to convert canvas position to screen position
         float bias[2] = { 0.f, 0.f };
+        // Zoom: screen position = canvas position * scale + bias. Line
+        // widths are in canvas units too.
+        float scale = 1.0f;
         // Line color in RGBA format
         unsigned char line_color[4] = { 255, 0, 0, 255 };
         float line_thickness = 2.0f;
@@ -31,6 +37,15 @@ class Shape
      * screen.
      */
     virtual void draw(const Config& config) const = 0;
+    /**
+     * Copies the geometry of the shape into a store.
+     * Shapes are only edited through this interface; once done, the canvas
+     * keeps them as plain data in its ShapeStore.
+     *
+     * @param store The store receiving the shape.
+     * @return The handle of the shape in the store.
+     */
+    virtual ShapeHandle add_to(ShapeStore& store) const = 0;
     /**
      * Updates the state of the shape.
      * This function allows for dynamic modification of the shape, in response
@@ -0,0 +1,363 @@
+// Headless batch front end of the image warping pipeline.
+//
+// Single job:
+//   warping_cli -m <method> -i <image> [-p <points.txt>] -o <output>
+// Directory of jobs (run in parallel):
+//   warping_cli -m <method> -d <job_dir> -o <output_dir>
+// where the method is fisheye, idw, rbf or neural.
+// In directory mode every image <name>.png/.jpg/.bmp in job_dir is a job, its
+// control pairs are read from <name>.txt next to it, and the result is written
+// to <output_dir>/<name>.png.
+//
+// Both modes accept -s <forward|nearest|bilinear|bicubic> to choose the
+// resampling: forward scatters the source pixels, the others use inverse
+// mapping with the given interpolation (default: bilinear).
+// -g <spacing> evaluates the map on a lattice of that spacing and interpolates
+// in between, refining where the error exceeds -t <tolerance> pixels.
+// With -s forward, the holes are filled from the -k <k> nearest warped pixels
+// bordering them (default 4, 0 leaves them black).
+// -f <tol> sums the far pairs of IDW through a quadtree, within tol pixels
+// (idw only: the other methods reject it).
+// -n <model> (neural only) loads the network from <model> if it exists,
+// otherwise trains it on the pairs and saves it there (single jobs only).
+//
+// Control point files hold one pair per line: start_x start_y end_x end_y.
+// idw, rbf and neural jobs without pairs fail (unless -n loads a model).
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "common/image_io.h"
+#include "common/tile_scheduler.h"
+#include "core/hole_filling.h"
+#include "core/warping_pipeline.h"
+#include "warper/neural_warper.h"
+
+namespace
+{
+namespace fs = std::filesystem;
+using namespace USTC_CG;
+
+struct Job
+{
+    std::string input, points, output;
+};
+
+// How the warped image is produced.
+struct Sampling
+{
+    bool inverse = true;
+    Interpolation interpolation = kBilinear;
+    int grid_spacing = 0;
+    float grid_tolerance = 0.5f;
+    float far_field = 0;
+    int hole_neighbors = 4;
+    std::string model;
+};
+
+bool parse_sampling(const std::string& name, Sampling& sampling)
+{
+    if (name == "forward")
+        sampling.inverse = false;
+    else if (name == "nearest")
+        sampling.interpolation = kNearest;
+    else if (name == "bilinear")
+        sampling.interpolation = kBilinear;
+    else if (name == "bicubic")
+        sampling.interpolation = kBicubic;
+    else
+        return false;
+    return true;
+}
+
+struct JobTiming
+{
+    bool ok = false;
+    std::string error;
+    double load_ms = 0, fit_ms = 0, warp_ms = 0, save_ms = 0;
+};
+
+double elapsed_ms(std::chrono::steady_clock::time_point& start)
+{
+    auto now = std::chrono::steady_clock::now();
+    double ms = std::chrono::duration<double, std::milli>(now - start).count();
+    start = now;
+    return ms;
+}
+
+JobTiming run_job(
+    const Job& job,
+    const std::string& method,
+    const Sampling& sampling)
+{
+    JobTiming timing;
+    auto clock = std::chrono::steady_clock::now();
+
+    std::shared_ptr<Image> image = load_image(job.input, 4);
+    if (!image)
+    {
+        timing.error = "cannot load image";
+        return timing;
+    }
+    std::vector<Warper::Point> start_points, end_points;
+    if (!job.points.empty() &&
+        !load_control_points(job.points, start_points, end_points))
+    {
+        timing.error = "cannot read control points " + job.points;
+        return timing;
+    }
+    // Without pairs idw, rbf and a neural network to train are the identity:
+    // fail rather than write the input back as a result
+    const bool loads_model = method == "neural" && !sampling.model.empty() &&
+                             fs::exists(sampling.model);
+    if (start_points.empty() && method != "fisheye" && !loads_model)
+    {
+        timing.error = job.points.empty()
+                           ? "no control points (-p, or <name>.txt next to "
+                             "the image)"
+                           : "no control points in " + job.points;
+        return timing;
+    }
+    timing.load_ms = elapsed_ms(clock);
+
+    std::unique_ptr<Warper> warper;
+    if (method == "neural" && !sampling.model.empty())
+    {
+        auto neural = std::make_unique<NeuralWarper>();
+        if (fs::exists(sampling.model))
+        {
+            // Without pairs there is no inverse network: a loaded model is
+            // applied by forward warping.
+            if (!neural->load(sampling.model))
+            {
+                timing.error = "cannot read model " + sampling.model;
+                return timing;
+            }
+        }
+        else
+        {
+            neural->set_control_points(start_points, end_points);
+            if (!neural->save(sampling.model))
+            {
+                timing.error = "cannot write model " + sampling.model;
+                return timing;
+            }
+        }
+        warper = std::move(neural);
+    }
+    else
+    {
+        warper = create_warper(
+            method, image->width(), image->height(), start_points, end_points);
+    }
+    warper->set_grid_cache(sampling.grid_spacing, sampling.grid_tolerance);
+    warper->set_far_field(sampling.far_field);
+    auto inverse = sampling.inverse ? warper->make_inverse() : nullptr;
+    timing.fit_ms = elapsed_ms(clock);
+
+    Image result;
+    if (inverse)
+    {
+        result = inverse_warp_image(*image, *inverse, sampling.interpolation);
+    }
+    else
+    {
+        std::vector<unsigned char> written;
+        result = warp_image(*image, *warper, &written);
+        if (sampling.hole_neighbors > 0)
+            fill_holes(result, written, sampling.hole_neighbors);
+    }
+    timing.warp_ms = elapsed_ms(clock);
+
+    if (!save_image(result, job.output))
+    {
+        timing.error = "cannot write " + job.output;
+        return timing;
+    }
+    timing.save_ms = elapsed_ms(clock);
+    timing.ok = true;
+    return timing;
+}
+
+void print_timing(const Job& job, const JobTiming& timing)
+{
+    if (!timing.ok)
+    {
+        std::fprintf(
+            stderr,
+            "[failed] %s: %s\n",
+            job.input.c_str(),
+            timing.error.c_str());
+        return;
+    }
+    std::printf(
+        "[done] %s -> %s  load %.1f ms, fit %.1f ms, warp %.1f ms, save %.1f "
+        "ms\n",
+        job.input.c_str(),
+        job.output.c_str(),
+        timing.load_ms,
+        timing.fit_ms,
+        timing.warp_ms,
+        timing.save_ms);
+}
+
+bool is_image_file(const fs::path& path)
+{
+    std::string ext = path.extension().string();
+    for (auto& c : ext)
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return ext == ".png" || ext == ".jpg" || ext == ".jpeg" || ext == ".bmp";
+}
+
+std::vector<Job> collect_jobs(
+    const std::string& job_dir,
+    const std::string& output_dir)
+{
+    std::vector<Job> jobs;
+    for (const auto& entry : fs::directory_iterator(job_dir))
+    {
+        if (!entry.is_regular_file() || !is_image_file(entry.path()))
+            continue;
+        Job job;
+        job.input = entry.path().string();
+        fs::path points = entry.path();
+        points.replace_extension(".txt");
+        if (fs::exists(points))
+            job.points = points.string();
+        job.output =
+            (fs::path(output_dir) / entry.path().stem()).string() + ".png";
+        jobs.push_back(job);
+    }
+    // Deterministic report order
+    std::sort(
+        jobs.begin(),
+        jobs.end(),
+        [](const Job& a, const Job& b) { return a.input < b.input; });
+    return jobs;
+}
+
+void print_usage(const char* program)
+{
+    std::fprintf(
+        stderr,
+        "Usage:\n"
+        "  %s -m <method> -i <image> [-p <points.txt>] -o <output>\n"
+        "  %s -m <method> -d <job_dir> -o <output_dir>\n"
+        "Methods: fisheye, idw, rbf, neural\n"
+        "Options:\n"
+        "  -s <forward|nearest|bilinear|bicubic>  resampling (bilinear)\n"
+        "  -g <spacing>    evaluate the map on a coarse lattice (off)\n"
+        "  -t <tolerance>  lattice refinement tolerance in pixels (0.5)\n"
+        "  -f <tol>        idw: far-field tolerance in pixels (0: exact)\n"
+        "  -k <k>          forward warps: fill holes from k neighbours (4)\n"
+        "  -n <model>      neural: load the network, or train and save it\n",
+        program,
+        program);
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    std::string method = "idw", input, points, output, job_dir;
+    Sampling sampling;
+    bool valid_sampling = true;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (!std::strcmp(argv[i], "-m"))
+            method = argv[i + 1];
+        else if (!std::strcmp(argv[i], "-i"))
+            input = argv[i + 1];
+        else if (!std::strcmp(argv[i], "-p"))
+            points = argv[i + 1];
+        else if (!std::strcmp(argv[i], "-o"))
+            output = argv[i + 1];
+        else if (!std::strcmp(argv[i], "-d"))
+            job_dir = argv[i + 1];
+        else if (!std::strcmp(argv[i], "-s"))
+            valid_sampling = parse_sampling(argv[i + 1], sampling);
+        else if (!std::strcmp(argv[i], "-g"))
+            sampling.grid_spacing = std::atoi(argv[i + 1]);
+        else if (!std::strcmp(argv[i], "-t"))
+            sampling.grid_tolerance =
+                static_cast<float>(std::atof(argv[i + 1]));
+        else if (!std::strcmp(argv[i], "-f"))
+            sampling.far_field = static_cast<float>(std::atof(argv[i + 1]));
+        else if (!std::strcmp(argv[i], "-k"))
+            sampling.hole_neighbors = std::atoi(argv[i + 1]);
+        else if (!std::strcmp(argv[i], "-n"))
+            sampling.model = argv[i + 1];
+        else
+        {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    const auto probe = create_warper(method, 1, 1, {}, {});
+    if (output.empty() || input.empty() == job_dir.empty() ||
+        !valid_sampling || !probe ||
+        (!sampling.model.empty() && !job_dir.empty()))
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (sampling.far_field > 0 && !probe->supports_far_field())
+    {
+        std::fprintf(
+            stderr, "-f: %s has no far-field backend\n", method.c_str());
+        return 1;
+    }
+
+    try
+    {
+        if (!input.empty())
+        {
+            Job job{ input, points, output };
+            JobTiming timing = run_job(job, method, sampling);
+            print_timing(job, timing);
+            return timing.ok ? 0 : 1;
+        }
+
+        fs::create_directories(output);
+        std::vector<Job> jobs = collect_jobs(job_dir, output);
+        std::vector<JobTiming> timings(jobs.size());
+        std::mutex print_mutex;
+        auto start = std::chrono::steady_clock::now();
+        // One job per task; the warps inside a job then run serially on the
+        // worker that picked the job.
+        TileScheduler::instance().parallel_for(
+            jobs.size(),
+            [&](std::size_t begin, std::size_t end)
+            {
+                for (std::size_t i = begin; i < end; ++i)
+                {
+                    timings[i] = run_job(jobs[i], method, sampling);
+                    std::lock_guard<std::mutex> lock(print_mutex);
+                    print_timing(jobs[i], timings[i]);
+                }
+            },
+            1);
+        int failed = static_cast<int>(std::count_if(
+            timings.begin(),
+            timings.end(),
+            [](const JobTiming& t) { return !t.ok; }));
+        std::printf(
+            "%zu jobs (%d failed) in %.1f ms on %d threads\n",
+            jobs.size(),
+            failed,
+            elapsed_ms(start),
+            TileScheduler::instance().num_threads());
+        return failed == 0 ? 0 : 1;
+    }
+    catch (const std::exception& e)
+    {
+        std::fprintf(stderr, "Error: %s\n", e.what());
+        return 1;
+    }
+}
@@ -0,0 +1,315 @@
+#include "core/hole_filling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <utility>
+
+#include "common/tile_scheduler.h"
+
+namespace USTC_CG
+{
+namespace
+{
+constexpr int kMaxNeighbors = 16;
+
+struct Sample
+{
+    int x, y;
+};
+
+// The k nearest samples found so far, sorted by distance.
+struct Neighbors
+{
+    int count = 0;
+    int index[kMaxNeighbors];
+    std::int64_t distance2[kMaxNeighbors];
+};
+
+// Balanced 2D kd-tree stored implicitly in the permuted sample array: the
+// node over [begin, end) splits at its median mid = (begin + end) / 2, with
+// the children [begin, mid) and [mid + 1, end). Ranges of at most kLeafSize
+// samples are leaves.
+class PixelKdTree
+{
+   public:
+    explicit PixelKdTree(std::vector<Sample> samples)
+        : samples_(std::move(samples)),
+          axis_(samples_.size(), 0)
+    {
+        build();
+    }
+
+    const Sample& sample(int index) const
+    {
+        return samples_[index];
+    }
+
+    // The k nearest samples of (x, y) within squared distance `bound`.
+    void nearest(int x, int y, int k, std::int64_t bound, Neighbors& result)
+        const
+    {
+        result.count = 0;
+        search(0, static_cast<int>(samples_.size()), x, y, k, bound, result);
+    }
+
+   private:
+    static constexpr int kLeafSize = 8;
+
+    // Split the top levels one level at a time with the nodes of a level in
+    // parallel, then build the remaining subtrees one per task.
+    void build()
+    {
+        TileScheduler& scheduler = TileScheduler::instance();
+        const std::size_t target =
+            4 * static_cast<std::size_t>(scheduler.num_threads());
+        std::vector<std::pair<int, int>> level{
+            { 0, static_cast<int>(samples_.size()) }
+        };
+        while (!level.empty() && level.size() < target)
+        {
+            scheduler.parallel_for(
+                level.size(),
+                [&](std::size_t begin, std::size_t end)
+                {
+                    for (std::size_t i = begin; i < end; ++i)
+                        split(level[i].first, level[i].second);
+                },
+                1);
+            std::vector<std::pair<int, int>> next;
+            for (const auto& [begin, end] : level)
+            {
+                if (end - begin <= kLeafSize)
+                    continue;
+                const int mid = (begin + end) / 2;
+                next.emplace_back(begin, mid);
+                next.emplace_back(mid + 1, end);
+            }
+            level = std::move(next);
+        }
+        scheduler.parallel_for(
+            level.size(),
+            [&](std::size_t begin, std::size_t end)
+            {
+                for (std::size_t i = begin; i < end; ++i)
+                    build(level[i].first, level[i].second);
+            },
+            1);
+    }
+
+    void build(int begin, int end)
+    {
+        if (end - begin <= kLeafSize)
+            return;
+        split(begin, end);
+        const int mid = (begin + end) / 2;
+        build(begin, mid);
+        build(mid + 1, end);
+    }
+
+    // Partition [begin, end) around its median along the wider axis.
+    void split(int begin, int end)
+    {
+        if (end - begin <= kLeafSize)
+            return;
+        int min_x = std::numeric_limits<int>::max(), max_x = -min_x;
+        int min_y = min_x, max_y = max_x;
+        for (int i = begin; i < end; ++i)
+        {
+            min_x = std::min(min_x, samples_[i].x);
+            max_x = std::max(max_x, samples_[i].x);
+            min_y = std::min(min_y, samples_[i].y);
+            max_y = std::max(max_y, samples_[i].y);
+        }
+        const int mid = (begin + end) / 2;
+        const bool along_y = max_y - min_y > max_x - min_x;
+        std::nth_element(
+            samples_.begin() + begin,
+            samples_.begin() + mid,
+            samples_.begin() + end,
+            [along_y](const Sample& a, const Sample& b)
+            { return along_y ? a.y < b.y : a.x < b.x; });
+        axis_[mid] = along_y;
+    }
+
+    void search(
+        int begin,
+        int end,
+        int x,
+        int y,
+        int k,
+        std::int64_t& bound,
+        Neighbors& result) const
+    {
+        if (end - begin <= kLeafSize)
+        {
+            for (int i = begin; i < end; ++i)
+                consider(i, x, y, k, bound, result);
+            return;
+        }
+        const int mid = (begin + end) / 2;
+        consider(mid, x, y, k, bound, result);
+        const std::int64_t diff =
+            axis_[mid] ? y - samples_[mid].y : x - samples_[mid].x;
+        // The side of the query point first, the other one if the splitting
+        // line is within the bound
+        if (diff < 0)
+        {
+            search(begin, mid, x, y, k, bound, result);
+            if (diff * diff <= bound)
+                search(mid + 1, end, x, y, k, bound, result);
+        }
+        else
+        {
+            search(mid + 1, end, x, y, k, bound, result);
+            if (diff * diff <= bound)
+                search(begin, mid, x, y, k, bound, result);
+        }
+    }
+
+    void consider(
+        int index,
+        int x,
+        int y,
+        int k,
+        std::int64_t& bound,
+        Neighbors& result) const
+    {
+        const std::int64_t dx = x - samples_[index].x;
+        const std::int64_t dy = y - samples_[index].y;
+        const std::int64_t d2 = dx * dx + dy * dy;
+        if (d2 > bound)
+            return;
+        // Insertion into the sorted list, dropping the farthest when full
+        int i = std::min(result.count, k - 1);
+        for (; i > 0 && result.distance2[i - 1] > d2; --i)
+        {
+            result.index[i] = result.index[i - 1];
+            result.distance2[i] = result.distance2[i - 1];
+        }
+        result.index[i] = index;
+        result.distance2[i] = d2;
+        result.count = std::min(result.count + 1, k);
+        if (result.count == k)
+            bound = result.distance2[k - 1];
+    }
+
+    std::vector<Sample> samples_;
+    std::vector<unsigned char> axis_;  // 1 when the node at mid splits in y
+};
+
+// Written pixels with an unwritten 4-neighbour, collected in parallel by
+// bands of rows.
+std::vector<Sample> collect_boundary(
+    int width,
+    int height,
+    const std::vector<unsigned char>& written)
+{
+    constexpr int kBandRows = 64;
+    const int band_count = (height + kBandRows - 1) / kBandRows;
+    std::vector<std::vector<Sample>> bands(band_count);
+    auto hole = [&](int x, int y)
+    {
+        return x >= 0 && y >= 0 && x < width && y < height &&
+               !written[static_cast<std::size_t>(y) * width + x];
+    };
+    TileScheduler::instance().parallel_for(
+        band_count,
+        [&](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t band = begin; band < end; ++band)
+            {
+                const int y0 = static_cast<int>(band) * kBandRows;
+                const int y1 = std::min(y0 + kBandRows, height);
+                for (int y = y0; y < y1; ++y)
+                    for (int x = 0; x < width; ++x)
+                        if (!hole(x, y) &&
+                            (hole(x - 1, y) || hole(x + 1, y) ||
+                             hole(x, y - 1) || hole(x, y + 1)))
+                            bands[band].push_back({ x, y });
+            }
+        },
+        1);
+    std::vector<Sample> samples;
+    for (const auto& band : bands)
+        samples.insert(samples.end(), band.begin(), band.end());
+    return samples;
+}
+}  // namespace
+
+void fill_holes(
+    Image& image,
+    const std::vector<unsigned char>& written,
+    int k,
+    float max_distance)
+{
+    const int width = image.width();
+    const int height = image.height();
+    const int channels = std::min(image.channels(), 3);
+    k = std::clamp(k, 1, kMaxNeighbors);
+    if (written.size() != static_cast<std::size_t>(width) * height)
+        return;
+
+    std::vector<Sample> samples = collect_boundary(width, height, written);
+    if (samples.empty())
+        return;
+    const PixelKdTree tree(std::move(samples));
+
+    const std::int64_t max_distance2 =
+        max_distance > 0
+            ? static_cast<std::int64_t>(std::floor(
+                  static_cast<double>(max_distance) * max_distance))
+            : std::numeric_limits<std::int64_t>::max();
+
+    TileScheduler::instance().parallel_for_tiles(
+        width,
+        height,
+        [&](const Tile& tile)
+        {
+            // Batched queries: the k neighbours of the previous hole pixel of
+            // the tile are at least k samples within the largest of their
+            // distances to the current one, which bounds its search.
+            Neighbors neighbors;
+            for (int y = tile.y0; y < tile.y1; ++y)
+            {
+                for (int x = tile.x0; x < tile.x1; ++x)
+                {
+                    if (written[static_cast<std::size_t>(y) * width + x])
+                        continue;
+                    std::int64_t bound = max_distance2;
+                    if (neighbors.count == k)
+                    {
+                        std::int64_t seed = 0;
+                        for (int i = 0; i < k; ++i)
+                        {
+                            const Sample& s = tree.sample(neighbors.index[i]);
+                            const std::int64_t dx = x - s.x, dy = y - s.y;
+                            seed = std::max(seed, dx * dx + dy * dy);
+                        }
+                        bound = std::min(bound, seed);
+                    }
+                    tree.nearest(x, y, k, bound, neighbors);
+                    if (neighbors.count == 0)
+                        continue;
+
+                    float sum[3] = { 0, 0, 0 };
+                    float weight_sum = 0;
+                    for (int i = 0; i < neighbors.count; ++i)
+                    {
+                        const Sample& s = tree.sample(neighbors.index[i]);
+                        const float weight =
+                            1.0f / static_cast<float>(neighbors.distance2[i]);
+                        for (int c = 0; c < channels; ++c)
+                            sum[c] += weight * image.at_unchecked(s.x, s.y, c);
+                        weight_sum += weight;
+                    }
+                    for (int c = 0; c < channels; ++c)
+                        image.at_unchecked(x, y, c) =
+                            static_cast<unsigned char>(
+                                std::lround(sum[c] / weight_sum));
+                }
+            }
+        });
+}
+}  // namespace USTC_CG
@@ -0,0 +1,28 @@
+// Filling the pixels left unwritten by a forward warp.
+#pragma once
+
+#include <vector>
+
+#include "common/image.h"
+
+namespace USTC_CG
+{
+// Fill every pixel whose `written` flag (one per pixel, row-major) is zero
+// with the inverse squared distance weighted average of its k nearest
+// boundary pixels: the written pixels with an unwritten 4-neighbour. The
+// nearest of them is the nearest written pixel, but for k > 1 the others
+// are the nearest along the hole boundaries, not among all written pixels
+// (which keeps the samples on the side of the hole). Only the colour
+// channels are filled; alpha is kept. Pixels with no boundary pixel within
+// `max_distance` are left untouched (max_distance <= 0: no limit).
+//
+// The neighbours are found with a 2D kd-tree over the boundary pixels, so
+// the tree grows with the hole boundaries instead of the image. The tree is
+// built in parallel, and the queries run tile by tile: each query is
+// bounded by the neighbours of the previous pixel of its tile.
+void fill_holes(
+    Image& image,
+    const std::vector<unsigned char>& written,
+    int k = 4,
+    float max_distance = 0);
+}  // namespace USTC_CG
@@ -0,0 +1,99 @@
+#include "core/resampler.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace USTC_CG
+{
+namespace
+{
+unsigned char to_byte(float v)
+{
+    return static_cast<unsigned char>(std::clamp(v + 0.5f, 0.0f, 255.0f));
+}
+
+// Catmull-Rom weights for the 4 taps at offsets -1, 0, 1, 2 from floor(x).
+void cubic_weights(float t, float w[4])
+{
+    const float t2 = t * t, t3 = t2 * t;
+    w[0] = -0.5f * t3 + t2 - 0.5f * t;
+    w[1] = 1.5f * t3 - 2.5f * t2 + 1.0f;
+    w[2] = -1.5f * t3 + 2.0f * t2 + 0.5f * t;
+    w[3] = 0.5f * t3 - 0.5f * t2;
+}
+}  // namespace
+
+bool sample(
+    const Image& image,
+    float x,
+    float y,
+    Interpolation interpolation,
+    unsigned char* out)
+{
+    const int width = image.width(), height = image.height();
+    const int channels = image.channels();
+    // Accept the half pixel around the border, like nearest rounding does.
+    if (!(x > -0.5f && y > -0.5f && x < width - 0.5f && y < height - 0.5f))
+        return false;
+
+    switch (interpolation)
+    {
+        case kNearest:
+        {
+            int ix = std::clamp(static_cast<int>(std::lround(x)), 0, width - 1);
+            int iy =
+                std::clamp(static_cast<int>(std::lround(y)), 0, height - 1);
+            for (int c = 0; c < channels; ++c)
+                out[c] = image.at_unchecked(ix, iy, c);
+            return true;
+        }
+        case kBilinear:
+        {
+            const int x0 = static_cast<int>(std::floor(x));
+            const int y0 = static_cast<int>(std::floor(y));
+            const float tx = x - x0, ty = y - y0;
+            const int xa = std::clamp(x0, 0, width - 1);
+            const int xb = std::clamp(x0 + 1, 0, width - 1);
+            const int ya = std::clamp(y0, 0, height - 1);
+            const int yb = std::clamp(y0 + 1, 0, height - 1);
+            for (int c = 0; c < channels; ++c)
+            {
+                float top = image.at_unchecked(xa, ya, c) * (1 - tx) +
+                            image.at_unchecked(xb, ya, c) * tx;
+                float bottom = image.at_unchecked(xa, yb, c) * (1 - tx) +
+                               image.at_unchecked(xb, yb, c) * tx;
+                out[c] = to_byte(top * (1 - ty) + bottom * ty);
+            }
+            return true;
+        }
+        case kBicubic:
+        {
+            const int x0 = static_cast<int>(std::floor(x));
+            const int y0 = static_cast<int>(std::floor(y));
+            float wx[4], wy[4];
+            cubic_weights(x - x0, wx);
+            cubic_weights(y - y0, wy);
+            int xs[4], ys[4];
+            for (int k = 0; k < 4; ++k)
+            {
+                xs[k] = std::clamp(x0 - 1 + k, 0, width - 1);
+                ys[k] = std::clamp(y0 - 1 + k, 0, height - 1);
+            }
+            for (int c = 0; c < channels; ++c)
+            {
+                float sum = 0;
+                for (int j = 0; j < 4; ++j)
+                {
+                    float row = 0;
+                    for (int i = 0; i < 4; ++i)
+                        row += wx[i] * image.at_unchecked(xs[i], ys[j], c);
+                    sum += wy[j] * row;
+                }
+                out[c] = to_byte(sum);
+            }
+            return true;
+        }
+        default: return false;
+    }
+}
+}  // namespace USTC_CG
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "common/image.h"
+
+namespace USTC_CG
+{
+// Reconstruction kernels used to read an image at non-integer positions.
+enum Interpolation
+{
+    kNearest = 0,
+    kBilinear = 1,
+    // Catmull-Rom cubic convolution (a = -0.5)
+    kBicubic = 2,
+};
+
+// Sample `image` at the continuous position (x, y), where pixel (i, j) sits
+// at (i, j), and write channels() values to `out`. Returns false (and leaves
+// `out` untouched) if the position is outside of the image. Neighbours
+// beyond the border are clamped to the edge.
+bool sample(
+    const Image& image,
+    float x,
+    float y,
+    Interpolation interpolation,
+    unsigned char* out);
+}  // namespace USTC_CG
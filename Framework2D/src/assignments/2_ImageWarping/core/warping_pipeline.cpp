@@ -0,0 +1,153 @@
+#include "core/warping_pipeline.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include "common/tile_scheduler.h"
+#include "warper/IDW_warper.h"
+#include "warper/RBF_warper.h"
+#include "warper/fisheye_warper.h"
+#include "warper/neural_warper.h"
+
+namespace USTC_CG
+{
+std::unique_ptr<Warper> create_warper(
+    const std::string& name,
+    int width,
+    int height,
+    const std::vector<Warper::Point>& start_points,
+    const std::vector<Warper::Point>& end_points)
+{
+    std::unique_ptr<Warper> warper;
+    if (name == "fisheye")
+        warper = std::make_unique<FisheyeWarper>(width / 2.0f, height / 2.0f);
+    else if (name == "idw")
+        warper = std::make_unique<IDWWarper>();
+    else if (name == "rbf")
+        warper = std::make_unique<RBFWarper>();
+    else if (name == "neural")
+        warper = std::make_unique<NeuralWarper>();
+    else
+        return nullptr;
+    warper->set_control_points(start_points, end_points);
+    return warper;
+}
+
+Image warp_image(
+    const Image& source,
+    const Warper& warper,
+    std::vector<unsigned char>* written)
+{
+    const int width = source.width();
+    const int height = source.height();
+    const int channels = source.channels();
+    TileScheduler& scheduler = TileScheduler::instance();
+
+    // Create a new image to store the result, and initialize its color
+    // (alpha is kept)
+    Image warped_image(source);
+    scheduler.parallel_for_tiles(
+        width,
+        height,
+        [&](const Tile& tile)
+        {
+            for (int y = tile.y0; y < tile.y1; ++y)
+                for (int x = tile.x0; x < tile.x1; ++x)
+                    for (int c = 0; c < std::min(channels, 3); ++c)
+                        warped_image.at_unchecked(x, y, c) = 0;
+        });
+
+    // The mapping (x, y) -> (x', y') is evaluated in parallel. Several source
+    // pixels may land on the same target, so the copy is done afterwards in
+    // raster order: the last writer wins exactly as in a serial loop, which
+    // keeps the output deterministic.
+    std::vector<Warper::Point> targets;
+    warper.warp_field(width, height, targets);
+    if (written)
+        written->assign(static_cast<std::size_t>(width) * height, 0);
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            const Warper::Point& q =
+                targets[static_cast<std::size_t>(y) * width + x];
+            const int new_x = static_cast<int>(q.x());
+            const int new_y = static_cast<int>(q.y());
+            if (new_x >= 0 && new_x < width && new_y >= 0 && new_y < height)
+            {
+                for (int c = 0; c < channels; ++c)
+                    warped_image.at_unchecked(new_x, new_y, c) =
+                        source.at_unchecked(x, y, c);
+                if (written)
+                    (*written)[static_cast<std::size_t>(new_y) * width +
+                               new_x] = 1;
+            }
+        }
+    }
+    return warped_image;
+}
+
+Image inverse_warp_image(
+    const Image& source,
+    const Warper& inverse_warper,
+    Interpolation interpolation)
+{
+    const int channels = source.channels();
+    if (channels > 4)
+        throw std::invalid_argument("At most 4 channels are supported");
+    const int width = source.width();
+    Image warped_image(source);
+    std::vector<Warper::Point> positions;
+    inverse_warper.warp_field(width, source.height(), positions);
+    TileScheduler::instance().for_each_pixel(
+        width,
+        source.height(),
+        [&](int x, int y)
+        {
+            const Warper::Point& p =
+                positions[static_cast<std::size_t>(y) * width + x];
+            // Samples go through a small buffer so that planar images are
+            // handled as well.
+            unsigned char value[4];
+            if (sample(source, p.x(), p.y(), interpolation, value))
+            {
+                for (int c = 0; c < channels; ++c)
+                    warped_image.at_unchecked(x, y, c) = value[c];
+            }
+            else
+            {
+                for (int c = 0; c < std::min(channels, 3); ++c)
+                    warped_image.at_unchecked(x, y, c) = 0;
+            }
+        });
+    return warped_image;
+}
+
+bool load_control_points(
+    const std::string& filename,
+    std::vector<Warper::Point>& start_points,
+    std::vector<Warper::Point>& end_points)
+{
+    std::ifstream file(filename);
+    if (!file.is_open())
+        return false;
+    start_points.clear();
+    end_points.clear();
+    std::string line;
+    while (std::getline(file, line))
+    {
+        auto first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#')
+            continue;
+        std::istringstream iss(line);
+        float sx, sy, ex, ey;
+        if (!(iss >> sx >> sy >> ex >> ey))
+            return false;
+        start_points.emplace_back(sx, sy);
+        end_points.emplace_back(ex, ey);
+    }
+    return true;
+}
+}  // namespace USTC_CG
@@ -0,0 +1,54 @@
+// Image side of the warping application, free of any GUI/OpenGL dependency:
+// building warpers, applying them to images and reading control points.
+// Shared by WarpingWidget and the headless command line tool.
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/image.h"
+#include "core/resampler.h"
+#include "warper/warper.h"
+
+namespace USTC_CG
+{
+// Create a warper by name ("fisheye", "idw", "rbf" or "neural") for an image
+// of the given size, fitted to the control pairs. Returns nullptr for unknown
+// names.
+std::unique_ptr<Warper> create_warper(
+    const std::string& name,
+    int width,
+    int height,
+    const std::vector<Warper::Point>& start_points,
+    const std::vector<Warper::Point>& end_points);
+
+// Forward warping: every source pixel (x, y) is moved to the pixel
+// warper.warp(x, y) of the result. Pixels not hit by any source pixel are
+// black (the alpha channel of the source is kept). If `written` is given, it
+// receives one flag per pixel (row-major) telling which pixels were hit, as
+// expected by fill_holes().
+Image warp_image(
+    const Image& source,
+    const Warper& warper,
+    std::vector<unsigned char>* written = nullptr);
+
+// Inverse warping: every destination pixel (x, y) is looked up at the source
+// position inverse_warper.warp(x, y) and resampled with `interpolation`.
+// Each output pixel is computed independently, so the result has no holes or
+// overlaps; only positions mapped outside of the source stay black (alpha
+// kept).
+Image inverse_warp_image(
+    const Image& source,
+    const Warper& inverse_warper,
+    Interpolation interpolation = kBilinear);
+
+// Read control pairs from a text file, one pair per line:
+//   start_x start_y end_x end_y
+// Empty lines and lines starting with '#' are skipped. Returns false if the
+// file cannot be opened or a line is malformed.
+bool load_control_points(
+    const std::string& filename,
+    std::vector<Warper::Point>& start_points,
+    std::vector<Warper::Point>& end_points);
+}  // namespace USTC_CG
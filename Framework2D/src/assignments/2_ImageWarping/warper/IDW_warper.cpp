@@ -0,0 +1,159 @@
+#include "IDW_warper.h"
+
+#include <cmath>
+#include <limits>
+
+namespace USTC_CG
+{
+namespace
+{
+// sigma(p) = |p - p_i|^-mu as a function of s = |p - p_i|^2
+struct IDWKernel
+{
+    static constexpr bool kSingular = true;
+    double half_mu;
+
+    double value(double s) const
+    {
+        return std::pow(s, -half_mu);
+    }
+    double slope(double s) const
+    {
+        return -half_mu * std::pow(s, -half_mu - 1);
+    }
+    double curvature(double s) const
+    {
+        return half_mu * (half_mu + 1) * std::pow(s, -half_mu - 2);
+    }
+
+    // Error of f(p) = N / D in pixels, for a node with the moments B of
+    // the magnitudes (1, |q_i - p_i|, |T_i - I|). The node changes N - f D
+    // by sum_i R_i (f_i(p) - f(p)), with the remainders |R_i| <= K3 |d_i|^3
+    // / 6 and |f_i(p) - p| <= |q_i - p_i| + |T_i - I| |p - p_i|. D and f
+    // are taken from the partial sums.
+    double error(
+        const double* B,
+        const Eigen::Vector2d& p,
+        double distance,
+        double radius,
+        const double* sum) const
+    {
+        if (sum[0] <= 0)
+            return std::numeric_limits<double>::infinity();
+        // Bound of the third derivatives of |x|^-mu beyond `distance -
+        // radius` from p
+        const double third = 4 * half_mu * (half_mu + 1) *
+                             (2 * half_mu + 7) *
+                             std::pow(distance - radius, -2 * half_mu - 3);
+        const Eigen::Vector2d f(
+            (sum[1] + sum[3] * p.x() + sum[4] * p.y()) / sum[0],
+            (sum[2] + sum[5] * p.x() + sum[6] * p.y()) / sum[0]);
+        return third / 6 *
+               (B[1] + B[2] * (distance + radius) + (f - p).norm() * B[0]) /
+               sum[0];
+    }
+};
+}  // namespace
+
+void IDWWarper::fit()
+{
+    const std::size_t n = start_points_.size();
+    transforms_.assign(n, Eigen::Matrix2f::Identity());
+    // T_i A = B, with
+    //   A = sum_j sigma_i(p_j) (p_j - p_i)(p_j - p_i)^T
+    //   B = sum_j sigma_i(p_j) (q_j - q_i)(p_j - p_i)^T
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        Eigen::Matrix2d A = Eigen::Matrix2d::Zero();
+        Eigen::Matrix2d B = Eigen::Matrix2d::Zero();
+        for (std::size_t j = 0; j < n; ++j)
+        {
+            if (j == i)
+                continue;
+            Eigen::Vector2d dp =
+                (start_points_[j] - start_points_[i]).cast<double>();
+            Eigen::Vector2d dq =
+                (end_points_[j] - end_points_[i]).cast<double>();
+            double distance = dp.norm();
+            if (distance == 0)
+                continue;
+            double sigma = 1.0 / std::pow(distance, mu_);
+            A += sigma * dp * dp.transpose();
+            B += sigma * dq * dp.transpose();
+        }
+        // With fewer than 3 (non-collinear) pairs T_i is undetermined, and
+        // the identity is kept.
+        if (std::abs(A.determinant()) > 1e-12 * A.squaredNorm())
+            transforms_[i] = (B * A.inverse()).cast<float>();
+    }
+    build_evaluator();
+}
+
+void IDWWarper::build_evaluator()
+{
+    evaluator_.reset();
+    if (far_field() <= 0)
+        return;
+    const std::size_t n = start_points_.size();
+    Eigen::MatrixXd weights(n, 7), magnitudes(n, 3);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        const Eigen::Matrix2d T = transforms_[i].cast<double>();
+        const Eigen::Vector2d c = end_points_[i].cast<double>() -
+                                  T * start_points_[i].cast<double>();
+        weights.row(i) << 1, c.x(), c.y(), T(0, 0), T(0, 1), T(1, 0),
+            T(1, 1);
+        magnitudes.row(i) << 1,
+            (end_points_[i] - start_points_[i]).cast<double>().norm(),
+            (T - Eigen::Matrix2d::Identity()).norm();
+    }
+    evaluator_ = std::make_unique<FarFieldEvaluator>(
+        start_points_, weights, magnitudes, far_field());
+}
+
+Warper::Point IDWWarper::warp(const Point& p) const
+{
+    const std::size_t n = start_points_.size();
+    if (n == 0)
+        return p;
+    if (evaluator_)
+    {
+        // f(p) = (sum sigma_i (q_i - T_i p_i) + (sum sigma_i T_i) p) /
+        //        sum sigma_i
+        double s[7] = { 0, 0, 0, 0, 0, 0, 0 };
+        int hit = evaluator_->accumulate(
+            p, IDWKernel{ static_cast<double>(mu_) / 2 }, s);
+        if (hit >= 0)
+            return end_points_[hit];
+        Eigen::Matrix2d T;
+        T << s[3], s[4], s[5], s[6];
+        Eigen::Vector2d f =
+            Eigen::Vector2d(s[1], s[2]) + T * p.cast<double>();
+        return (f / s[0]).cast<float>();
+    }
+    Eigen::Vector2d sum = Eigen::Vector2d::Zero();
+    double sigma_sum = 0;
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        Point d = p - start_points_[i];
+        double distance = d.norm();
+        // w_i(p_i) = 1
+        if (distance < 1e-6)
+            return end_points_[i];
+        double sigma = 1.0 / std::pow(distance, mu_);
+        Point f_i = end_points_[i] + transforms_[i] * d;
+        sum += sigma * f_i.cast<double>();
+        sigma_sum += sigma;
+    }
+    return (sum / sigma_sum).cast<float>();
+}
+
+std::unique_ptr<Warper> IDWWarper::make_inverse() const
+{
+    auto inverse = std::make_unique<IDWWarper>(mu_);
+    inverse->set_grid_cache(grid_spacing(), grid_tolerance());
+    inverse->set_far_field(far_field());
+    inverse->set_control_points(end_points_, start_points_);
+    return inverse;
+}
+}  // namespace USTC_CG
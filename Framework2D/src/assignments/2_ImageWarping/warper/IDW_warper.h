@@ -1,17 +1,45 @@
-// HW2_TODO: Implement the IDWWarper class
 #pragma once
 
+#include <memory>
+#include <vector>
+
+#include "far_field_evaluator.h"
 #include "warper.h"
 
 namespace USTC_CG
 {
+// Inverse distance-weighted interpolation (Ruprecht and Muller 1995):
+//   f(p) = sum_i w_i(p) f_i(p),  w_i = sigma_i / sum_j sigma_j,
+//   sigma_i(p) = 1 / |p - p_i|^mu,  f_i(p) = q_i + T_i (p - p_i),
+// where each T_i is the least-squares fit of the neighbouring pairs.
 class IDWWarper : public Warper
 {
    public:
-    IDWWarper() = default;
+    explicit IDWWarper(float mu = 2.0f) : mu_(mu)
+    {
+    }
     virtual ~IDWWarper() = default;
-    // HW2_TODO: Implement the warp(...) function with IDW interpolation
 
-    // HW2_TODO: other functions or variables if you need
+    Point warp(const Point& p) const override;
+    // Interpolation of the swapped pairs q_i -> p_i: exact at the control
+    // points, an approximation of f^{-1} in between.
+    std::unique_ptr<Warper> make_inverse() const override;
+    bool supports_far_field() const override
+    {
+        return true;
+    }
+
+   protected:
+    void fit() override;
+    // Both sums of the quotient are kernel sums with the weights
+    // (1, q_i - T_i p_i, T_i) of each pair.
+    void build_evaluator() override;
+
+   private:
+    float mu_;
+    // The local linear maps T_i
+    std::vector<Eigen::Matrix2f> transforms_;
+    // Set when far_field() > 0
+    std::unique_ptr<FarFieldEvaluator> evaluator_;
 };
-}  // namespace USTC_CG
\ No newline at end of file
+}  // namespace USTC_CG
@@ -0,0 +1,146 @@
+#include "RBF_warper.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace USTC_CG
+{
+void RBFWarper::fit()
+{
+    factor_.clear();
+    centers_.clear();
+    for (std::size_t i = 0; i < start_points_.size(); ++i)
+        add_center(i);
+    solve();
+}
+
+void RBFWarper::add_control_point(const Point& p, const Point& q)
+{
+    start_points_.push_back(p);
+    end_points_.push_back(q);
+    add_center(start_points_.size() - 1);
+    solve();
+}
+
+void RBFWarper::remove_control_point(std::size_t index)
+{
+    if (index >= start_points_.size())
+        throw std::out_of_range("Control point index out of bounds");
+    auto it = std::find(centers_.begin(), centers_.end(), index);
+    if (it != centers_.end())
+    {
+        factor_.remove(static_cast<int>(it - centers_.begin()));
+        centers_.erase(it);
+    }
+    start_points_.erase(start_points_.begin() + index);
+    end_points_.erase(end_points_.begin() + index);
+    std::vector<bool> is_center(start_points_.size(), false);
+    for (auto& center : centers_)
+    {
+        if (center > index)
+            --center;
+        is_center[center] = true;
+    }
+    // A duplicate of the removed point takes over its basis function.
+    for (std::size_t i = 0; i < start_points_.size(); ++i)
+        if (!is_center[i])
+            add_center(i);
+    solve();
+}
+
+double RBFWarper::basis(const Point& p, const Point& center) const
+{
+    return std::sqrt(
+        (p.cast<double>() - center.cast<double>()).squaredNorm() +
+        static_cast<double>(radius_) * radius_);
+}
+
+void RBFWarper::add_center(std::size_t i)
+{
+    const int n = factor_.size();
+    Eigen::VectorXd column(n + 1);
+    for (int k = 0; k < n; ++k)
+        column(k) = basis(start_points_[i], start_points_[centers_[k]]);
+    column(n) = basis(start_points_[i], start_points_[i]);
+    if (factor_.append(column))
+        centers_.push_back(i);
+}
+
+void RBFWarper::solve()
+{
+    fit_affine();
+    const int n = factor_.size();
+    // G alpha = q - (A p + b)
+    Eigen::MatrixXd rhs(n, 2);
+    for (int k = 0; k < n; ++k)
+    {
+        const std::size_t i = centers_[k];
+        Point residual =
+            end_points_[i] - (affine_A_ * start_points_[i] + affine_b_);
+        rhs.row(k) = residual.cast<double>().transpose();
+    }
+    factor_.solve_in_place(rhs);
+    alpha_ = rhs;
+}
+
+void RBFWarper::fit_affine()
+{
+    const int n = static_cast<int>(start_points_.size());
+    affine_A_.setIdentity();
+    affine_b_.setZero();
+    if (n == 0)
+        return;
+    if (n >= 3)
+    {
+        // min sum_i |A p_i + b - q_i|^2
+        Eigen::MatrixXd P(n, 3);
+        Eigen::MatrixX2d Q(n, 2);
+        for (int i = 0; i < n; ++i)
+        {
+            P.row(i) << start_points_[i].x(), start_points_[i].y(), 1.0;
+            Q.row(i) = end_points_[i].cast<double>().transpose();
+        }
+        auto qr = P.colPivHouseholderQr();
+        if (qr.rank() == 3)
+        {
+            Eigen::Matrix<double, 3, 2> X = qr.solve(Q);
+            affine_A_ = X.topRows<2>().transpose().cast<float>();
+            affine_b_ = X.row(2).transpose().cast<float>();
+            return;
+        }
+        // Collinear points: fall back to the two-point case.
+    }
+    if (n >= 2)
+    {
+        // Translation + uniform scaling
+        float dp = (start_points_[1] - start_points_[0]).norm();
+        float dq = (end_points_[1] - end_points_[0]).norm();
+        float scale = dp > 0 ? dq / dp : 1.0f;
+        affine_A_ = scale * Eigen::Matrix2f::Identity();
+        affine_b_ = end_points_[0] - scale * start_points_[0];
+        return;
+    }
+    // Translation
+    affine_b_ = end_points_[0] - start_points_[0];
+}
+
+Warper::Point RBFWarper::warp(const Point& p) const
+{
+    // Accumulated in double: with many centers the terms are large and
+    // cancel out, and float loses pixels of accuracy.
+    Eigen::Vector2d result = (affine_A_ * p + affine_b_).cast<double>();
+    for (int k = 0; k < alpha_.rows(); ++k)
+        result += basis(p, start_points_[centers_[k]]) *
+                  alpha_.row(k).transpose();
+    return result.cast<float>();
+}
+
+std::unique_ptr<Warper> RBFWarper::make_inverse() const
+{
+    auto inverse = std::make_unique<RBFWarper>(radius_);
+    inverse->set_grid_cache(grid_spacing(), grid_tolerance());
+    inverse->set_control_points(end_points_, start_points_);
+    return inverse;
+}
+}  // namespace USTC_CG
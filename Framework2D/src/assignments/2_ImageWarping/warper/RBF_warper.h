@@ -1,17 +1,59 @@
-// HW2_TODO: Implement the RBFWarper class
 #pragma once
 
+#include <memory>
+#include <vector>
+
+#include "incremental_ldlt.h"
 #include "warper.h"
 
 namespace USTC_CG
 {
+// Radial basis functions interpolation (Arad and Reisfeld 1995):
+//   f(p) = A p + b + sum_i alpha_i g(|p - p_i|),  g(d) = sqrt(d^2 + r^2).
+// The affine part is fitted first (least squares for 3+ pairs), the radial
+// part then interpolates the residual: G alpha = q - (A p + b) with the
+// symmetric G(i, j) = g(|p_i - p_j|).
+//
+// G only depends on the start points, so its LDL^T factorization is kept
+// and edited as pairs are added or removed (O(n^2) per edit instead of
+// O(n^3)); both components of alpha are solved with the same factors. A
+// start point duplicating an existing one gets no basis function. It always
+// sums exactly (no far-field backend, see Warper::supports_far_field()).
 class RBFWarper : public Warper
 {
    public:
-    RBFWarper() = default;
+    explicit RBFWarper(float radius = 10.0f) : radius_(radius)
+    {
+    }
     virtual ~RBFWarper() = default;
-    // HW2_TODO: Implement the warp(...) function with RBF interpolation
 
-    // HW2_TODO: other functions or variables if you need
+    Point warp(const Point& p) const override;
+    void add_control_point(const Point& p, const Point& q) override;
+    void remove_control_point(std::size_t index) override;
+    // Interpolation of the swapped pairs q_i -> p_i: exact at the control
+    // points, an approximation of f^{-1} in between.
+    std::unique_ptr<Warper> make_inverse() const override;
+
+   protected:
+    void fit() override;
+
+   private:
+    double basis(const Point& p, const Point& center) const;
+    // Border the factorization with the basis function of start point i;
+    // does nothing if the point duplicates a center.
+    void add_center(std::size_t i);
+    // Refit the affine part and solve for alpha with the current factors
+    void solve();
+    void fit_affine();
+
+    float radius_;
+    Eigen::Matrix2f affine_A_ = Eigen::Matrix2f::Identity();
+    Eigen::Vector2f affine_b_ = Eigen::Vector2f::Zero();
+    // Factorization of G, and the index of the start point of each of its
+    // rows
+    IncrementalLDLT factor_;
+    std::vector<std::size_t> centers_;
+    // alpha_i, one row per center
+    Eigen::MatrixX2d alpha_;
 };
-}  // namespace USTC_CG
\ No newline at end of file
+}  // namespace USTC_CG
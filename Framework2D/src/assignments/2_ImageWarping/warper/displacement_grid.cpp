@@ -0,0 +1,286 @@
+#include "displacement_grid.h"
+
+#include <algorithm>
+
+#include "common/tile_scheduler.h"
+
+namespace USTC_CG
+{
+namespace
+{
+using Point = Warper::Point;
+
+// The samples must be within this fraction of the tolerance, to leave room
+// for the error between them
+constexpr float kMargin = 0.5f;
+
+// A lattice cell with corners (x0, y0) - (x1, y1). It owns the pixels
+// [x0, x_end) x [y0, y_end): the right/bottom corner belongs to the next cell,
+// except on the last column/row of the image.
+struct Cell
+{
+    int x0, y0, x1, y1;
+    int x_end, y_end;
+    // Displacement at the corners (x0, y0), (x1, y0), (x0, y1), (x1, y1)
+    Point d00, d10, d01, d11;
+};
+
+class GridEvaluator
+{
+   public:
+    GridEvaluator(
+        const Warper& warper,
+        int width,
+        float tolerance,
+        std::vector<Point>& field)
+        : warper_(warper),
+          width_(width),
+          tolerance_(tolerance),
+          field_(field)
+    {
+    }
+
+    Point displacement(int x, int y) const
+    {
+        Point p(static_cast<float>(x), static_cast<float>(y));
+        return warper_.warp(p) - p;
+    }
+
+    void fill_exact(const Cell& cell) const
+    {
+        for (int y = cell.y0; y < cell.y_end; ++y)
+            for (int x = cell.x0; x < cell.x_end; ++x)
+                store(x, y, displacement(x, y));
+    }
+
+    // Subdivide the cell until the midpoint test passes, then interpolate.
+    void refine(const Cell& cell) const
+    {
+        const int w = cell.x1 - cell.x0, h = cell.y1 - cell.y0;
+        // All pixels of the cell are corners, which are exact
+        if (w <= 1 && h <= 1)
+            return fill_bilinear(cell);
+
+        const int xm = (cell.x0 + cell.x1) / 2, ym = (cell.y0 + cell.y1) / 2;
+        if (h <= 1)
+        {
+            // A single row of pixels: ym == y0, split at xm only
+            const Point dm = displacement(xm, ym);
+            const Point bottom = displacement(xm, cell.y1);
+            if (accurate(cell, xm, ym, dm) &&
+                accurate(cell, xm, cell.y1, bottom))
+                return fill_bilinear(cell);
+            refine({ cell.x0, cell.y0, xm, cell.y1, xm, cell.y_end,
+                     cell.d00, dm, cell.d01, bottom });
+            refine({ xm, cell.y0, cell.x1, cell.y1, cell.x_end, cell.y_end,
+                     dm, cell.d10, bottom, cell.d11 });
+            return;
+        }
+        if (w <= 1)
+        {
+            // A single column: xm == x0, split at ym only
+            const Point dm = displacement(xm, ym);
+            const Point right = displacement(cell.x1, ym);
+            if (accurate(cell, xm, ym, dm) &&
+                accurate(cell, cell.x1, ym, right))
+                return fill_bilinear(cell);
+            refine({ cell.x0, cell.y0, cell.x1, ym, cell.x_end, ym,
+                     cell.d00, cell.d10, dm, right });
+            refine({ cell.x0, ym, cell.x1, cell.y1, cell.x_end, cell.y_end,
+                     dm, right, cell.d01, cell.d11 });
+            return;
+        }
+        refine(
+            cell,
+            displacement(xm, cell.y0),
+            displacement(xm, cell.y1),
+            displacement(cell.x0, ym),
+            displacement(cell.x1, ym));
+    }
+
+    // Same for a cell of at least 2 x 2 pixels whose displacement at the
+    // edge midpoints is already known (they are shared with the neighbours).
+    void refine(
+        const Cell& cell,
+        const Point& top,
+        const Point& bottom,
+        const Point& left,
+        const Point& right) const
+    {
+        const int xm = (cell.x0 + cell.x1) / 2, ym = (cell.y0 + cell.y1) / 2;
+        const Point dm = displacement(xm, ym);
+        // The bilinear error is estimated at the midpoints of the cell and
+        // of its edges, then at its quarter points, which catch the
+        // features a quadratic fit through the midpoints misses.
+        if (accurate(cell, xm, ym, dm) && accurate(cell, xm, cell.y0, top) &&
+            accurate(cell, xm, cell.y1, bottom) &&
+            accurate(cell, cell.x0, ym, left) &&
+            accurate(cell, cell.x1, ym, right) && accurate_quarters(cell))
+            return fill_bilinear(cell);
+        refine({ cell.x0, cell.y0, xm, ym, xm, ym,
+                 cell.d00, top, left, dm });
+        refine({ xm, cell.y0, cell.x1, ym, cell.x_end, ym,
+                 top, cell.d10, dm, right });
+        refine({ cell.x0, ym, xm, cell.y1, xm, cell.y_end,
+                 left, dm, cell.d01, bottom });
+        refine({ xm, ym, cell.x1, cell.y1, cell.x_end, cell.y_end,
+                 dm, right, bottom, cell.d11 });
+    }
+
+   private:
+    bool accurate(const Cell& cell, int x, int y, const Point& d) const
+    {
+        return (d - bilinear(cell, x, y)).norm() <= kMargin * tolerance_;
+    }
+
+    bool accurate_quarters(const Cell& cell) const
+    {
+        // Smaller cells have no pixel strictly between the samples above
+        if (cell.x1 - cell.x0 < 4 || cell.y1 - cell.y0 < 4)
+            return true;
+        const int xs[] = { (3 * cell.x0 + cell.x1) / 4,
+                           (cell.x0 + 3 * cell.x1) / 4 };
+        const int ys[] = { (3 * cell.y0 + cell.y1) / 4,
+                           (cell.y0 + 3 * cell.y1) / 4 };
+        for (int y : ys)
+            for (int x : xs)
+                if (!accurate(cell, x, y, displacement(x, y)))
+                    return false;
+        return true;
+    }
+
+    static Point bilinear(const Cell& cell, int x, int y)
+    {
+        const float tx = cell.x1 > cell.x0 ? static_cast<float>(x - cell.x0) /
+                                                 (cell.x1 - cell.x0)
+                                           : 0.0f;
+        const float ty = cell.y1 > cell.y0 ? static_cast<float>(y - cell.y0) /
+                                                 (cell.y1 - cell.y0)
+                                           : 0.0f;
+        return (1 - ty) * ((1 - tx) * cell.d00 + tx * cell.d10) +
+               ty * ((1 - tx) * cell.d01 + tx * cell.d11);
+    }
+
+    void fill_bilinear(const Cell& cell) const
+    {
+        for (int y = cell.y0; y < cell.y_end; ++y)
+            for (int x = cell.x0; x < cell.x_end; ++x)
+                store(x, y, bilinear(cell, x, y));
+    }
+
+    void store(int x, int y, const Point& d) const
+    {
+        field_[static_cast<std::size_t>(y) * width_ + x] =
+            Point(static_cast<float>(x), static_cast<float>(y)) + d;
+    }
+
+    const Warper& warper_;
+    int width_;
+    float tolerance_;
+    std::vector<Point>& field_;
+};
+}  // namespace
+
+void evaluate_on_grid(
+    const Warper& warper,
+    int width,
+    int height,
+    int spacing,
+    float tolerance,
+    std::vector<Warper::Point>& field)
+{
+    field.resize(static_cast<std::size_t>(width) * height);
+    TileScheduler& scheduler = TileScheduler::instance();
+    GridEvaluator evaluator(warper, width, tolerance, field);
+    if (width < 2 || height < 2 || spacing < 2)
+    {
+        Cell image{};
+        image.x_end = width;
+        image.y_end = height;
+        evaluator.fill_exact(image);
+        return;
+    }
+
+    // Lattice nodes every `spacing` pixels, the last one on the border
+    const int nx = (width - 2) / spacing + 2;
+    const int ny = (height - 2) / spacing + 2;
+    auto node_x = [&](int i) { return std::min(i * spacing, width - 1); };
+    auto node_y = [&](int j) { return std::min(j * spacing, height - 1); };
+
+    // Exact displacement at the nodes and at the midpoints of the lattice
+    // edges; the node (i, j) also stores the midpoints of the edges going
+    // right and down from it.
+    const std::size_t node_count = static_cast<std::size_t>(nx) * ny;
+    std::vector<Point> nodes(node_count), right_mid(node_count),
+        down_mid(node_count);
+    scheduler.parallel_for(
+        node_count,
+        [&](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t k = begin; k < end; ++k)
+            {
+                const int i = static_cast<int>(k % nx);
+                const int j = static_cast<int>(k / nx);
+                const int x = node_x(i), y = node_y(j);
+                nodes[k] = evaluator.displacement(x, y);
+                if (i + 1 < nx)
+                    right_mid[k] =
+                        evaluator.displacement((x + node_x(i + 1)) / 2, y);
+                if (j + 1 < ny)
+                    down_mid[k] =
+                        evaluator.displacement(x, (y + node_y(j + 1)) / 2);
+            }
+        },
+        256);
+
+    // Cells holding a control point
+    const int cells_x = nx - 1, cells_y = ny - 1;
+    std::vector<char> exact(static_cast<std::size_t>(cells_x) * cells_y, 0);
+    for (const Point& p : warper.start_points())
+    {
+        if (!(p.x() >= 0 && p.y() >= 0 && p.x() < width && p.y() < height))
+            continue;
+        const int i = std::min(static_cast<int>(p.x()) / spacing, cells_x - 1);
+        const int j = std::min(static_cast<int>(p.y()) / spacing, cells_y - 1);
+        exact[static_cast<std::size_t>(j) * cells_x + i] = 1;
+    }
+
+    // Cells only write their own pixels, so rows of cells run in parallel.
+    scheduler.parallel_for(
+        cells_y,
+        [&](std::size_t begin, std::size_t end)
+        {
+            for (int j = static_cast<int>(begin); j < static_cast<int>(end);
+                 ++j)
+            {
+                for (int i = 0; i < cells_x; ++i)
+                {
+                    Cell cell;
+                    cell.x0 = node_x(i);
+                    cell.y0 = node_y(j);
+                    cell.x1 = node_x(i + 1);
+                    cell.y1 = node_y(j + 1);
+                    cell.x_end = i + 1 == cells_x ? width : cell.x1;
+                    cell.y_end = j + 1 == cells_y ? height : cell.y1;
+                    const std::size_t k = static_cast<std::size_t>(j) * nx + i;
+                    cell.d00 = nodes[k];
+                    cell.d10 = nodes[k + 1];
+                    cell.d01 = nodes[k + nx];
+                    cell.d11 = nodes[k + nx + 1];
+                    if (exact[static_cast<std::size_t>(j) * cells_x + i])
+                        evaluator.fill_exact(cell);
+                    else if (cell.x1 - cell.x0 < 2 || cell.y1 - cell.y0 < 2)
+                        evaluator.refine(cell);
+                    else
+                        evaluator.refine(
+                            cell,
+                            right_mid[k],
+                            right_mid[k + nx],
+                            down_mid[k],
+                            down_mid[k + 1]);
+                }
+            }
+        },
+        1);
+}
+}  // namespace USTC_CG
@@ -0,0 +1,26 @@
+// Coarse-lattice evaluation of a warping map, used by Warper::warp_field().
+#pragma once
+
+#include <vector>
+
+#include "warper.h"
+
+namespace USTC_CG
+{
+// Fill `field` (width * height, row-major) with an approximation of
+// warper.warp(x, y): the displacement is evaluated exactly on a lattice of
+// the given spacing, then bilinearly interpolated. A cell is subdivided
+// (down to single pixels) while the exact displacement at the midpoints of
+// the cell and of its edges, or at its quarter points, deviates from the
+// interpolated one by more than half of `tolerance` pixels. The margin keeps
+// the error between the samples within `tolerance` for IDW and RBF maps, but
+// this is a heuristic, not a bound. Cells containing a control point are
+// evaluated exactly, since the maps have their sharpest features there.
+void evaluate_on_grid(
+    const Warper& warper,
+    int width,
+    int height,
+    int spacing,
+    float tolerance,
+    std::vector<Warper::Point>& field);
+}  // namespace USTC_CG
@@ -0,0 +1,113 @@
+#include "far_field_evaluator.h"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+namespace USTC_CG
+{
+FarFieldEvaluator::FarFieldEvaluator(
+    const std::vector<Point>& points,
+    const Eigen::MatrixXd& weights,
+    const Eigen::MatrixXd& magnitudes,
+    float tolerance)
+    : m_(static_cast<int>(weights.cols()))
+{
+    if (weights.rows() != static_cast<Eigen::Index>(points.size()) ||
+        magnitudes.rows() != weights.rows())
+        throw std::invalid_argument("One row of weights per point expected");
+    const int n = static_cast<int>(points.size());
+    if (n == 0)
+        return;
+    tolerance_per_point_ = std::max(static_cast<double>(tolerance), 0.0) / n;
+    points_.resize(n);
+    for (int i = 0; i < n; ++i)
+        points_[i] = points[i].cast<double>();
+    indices_.resize(n);
+    std::iota(indices_.begin(), indices_.end(), 0);
+
+    // Sort the points into the tree, then move the weights along
+    nodes_.resize(1);
+    build(0, 0, n, 0);
+    weights_.resize(n, m_);
+    for (int i = 0; i < n; ++i)
+        weights_.row(i) = weights.row(indices_[i]);
+
+    moments_.setZero(static_cast<Eigen::Index>(nodes_.size()), 6 * m_);
+    bounds_.setZero(
+        static_cast<Eigen::Index>(nodes_.size()), magnitudes.cols());
+    for (std::size_t k = 0; k < nodes_.size(); ++k)
+    {
+        Node& node = nodes_[k];
+        auto moment = moments_.row(k);
+        for (int i = node.begin; i < node.end; ++i)
+        {
+            const Eigen::Vector2d d = points_[i] - node.center;
+            const double distance = d.norm();
+            node.radius = std::max(node.radius, distance);
+            bounds_.row(k) += distance * distance * distance *
+                              magnitudes.row(indices_[i]);
+            moment.head(m_) += weights_.row(i);
+            moment.segment(m_, m_) += d.x() * weights_.row(i);
+            moment.segment(2 * m_, m_) += d.y() * weights_.row(i);
+            moment.segment(3 * m_, m_) += d.x() * d.x() * weights_.row(i);
+            moment.segment(4 * m_, m_) += d.x() * d.y() * weights_.row(i);
+            moment.segment(5 * m_, m_) += d.y() * d.y() * weights_.row(i);
+        }
+    }
+}
+
+void FarFieldEvaluator::build(int index, int begin, int end, int depth)
+{
+    Node& node = nodes_[index];
+    node.begin = begin;
+    node.end = end;
+    if (begin == end)
+        return;  // empty quadrant
+    Eigen::Vector2d min = points_[begin], max = points_[begin];
+    Eigen::Vector2d center = Eigen::Vector2d::Zero();
+    for (int i = begin; i < end; ++i)
+    {
+        min = min.cwiseMin(points_[i]);
+        max = max.cwiseMax(points_[i]);
+        center += points_[i];
+    }
+    const double size = (max - min).maxCoeff();
+    node.center = center / (end - begin);
+    // Leaves: few points, or coincident ones that cannot be split
+    if (end - begin <= kLeafSize || depth >= kMaxDepth || size <= 0)
+        return;
+
+    // Split at the middle of the bounding box: first by y, then each half
+    // by x, keeping points and their original indices together.
+    const Eigen::Vector2d mid = (min + max) / 2;
+    auto split = [&](int b, int e, int axis)
+    {
+        int i = b, j = e;
+        while (i < j)
+        {
+            if (points_[i][axis] < mid[axis])
+                ++i;
+            else
+            {
+                --j;
+                std::swap(points_[i], points_[j]);
+                std::swap(indices_[i], indices_[j]);
+            }
+        }
+        return i;
+    };
+    const int y_split = split(begin, end, 1);
+    const int bounds[5] = {
+        begin, split(begin, y_split, 0), y_split, split(y_split, end, 0), end
+    };
+
+    // The 4 children are consecutive in nodes_ (`node` is invalidated by
+    // the resize).
+    const int first_child = static_cast<int>(nodes_.size());
+    nodes_.resize(nodes_.size() + 4);
+    nodes_[index].first_child = first_child;
+    for (int c = 0; c < 4; ++c)
+        build(first_child + c, bounds[c], bounds[c + 1], depth + 1);
+}
+}  // namespace USTC_CG
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+namespace USTC_CG
+{
+// Hierarchical evaluation of kernel sums over the control points
+//   S(p) = sum_i k(|p - p_i|^2) w_i,
+// where w_i is a small vector of weights per point, e.g. the terms of the
+// IDW quotient.
+//
+// The points are stored in a quadtree whose nodes keep the moments
+//   M0 = sum_i w_i,  M1 = sum_i d_i w_i^T,  M2 = sum_i d_i d_i^T w_i
+// of the offsets d_i = p_i - c from their centroid c. A node seen from far
+// away contributes the second-order expansion of k around c instead of its
+// points; nearby leaves are summed exactly. The Taylor remainder of point i
+// is at most K3 |d_i|^3 / 6, with K3 a bound of the third derivatives of
+// the kernel at the distance |p - c| - radius, so each node also keeps
+//   B = sum_i b_i |d_i|^3
+// for a few nonnegative magnitudes b_i per point given by the caller (e.g.
+// |alpha_i|). The kernel turns B into a bound of the error of the result,
+// and a node is expanded only when that bound is within its share of the
+// tolerance, proportional to its number of points, so that the errors of
+// all the expanded nodes add up to at most the tolerance. Weights that
+// cancel out (as the coefficients of an RBF fitted to dense pairs do) make
+// the evaluator open more nodes, not lose accuracy; for RBF it opens nearly
+// all of them, so RBFWarper sums exactly.
+// Children are visited nearest first. The cost per evaluation drops from
+// O(n) towards O(log n) as the tolerance grows.
+class FarFieldEvaluator
+{
+   public:
+    using Point = Eigen::Vector2f;
+
+    // `weights` and `magnitudes` hold one row per point; `tolerance` is in
+    // the units of Kernel::error().
+    FarFieldEvaluator(
+        const std::vector<Point>& points,
+        const Eigen::MatrixXd& weights,
+        const Eigen::MatrixXd& magnitudes,
+        float tolerance);
+
+    int num_weights() const
+    {
+        return m_;
+    }
+
+    // Add S(p) to `sum` (num_weights() values). The kernel provides k and
+    // its first two derivatives as functions of s = |p - p_i|^2: value(s),
+    // slope(s) and curvature(s), and
+    //   error(B, p, distance, radius, sum),
+    // a bound of the error made by expanding a node with the moments B at
+    // `distance` from p and of the given radius, knowing the partial sum
+    // so far. For kernels with Kernel::kSingular (k(0) infinite, e.g. IDW),
+    // the evaluation stops at a point coinciding with p and returns its
+    // index, with an incomplete sum; otherwise -1 is returned.
+    template<typename Kernel>
+    int accumulate(const Point& p, const Kernel& kernel, double* sum) const;
+
+   private:
+    static constexpr int kLeafSize = 16;
+    static constexpr int kMaxDepth = 32;
+
+    struct Node
+    {
+        Eigen::Vector2d center = Eigen::Vector2d::Zero();  // centroid
+        double radius = 0;       // max |p_i - center|
+        int begin = 0, end = 0;  // range in the sorted points
+        int first_child = -1;    // 4 consecutive children, -1 for leaves
+    };
+
+    // Fill nodes_[index] with the points [begin, end), and its subtree.
+    void build(int index, int begin, int end, int depth);
+
+    const int m_;
+    // The errors of the expanded nodes add up: each gets a share of the
+    // tolerance proportional to its number of points.
+    double tolerance_per_point_ = 0;
+    std::vector<Node> nodes_;
+    // Points and weights sorted so that each node holds a contiguous range
+    std::vector<Eigen::Vector2d> points_;
+    std::vector<int> indices_;
+    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>
+        weights_;
+    // Moments of each node, one row per node: M0, M1 (x then y), M2 (xx, xy
+    // then yy), m values each
+    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>
+        moments_;
+    // Third moments B of the magnitudes, one row per node
+    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>
+        bounds_;
+};
+
+template<typename Kernel>
+int FarFieldEvaluator::accumulate(
+    const Point& p,
+    const Kernel& kernel,
+    double* sum) const
+{
+    if (nodes_.empty())
+        return -1;
+    const Eigen::Vector2d q = p.cast<double>();
+    // Explicit stack: depth-first traversal, at most 3 entries per level
+    int stack[3 * kMaxDepth + 4];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0)
+    {
+        const int index = stack[--top];
+        const Node& node = nodes_[index];
+        const Eigen::Vector2d d = q - node.center;
+        const double r2 = d.squaredNorm();
+        const double distance = std::sqrt(r2);
+        const bool far =
+            node.begin < node.end && distance > node.radius &&
+            kernel.error(
+                &bounds_(index, 0), q, distance, node.radius, sum) <=
+                tolerance_per_point_ * (node.end - node.begin);
+        if (far)
+        {
+            // Far field: second-order expansion around the centroid
+            const double k0 = kernel.value(r2);
+            const double k1 = kernel.slope(r2);
+            const double k2 = kernel.curvature(r2);
+            const double xx = d.x() * d.x(), xy = d.x() * d.y(),
+                         yy = d.y() * d.y();
+            const double* moment = &moments_(index, 0);
+            for (int j = 0; j < m_; ++j)
+            {
+                const double* M = moment + j;
+                const double dM1 = d.x() * M[m_] + d.y() * M[2 * m_];
+                const double trace = M[3 * m_] + M[5 * m_];
+                const double dM2d =
+                    xx * M[3 * m_] + 2 * xy * M[4 * m_] + yy * M[5 * m_];
+                sum[j] += k0 * M[0] + k1 * (trace - 2 * dM1) + 2 * k2 * dM2d;
+            }
+        }
+        else if (node.first_child < 0)
+        {
+            // Near field: exact sum
+            for (int i = node.begin; i < node.end; ++i)
+            {
+                const double s = (q - points_[i]).squaredNorm();
+                if constexpr (Kernel::kSingular)
+                    if (s < 1e-12)
+                        return indices_[i];
+                const double value = kernel.value(s);
+                const double* w = weights_.row(i).data();
+                for (int j = 0; j < m_; ++j)
+                    sum[j] += value * w[j];
+            }
+        }
+        else
+        {
+            // Nearest child on top: the partial sums seen by the error
+            // bounds of the far nodes then hold the largest terms.
+            int children[4];
+            double distances[4];
+            for (int c = 0; c < 4; ++c)
+            {
+                children[c] = node.first_child + c;
+                distances[c] =
+                    (q - nodes_[children[c]].center).squaredNorm();
+            }
+            for (int c = 1; c < 4; ++c)
+                for (int e = c; e > 0 && distances[e - 1] < distances[e]; --e)
+                {
+                    std::swap(distances[e - 1], distances[e]);
+                    std::swap(children[e - 1], children[e]);
+                }
+            for (int c = 0; c < 4; ++c)
+                stack[top++] = children[c];
+        }
+    }
+    return -1;
+}
+}  // namespace USTC_CG
@@ -0,0 +1,24 @@
+#include "fisheye_warper.h"
+
+#include <cmath>
+
+namespace USTC_CG
+{
+Warper::Point FisheyeWarper::warp(const Point& p) const
+{
+    Point d = p - center_;
+    float distance = d.norm();
+    if (distance == 0)
+        return center_;
+    // Simple non-linear transformation r -> r' = f(r)
+    float new_distance = inverse_ ? (distance / 10) * (distance / 10)
+                                  : std::sqrt(distance) * 10;
+    return center_ + d * (new_distance / distance);
+}
+
+std::unique_ptr<Warper> FisheyeWarper::make_inverse() const
+{
+    return std::make_unique<FisheyeWarper>(
+        center_.x(), center_.y(), !inverse_);
+}
+}  // namespace USTC_CG
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "warper.h"
+
+namespace USTC_CG
+{
+// A simple "fish-eye" map around a center c: a point at distance r from c is
+// moved to distance 10 * sqrt(r). It ignores the control points.
+// The inverse is analytic: r = (r' / 10)^2.
+class FisheyeWarper : public Warper
+{
+   public:
+    FisheyeWarper(float center_x, float center_y, bool inverse = false)
+        : center_(center_x, center_y),
+          inverse_(inverse)
+    {
+    }
+    virtual ~FisheyeWarper() = default;
+
+    Point warp(const Point& p) const override;
+    std::unique_ptr<Warper> make_inverse() const override;
+
+   private:
+    Point center_;
+    bool inverse_;
+};
+}  // namespace USTC_CG
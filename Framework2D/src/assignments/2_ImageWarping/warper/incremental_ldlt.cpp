@@ -0,0 +1,92 @@
+#include "incremental_ldlt.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace USTC_CG
+{
+bool IncrementalLDLT::append(const Eigen::VectorXd& column)
+{
+    if (column.size() != n_ + 1)
+        throw std::invalid_argument("Bordering column has the wrong size");
+    // A = [A_n c; c^T a] = [L 0; l^T 1] [D 0; 0 d] [L^T l; 0 1] with
+    //   L D l = c,  d = a - l^T D l.
+    Eigen::VectorXd w = column.head(n_);
+    L_.topLeftCorner(n_, n_)
+        .triangularView<Eigen::UnitLower>()
+        .solveInPlace(w);  // w = D l
+    Eigen::VectorXd l = w.cwiseQuotient(d_.head(n_));
+    const double d = column(n_) - l.dot(w);
+    // Relative to the diagonal entry, which bounds the pivot of a positive
+    // definite matrix and sets the scale otherwise.
+    if (!(std::abs(d) > 1e-10 * std::max(std::abs(column(n_)), 1e-300)))
+        return false;
+
+    reserve(n_ + 1);
+    L_.row(n_).head(n_) = l.transpose();
+    L_(n_, n_) = 1;
+    d_(n_) = d;
+    ++n_;
+    return true;
+}
+
+void IncrementalLDLT::remove(int k)
+{
+    if (k < 0 || k >= n_)
+        throw std::out_of_range("Row index out of bounds");
+    // With row/column k taken out, the trailing block becomes
+    //   L_t D_t L_t^T + d_k l l^T,  l = L(k+1.., k),
+    // which is restored to LDL^T form by a rank-one update (Gill, Golub,
+    // Murray and Saunders 1974, method C1).
+    const int m = n_ - k - 1;
+    Eigen::VectorXd w = L_.col(k).segment(k + 1, m);
+    double alpha = d_(k);
+    for (int j = 0; j < m; ++j)
+    {
+        const int jj = k + 1 + j;
+        const double p = w(j);
+        const double dj = d_(jj) + alpha * p * p;
+        const double beta = p * alpha / dj;
+        alpha = d_(jj) * alpha / dj;
+        d_(jj) = dj;
+        for (int r = j + 1; r < m; ++r)
+        {
+            const int rr = k + 1 + r;
+            w(r) -= p * L_(rr, jj);
+            L_(rr, jj) += beta * w(r);
+        }
+    }
+
+    // Close the gap left by row/column k
+    for (int r = k + 1; r < n_; ++r)
+    {
+        L_.row(r - 1).head(k) = L_.row(r).head(k);
+        L_.row(r - 1).segment(k, r - 1 - k) =
+            L_.row(r).segment(k + 1, r - 1 - k);
+        L_(r - 1, r - 1) = 1;
+        d_(r - 1) = d_(r);
+    }
+    --n_;
+}
+
+void IncrementalLDLT::solve_in_place(Eigen::Ref<Eigen::MatrixXd> b) const
+{
+    if (b.rows() != n_)
+        throw std::invalid_argument("Right-hand side has the wrong size");
+    const auto L = L_.topLeftCorner(n_, n_);
+    L.triangularView<Eigen::UnitLower>().solveInPlace(b);
+    b = d_.head(n_).asDiagonal().inverse() * b;
+    L.transpose().triangularView<Eigen::UnitUpper>().solveInPlace(b);
+}
+
+void IncrementalLDLT::reserve(int capacity)
+{
+    if (capacity <= L_.rows())
+        return;
+    const int grown =
+        std::max(capacity, std::max(16, 2 * static_cast<int>(L_.rows())));
+    L_.conservativeResize(grown, grown);
+    d_.conservativeResize(grown);
+}
+}  // namespace USTC_CG
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <Eigen/Dense>
+
+namespace USTC_CG
+{
+// LDL^T factorization A = L D L^T of a symmetric matrix (L unit lower
+// triangular, D diagonal), built and edited one row/column at a time:
+// - append() borders A with a new last row/column in O(n^2),
+// - remove() drops row/column k with a rank-one update of the trailing
+//   block in O(n^2),
+// instead of the O(n^3) of a new factorization. There is no pivoting, so A
+// must have nonsingular leading blocks, which holds e.g. for the matrices
+// of radial basis functions at distinct centers (positive definite or not).
+class IncrementalLDLT
+{
+   public:
+    int size() const
+    {
+        return n_;
+    }
+    void clear()
+    {
+        n_ = 0;
+    }
+
+    // `column` holds the new last column A(0..n, n) including the diagonal
+    // entry A(n, n). Returns false (and leaves the factorization unchanged)
+    // if the new pivot vanishes, i.e. the bordered matrix is singular.
+    bool append(const Eigen::VectorXd& column);
+
+    // Remove row and column k.
+    void remove(int k);
+
+    // Solve A X = B in place. All columns share the factorization, e.g. the
+    // x and y components of a displacement field.
+    void solve_in_place(Eigen::Ref<Eigen::MatrixXd> b) const;
+
+   private:
+    // Storage grows geometrically; only the top-left n_ x n_ block is used.
+    void reserve(int capacity);
+
+    Eigen::MatrixXd L_;
+    Eigen::VectorXd d_;
+    int n_ = 0;
+};
+}  // namespace USTC_CG
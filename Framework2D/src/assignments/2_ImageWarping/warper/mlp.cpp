@@ -0,0 +1,216 @@
+#include "mlp.h"
+
+#include <algorithm>
+#include <cmath>
+#include <istream>
+#include <limits>
+#include <numeric>
+#include <ostream>
+#include <random>
+
+namespace USTC_CG
+{
+MLP::MLP(const std::vector<int>& layer_sizes)
+{
+    std::mt19937 rng(0);
+    for (std::size_t l = 1; l < layer_sizes.size(); ++l)
+    {
+        const int inputs = layer_sizes[l - 1], outputs = layer_sizes[l];
+        Layer layer;
+        layer.weights = Matrix::Zero(outputs, inputs);
+        layer.bias = Eigen::VectorXf::Zero(outputs);
+        if (l + 1 < layer_sizes.size())
+        {
+            // He initialization, suited to ReLU
+            std::normal_distribution<float> normal(
+                0.0f, std::sqrt(2.0f / static_cast<float>(inputs)));
+            for (int i = 0; i < outputs; ++i)
+                for (int j = 0; j < inputs; ++j)
+                    layer.weights(i, j) = normal(rng);
+        }
+        layers_.push_back(std::move(layer));
+    }
+}
+
+int MLP::num_inputs() const
+{
+    return layers_.empty() ? 0
+                           : static_cast<int>(layers_.front().weights.cols());
+}
+
+int MLP::num_outputs() const
+{
+    return layers_.empty() ? 0
+                           : static_cast<int>(layers_.back().weights.rows());
+}
+
+MLP::Matrix MLP::forward(const Matrix& input) const
+{
+    Matrix a = input;
+    for (std::size_t l = 0; l < layers_.size(); ++l)
+    {
+        Matrix z = layers_[l].weights * a;
+        z.colwise() += layers_[l].bias;
+        if (l + 1 < layers_.size())
+            a = z.cwiseMax(0.0f);
+        else
+            a = std::move(z);
+    }
+    return a;
+}
+
+float MLP::train(
+    const Matrix& inputs,
+    const Matrix& targets,
+    const TrainOptions& options)
+{
+    const int n = static_cast<int>(inputs.cols());
+    if (n == 0 || layers_.empty())
+        return 0;
+    const int batch_size = std::clamp(options.batch_size, 1, n);
+    const std::size_t depth = layers_.size();
+
+    // Adam state
+    constexpr float kBeta1 = 0.9f, kBeta2 = 0.999f, kEpsilon = 1e-8f;
+    std::vector<Layer> m(depth), v(depth);
+    for (std::size_t l = 0; l < depth; ++l)
+    {
+        m[l].weights = v[l].weights = Matrix::Zero(
+            layers_[l].weights.rows(), layers_[l].weights.cols());
+        m[l].bias = v[l].bias = Eigen::VectorXf::Zero(layers_[l].bias.size());
+    }
+
+    std::mt19937 rng(0);
+    std::vector<int> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    int next = n;  // position in the shuffled order
+
+    std::vector<Matrix> activations(depth + 1);
+    Matrix batch_targets(targets.rows(), batch_size);
+    float learning_rate = options.learning_rate;
+    float best_loss = std::numeric_limits<float>::max();
+    int steps_without_progress = 0;
+    for (int step = 1; step <= options.iterations; ++step)
+    {
+        // Next minibatch from a reshuffled epoch
+        activations[0].resize(inputs.rows(), batch_size);
+        for (int b = 0; b < batch_size; ++b)
+        {
+            if (next == n)
+            {
+                std::shuffle(order.begin(), order.end(), rng);
+                next = 0;
+            }
+            activations[0].col(b) = inputs.col(order[next]);
+            batch_targets.col(b) = targets.col(order[next]);
+            ++next;
+        }
+
+        for (std::size_t l = 0; l < depth; ++l)
+        {
+            activations[l + 1] = layers_[l].weights * activations[l];
+            activations[l + 1].colwise() += layers_[l].bias;
+            if (l + 1 < depth)
+                activations[l + 1] = activations[l + 1].cwiseMax(0.0f);
+        }
+        Matrix delta = activations[depth] - batch_targets;
+        const float loss =
+            delta.squaredNorm() / static_cast<float>(delta.size());
+        if (loss < options.target_loss)
+            break;
+        if (loss < best_loss)
+        {
+            best_loss = loss;
+            steps_without_progress = 0;
+        }
+        else if (++steps_without_progress >= options.patience)
+        {
+            learning_rate *= 0.1f;
+            steps_without_progress = 0;
+            if (learning_rate < options.min_learning_rate)
+                break;
+        }
+
+        // Backpropagation, with the Adam update of each layer once its
+        // gradient is known
+        delta *= 2.0f / static_cast<float>(delta.size());
+        const float t = static_cast<float>(step);
+        const float correction1 = 1 - std::pow(kBeta1, t);
+        const float correction2 = 1 - std::pow(kBeta2, t);
+        const float rate = learning_rate * std::sqrt(correction2) / correction1;
+        for (std::size_t l = depth; l-- > 0;)
+        {
+            const Matrix grad_weights = delta * activations[l].transpose();
+            const Eigen::VectorXf grad_bias = delta.rowwise().sum();
+            if (l > 0)
+            {
+                // ReLU: the gradient only flows through active units
+                delta = (layers_[l].weights.transpose() * delta)
+                            .cwiseProduct(
+                                (activations[l].array() > 0.0f)
+                                    .cast<float>()
+                                    .matrix());
+            }
+            m[l].weights = kBeta1 * m[l].weights + (1 - kBeta1) * grad_weights;
+            v[l].weights = kBeta2 * v[l].weights +
+                           (1 - kBeta2) * grad_weights.cwiseAbs2();
+            m[l].bias = kBeta1 * m[l].bias + (1 - kBeta1) * grad_bias;
+            v[l].bias =
+                kBeta2 * v[l].bias + (1 - kBeta2) * grad_bias.cwiseAbs2();
+            layers_[l].weights.array() -=
+                rate * m[l].weights.array() /
+                (v[l].weights.array().sqrt() + kEpsilon);
+            layers_[l].bias.array() -= rate * m[l].bias.array() /
+                                       (v[l].bias.array().sqrt() + kEpsilon);
+        }
+    }
+    const Matrix error = forward(inputs) - targets;
+    return error.squaredNorm() / static_cast<float>(error.size());
+}
+
+void MLP::write(std::ostream& out) const
+{
+    out << layers_.size() << '\n';
+    out.precision(std::numeric_limits<float>::max_digits10);
+    for (const Layer& layer : layers_)
+    {
+        out << layer.weights.rows() << ' ' << layer.weights.cols() << '\n';
+        for (int i = 0; i < layer.weights.rows(); ++i)
+        {
+            for (int j = 0; j < layer.weights.cols(); ++j)
+                out << layer.weights(i, j) << ' ';
+            out << '\n';
+        }
+        for (int i = 0; i < layer.bias.size(); ++i)
+            out << layer.bias(i) << ' ';
+        out << '\n';
+    }
+}
+
+bool MLP::read(std::istream& in)
+{
+    std::size_t depth = 0;
+    if (!(in >> depth))
+        return false;
+    std::vector<Layer> layers(depth);
+    for (std::size_t l = 0; l < depth; ++l)
+    {
+        int rows = 0, cols = 0;
+        if (!(in >> rows >> cols) || rows <= 0 || cols <= 0 ||
+            (l > 0 && cols != layers[l - 1].weights.rows()))
+            return false;
+        Layer& layer = layers[l];
+        layer.weights.resize(rows, cols);
+        layer.bias.resize(rows);
+        for (int i = 0; i < rows; ++i)
+            for (int j = 0; j < cols; ++j)
+                in >> layer.weights(i, j);
+        for (int i = 0; i < rows; ++i)
+            in >> layer.bias(i);
+        if (!in)
+            return false;
+    }
+    layers_ = std::move(layers);
+    return true;
+}
+}  // namespace USTC_CG
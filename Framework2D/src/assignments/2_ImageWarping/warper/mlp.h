@@ -0,0 +1,67 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <iosfwd>
+#include <vector>
+
+namespace USTC_CG
+{
+// A small fully connected network: ReLU after every layer but the last,
+// which is linear. Samples are the columns of the input and output
+// matrices, so a whole batch goes through one matrix product per layer.
+class MLP
+{
+   public:
+    using Matrix = Eigen::MatrixXf;
+
+    struct TrainOptions
+    {
+        int iterations = 2000;  // Adam steps at most
+        int batch_size = 128;
+        float learning_rate = 1e-3f;
+        float min_learning_rate = 1e-6f;
+        // The learning rate is divided by 10 after this many steps without
+        // improvement of the loss, and training stops below the minimum.
+        int patience = 500;
+        // Training also stops once the mean squared error is below this.
+        float target_loss = 1e-6f;
+    };
+
+    MLP() = default;
+    // layer_sizes = { inputs, hidden..., outputs }. The hidden layers are
+    // initialized randomly (fixed seed), the output layer to zero.
+    explicit MLP(const std::vector<int>& layer_sizes);
+
+    bool empty() const
+    {
+        return layers_.empty();
+    }
+    int num_inputs() const;
+    int num_outputs() const;
+
+    // Outputs for the columns of `input`.
+    Matrix forward(const Matrix& input) const;
+
+    // Minimize the mean squared error to `targets` (one column per input
+    // column) with Adam on minibatches. Returns the final error over all
+    // samples.
+    float train(
+        const Matrix& inputs,
+        const Matrix& targets,
+        const TrainOptions& options);
+
+    // Plain text: the number of layers, then for each layer its size
+    // (outputs, inputs), weights (row by row) and biases.
+    void write(std::ostream& out) const;
+    bool read(std::istream& in);
+
+   private:
+    struct Layer
+    {
+        Matrix weights;
+        Eigen::VectorXf bias;
+    };
+
+    std::vector<Layer> layers_;
+};
+}  // namespace USTC_CG
@@ -0,0 +1,126 @@
+#include "neural_warper.h"
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+
+namespace USTC_CG
+{
+namespace
+{
+MLP make_network()
+{
+    return MLP({ 2, 64, 64, 2 });
+}
+}  // namespace
+
+NeuralWarper::NeuralWarper(const MLP::TrainOptions& options)
+    : options_(options),
+      net_(make_network())
+{
+}
+
+void NeuralWarper::fit()
+{
+    net_ = make_network();
+    training_error_ = 0;
+    const int n = static_cast<int>(start_points_.size());
+    mean_.setZero();
+    scale_.setOnes();
+    if (n == 0)
+        return;
+
+    for (const Point& p : start_points_)
+        mean_ += p;
+    mean_ /= static_cast<float>(n);
+    Eigen::Vector2f variance = Eigen::Vector2f::Zero();
+    for (const Point& p : start_points_)
+        variance += (p - mean_).cwiseAbs2();
+    // At least a pixel, so that a single pair (or a line of pairs) does not
+    // blow up the normalized coordinates
+    scale_ = (variance / static_cast<float>(n))
+                 .cwiseSqrt()
+                 .cwiseMax(Eigen::Vector2f::Ones());
+
+    MLP::Matrix inputs(2, n), targets(2, n);
+    for (int i = 0; i < n; ++i)
+    {
+        inputs.col(i) = (start_points_[i] - mean_).cwiseQuotient(scale_);
+        targets.col(i) =
+            (end_points_[i] - start_points_[i]).cwiseQuotient(scale_);
+    }
+    net_.train(inputs, targets, options_);
+
+    std::vector<Point> fitted(n);
+    warp_batch(start_points_, fitted);
+    for (int i = 0; i < n; ++i)
+        training_error_ += (fitted[i] - end_points_[i]).squaredNorm();
+    training_error_ /= static_cast<float>(n);
+}
+
+Warper::Point NeuralWarper::warp(const Point& p) const
+{
+    Point result;
+    warp_batch(std::span<const Point>(&p, 1), std::span<Point>(&result, 1));
+    return result;
+}
+
+void NeuralWarper::warp_batch(
+    std::span<const Point> points,
+    std::span<Point> result) const
+{
+    MLP::Matrix input;
+    for (std::size_t begin = 0; begin < points.size(); begin += kBatchColumns)
+    {
+        const int count = static_cast<int>(
+            std::min<std::size_t>(kBatchColumns, points.size() - begin));
+        input.resize(2, count);
+        for (int i = 0; i < count; ++i)
+            input.col(i) =
+                (points[begin + i] - mean_).cwiseQuotient(scale_);
+        const MLP::Matrix output = net_.forward(input);
+        for (int i = 0; i < count; ++i)
+            result[begin + i] =
+                points[begin + i] + output.col(i).cwiseProduct(scale_);
+    }
+}
+
+std::unique_ptr<Warper> NeuralWarper::make_inverse() const
+{
+    if (start_points_.empty())
+        return nullptr;
+    auto inverse = std::make_unique<NeuralWarper>(options_);
+    inverse->set_grid_cache(grid_spacing(), grid_tolerance());
+    inverse->set_control_points(end_points_, start_points_);
+    return inverse;
+}
+
+bool NeuralWarper::save(const std::string& filename) const
+{
+    std::ofstream file(filename);
+    if (!file.is_open())
+        return false;
+    file.precision(std::numeric_limits<float>::max_digits10);
+    file << "neural_warper\n";
+    file << mean_.x() << ' ' << mean_.y() << ' ' << scale_.x() << ' '
+         << scale_.y() << '\n';
+    net_.write(file);
+    return static_cast<bool>(file);
+}
+
+bool NeuralWarper::load(const std::string& filename)
+{
+    std::ifstream file(filename);
+    std::string header;
+    Eigen::Vector2f mean, scale;
+    MLP net;
+    if (!(file >> header) || header != "neural_warper" ||
+        !(file >> mean.x() >> mean.y() >> scale.x() >> scale.y()) ||
+        !net.read(file) || net.num_inputs() != 2 || net.num_outputs() != 2)
+        return false;
+    mean_ = mean;
+    scale_ = scale;
+    net_ = std::move(net);
+    return true;
+}
+}  // namespace USTC_CG
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+
+#include "mlp.h"
+#include "warper.h"
+
+namespace USTC_CG
+{
+// A map learnt from the control pairs by a small MLP (2-64-64-2 with ReLU,
+// the network of the dlib example of the assignment, implemented on Eigen):
+//   f(p) = p + s * net((p - m) / s),
+// where m and s are the mean and standard deviation of the start points.
+// The network predicts the displacement and its output layer starts at
+// zero, so f is the identity until trained.
+//
+// Whole images are evaluated with warp_batch(): every row of pixels is one
+// minibatch, i.e. three matrix products instead of a network call per pixel.
+class NeuralWarper : public Warper
+{
+   public:
+    explicit NeuralWarper(const MLP::TrainOptions& options = {});
+    virtual ~NeuralWarper() = default;
+
+    Point warp(const Point& p) const override;
+    void warp_batch(std::span<const Point> points, std::span<Point> result)
+        const override;
+    // Another network trained on the reversed pairs, or nullptr without
+    // control pairs.
+    std::unique_ptr<Warper> make_inverse() const override;
+
+    // Save the trained network with its normalization, or load one instead
+    // of training; a loaded network is used until the control pairs change.
+    bool save(const std::string& filename) const;
+    bool load(const std::string& filename);
+
+    // Mean squared error of the last training, in pixels squared.
+    float training_error() const
+    {
+        return training_error_;
+    }
+
+   protected:
+    void fit() override;
+
+   private:
+    // Columns evaluated at once by warp_batch(); bounds the size of the
+    // hidden activations (64 x kBatchColumns floats per layer).
+    static constexpr int kBatchColumns = 1024;
+
+    MLP::TrainOptions options_;
+    MLP net_;
+    Eigen::Vector2f mean_ = Eigen::Vector2f::Zero();
+    Eigen::Vector2f scale_ = Eigen::Vector2f::Ones();
+    float training_error_ = 0;
+};
+}  // namespace USTC_CG
@@ -0,0 +1,79 @@
+#include "warper.h"
+
+#include <stdexcept>
+
+#include "common/tile_scheduler.h"
+#include "displacement_grid.h"
+
+namespace USTC_CG
+{
+void Warper::set_control_points(
+    const std::vector<Point>& start_points,
+    const std::vector<Point>& end_points)
+{
+    if (start_points.size() != end_points.size())
+        throw std::invalid_argument(
+            "Start and end points must be given in pairs");
+    start_points_ = start_points;
+    end_points_ = end_points;
+    fit();
+}
+
+void Warper::add_control_point(const Point& p, const Point& q)
+{
+    start_points_.push_back(p);
+    end_points_.push_back(q);
+    fit();
+}
+
+void Warper::remove_control_point(std::size_t index)
+{
+    if (index >= start_points_.size())
+        throw std::out_of_range("Control point index out of bounds");
+    start_points_.erase(start_points_.begin() + index);
+    end_points_.erase(end_points_.begin() + index);
+    fit();
+}
+
+void Warper::set_far_field(float tolerance)
+{
+    if (tolerance > 0 && !supports_far_field())
+        throw std::invalid_argument("This map has no far-field backend");
+    far_field_tolerance_ = tolerance;
+    build_evaluator();
+}
+
+void Warper::warp_field(int width, int height, std::vector<Point>& field) const
+{
+    if (grid_spacing_ > 0)
+    {
+        evaluate_on_grid(
+            *this, width, height, grid_spacing_, grid_tolerance_, field);
+        return;
+    }
+    field.resize(static_cast<std::size_t>(width) * height);
+    TileScheduler::instance().parallel_for(
+        height,
+        [&](std::size_t begin, std::size_t end)
+        {
+            std::vector<Point> row(width);
+            for (std::size_t y = begin; y < end; ++y)
+            {
+                const float row_y = static_cast<float>(y);
+                for (int x = 0; x < width; ++x)
+                    row[x] = Point(static_cast<float>(x), row_y);
+                warp_batch(
+                    row,
+                    std::span<Point>(field.data() + y * width, width));
+            }
+        },
+        1);
+}
+
+void Warper::warp_batch(std::span<const Point> points, std::span<Point> result)
+    const
+{
+    for (std::size_t i = 0; i < points.size(); ++i)
+        result[i] = warp(points[i]);
+}
+}  // namespace USTC_CG
@@ -1,24 +1,129 @@
-// HW2_TODO: Please implement the abstract class Warper
-// 1. The Warper class should abstract the **mathematical mapping** involved in
-// the warping problem, **independent of image**.
-// 2. The Warper class should have a virtual function warp(...) to be called in
-// our image warping application.
-//    - You should design the inputs and outputs of warp(...) according to the
-//    mathematical abstraction discussed in class.
-//    - Generally, the warping map should map one input point to another place.
-// 3. Subclasses of Warper, IDWWarper and RBFWarper, should implement the
-// warp(...) function to perform the actual warping.
+// Abstract class of the warping maps.
+// 1. The Warper class abstracts the **mathematical mapping** involved in the
+// warping problem, **independent of image**: it maps a point p of the plane to
+// f(p), and f interpolates the control pairs f(p_i) = q_i.
+// 2. Subclasses (FisheyeWarper, IDWWarper, RBFWarper, NeuralWarper) implement
+// warp(...).
+// 3. Inverse mapping (looking up the source of every destination pixel) needs
+// f^{-1}; subclasses that can provide it override make_inverse().
+// 4. Whole images are evaluated through warp_field(), which can optionally
+// approximate f on a coarse lattice (see set_grid_cache()), and the maps
+// summing over all pairs can use a hierarchical backend (set_far_field()).
 #pragma once
 
+#include <Eigen/Dense>
+#include <memory>
+#include <span>
+#include <vector>
+
 namespace USTC_CG
 {
 class Warper
 {
    public:
+    using Point = Eigen::Vector2f;
+
     virtual ~Warper() = default;
 
-    // HW2_TODO: A virtual function warp(...)
-    
-    // HW2_TODO: other functions or variables if you need
+    // Set the control pairs (p_i, q_i) and fit the map to them.
+    void set_control_points(
+        const std::vector<Point>& start_points,
+        const std::vector<Point>& end_points);
+
+    // Add the pair (p, q), or remove the pair at `index`, and update the fit.
+    // By default the map is refitted from scratch; maps that can update
+    // their fit in place override these.
+    virtual void add_control_point(const Point& p, const Point& q);
+    virtual void remove_control_point(std::size_t index);
+
+    // Map a point p to f(p).
+    virtual Point warp(const Point& p) const = 0;
+    // f at many points at once: result[i] = f(points[i]). Calls warp() by
+    // default; maps with a cheaper batched evaluation override it.
+    virtual void warp_batch(
+        std::span<const Point> points,
+        std::span<Point> result) const;
+
+    // f(x, y) at every pixel of a width x height image, row-major. Exact by
+    // default (one warp_batch() call per row); with a grid cache the
+    // displacement f(p) - p is evaluated exactly on a lattice and bilinearly
+    // interpolated in between.
+    void warp_field(int width, int height, std::vector<Point>& field) const;
+
+    // Evaluate the lattice every `spacing` pixels (0 disables the cache).
+    // Lattice cells where the interpolation looks off by more than
+    // `tolerance` pixels (tested at a few points of each cell, with a
+    // margin: the error is estimated, not bounded) are subdivided, and
+    // cells holding a control point are evaluated exactly. This pays off for
+    // the maps whose cost per point grows with the number of pairs (IDW,
+    // RBF), as long as most cells hold no control point.
+    void set_grid_cache(int spacing, float tolerance = 0.5f)
+    {
+        grid_spacing_ = spacing;
+        grid_tolerance_ = tolerance;
+    }
+    int grid_spacing() const
+    {
+        return grid_spacing_;
+    }
+    float grid_tolerance() const
+    {
+        return grid_tolerance_;
+    }
+
+    // Evaluation backend of the maps summing over all control pairs. A
+    // tolerance of 0 (the default) sums every pair exactly; a tolerance > 0
+    // (in pixels) sums the pairs far from p through a quadtree over the
+    // start points, opening its nodes until a bound of the error of f(p) is
+    // within the tolerance (see FarFieldEvaluator). Larger tolerances are
+    // faster. Throws std::invalid_argument for a tolerance > 0 if the map
+    // has no such backend (see supports_far_field()).
+    void set_far_field(float tolerance);
+    float far_field() const
+    {
+        return far_field_tolerance_;
+    }
+
+    // Whether set_far_field() accepts a tolerance > 0. Only IDW has a
+    // far-field backend: the RBF coefficients are large and of both signs,
+    // and a bound of its expansion error opens nearly every node.
+    virtual bool supports_far_field() const
+    {
+        return false;
+    }
+
+    // A warper computing (an approximation of) f^{-1}, or nullptr if this
+    // map has no inverse available.
+    virtual std::unique_ptr<Warper> make_inverse() const
+    {
+        return nullptr;
+    }
+
+    const std::vector<Point>& start_points() const
+    {
+        return start_points_;
+    }
+    const std::vector<Point>& end_points() const
+    {
+        return end_points_;
+    }
+
+   protected:
+    // Called after the control points changed, to (re)compute the parameters
+    // of the map.
+    virtual void fit()
+    {
+    }
+    // Called when the evaluation backend changed, to (re)build its data.
+    virtual void build_evaluator()
+    {
+    }
+
+    std::vector<Point> start_points_, end_points_;
+
+   private:
+    int grid_spacing_ = 0;
+    float grid_tolerance_ = 0.5f;
+    float far_field_tolerance_ = 0;
 };
-}  // namespace USTC_CG
\ No newline at end of file
+}  // namespace USTC_CG
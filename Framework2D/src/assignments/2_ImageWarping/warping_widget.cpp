@@ -3,15 +3,23 @@
 #include <cmath>
 #include <iostream>
 
+#include "common/image_ops.h"
+#include "common/profiler.h"
+#include "core/hole_filling.h"
+#include "core/warping_pipeline.h"
+
 namespace USTC_CG
 {
 using uchar = unsigned char;
 
-WarpingWidget::WarpingWidget(const std::string& label, const std::string& filename)
-    : ImageWidget(label, filename)
+WarpingWidget::WarpingWidget(
+    const std::string& label,
+    const std::string& filename,
+    std::shared_ptr<Image> data)
+    : ImageWidget(label, filename, std::move(data))
 {
     if (data_)
-        back_up_ = std::make_shared<Image>(*data_);
+        history_.reset(*data_);
 }
 
 void WarpingWidget::draw()
@@ -25,160 +33,134 @@ void WarpingWidget::draw()
 
 void WarpingWidget::invert()
 {
-    for (int i = 0; i < data_->width(); ++i)
-    {
-        for (int j = 0; j < data_->height(); ++j)
-        {
-            const auto color = data_->get_pixel(i, j);
-            data_->set_pixel(
-                i,
-                j,
-                { static_cast<uchar>(255 - color[0]),
-                  static_cast<uchar>(255 - color[1]),
-                  static_cast<uchar>(255 - color[2]) });
-        }
-    }
-    // After change the image, we should reload the image data to the renderer
-    update();
+    image_ops::invert(*data_);
+    commit_edit();
 }
 void WarpingWidget::mirror(bool is_horizontal, bool is_vertical)
 {
-    Image image_tmp(*data_);
-    int width = data_->width();
-    int height = data_->height();
+    image_ops::mirror(*data_, is_horizontal, is_vertical);
+    commit_edit();
+}
+void WarpingWidget::gray_scale()
+{
+    image_ops::gray_scale(*data_);
+    commit_edit();
+}
+void WarpingWidget::warping()
+{
+    ScopedTimer timer("warping");
+    // The warping maps (warper/) are independent of the image; applying them
+    // to the pixels is done by the GUI-free pipeline in core/, which is shared
+    // with the command line tool.
+    if (!warper_ || warper_type_ != warping_type_)
+        create_warpers();
+    if (!warper_)
+        return;
+    const float far_field = far_field_available() ? far_field_ : 0.0f;
+    warper_->set_grid_cache(grid_spacing_);
+    if (warper_->far_field() != far_field)
+        warper_->set_far_field(far_field);
+    if (inverse_warper_)
+    {
+        inverse_warper_->set_grid_cache(grid_spacing_);
+        if (inverse_warper_->far_field() != far_field)
+            inverse_warper_->set_far_field(far_field);
+    }
 
-    if (is_horizontal)
+    // Inverse mapping samples the source at f^{-1}(x, y) for every target
+    // pixel, which leaves no holes; maps without an inverse are forward
+    // warped and their holes filled afterwards.
+    if (inverse_mapping_ && inverse_warper_)
     {
-        if (is_vertical)
-        {
-            for (int i = 0; i < width; ++i)
-            {
-                for (int j = 0; j < height; ++j)
-                {
-                    data_->set_pixel(
-                        i,
-                        j,
-                        image_tmp.get_pixel(width - 1 - i, height - 1 - j));
-                }
-            }
-        }
-        else
-        {
-            for (int i = 0; i < width; ++i)
-            {
-                for (int j = 0; j < height; ++j)
-                {
-                    data_->set_pixel(
-                        i, j, image_tmp.get_pixel(width - 1 - i, j));
-                }
-            }
-        }
+        *data_ = inverse_warp_image(*data_, *inverse_warper_, interpolation_);
     }
     else
     {
-        if (is_vertical)
-        {
-            for (int i = 0; i < width; ++i)
-            {
-                for (int j = 0; j < height; ++j)
-                {
-                    data_->set_pixel(
-                        i, j, image_tmp.get_pixel(i, height - 1 - j));
-                }
-            }
-        }
+        std::vector<unsigned char> written;
+        *data_ = warp_image(*data_, *warper_, &written);
+        if (hole_neighbors_ > 0)
+            fill_holes(*data_, written, hole_neighbors_);
     }
-
-    // After change the image, we should reload the image data to the renderer
-    update();
+    commit_edit();
 }
-void WarpingWidget::gray_scale()
+void WarpingWidget::commit_edit()
 {
-    for (int i = 0; i < data_->width(); ++i)
-    {
-        for (int j = 0; j < data_->height(); ++j)
-        {
-            const auto color = data_->get_pixel(i, j);
-            uchar gray_value = (color[0] + color[1] + color[2]) / 3;
-            data_->set_pixel(i, j, { gray_value, gray_value, gray_value });
-        }
-    }
+    // Tiles the edit left unchanged stay shared with the previous step
+    history_.commit(*data_);
     // After change the image, we should reload the image data to the renderer
     update();
 }
-void WarpingWidget::warping()
+void WarpingWidget::create_warpers()
 {
-    // HW2_TODO: You should implement your own warping function that interpolate
-    // the selected points.
-    // Please design a class for such warping operations, utilizing the
-    // encapsulation, inheritance, and polymorphism features of C++. 
-
-    // Create a new image to store the result
-    Image warped_image(*data_);
-    // Initialize the color of result image
-    for (int y = 0; y < data_->height(); ++y)
+    std::vector<Warper::Point> start_points, end_points;
+    for (size_t i = 0; i < start_points_.size(); ++i)
     {
-        for (int x = 0; x < data_->width(); ++x)
-        {
-            warped_image.set_pixel(x, y, { 0, 0, 0 });
-        }
+        start_points.emplace_back(start_points_[i].x, start_points_[i].y);
+        end_points.emplace_back(end_points_[i].x, end_points_[i].y);
     }
 
+    const char* name = nullptr;
     switch (warping_type_)
     {
         case kDefault: break;
-        case kFisheye:
-        {
-            // Example: (simplified) "fish-eye" warping
-            // For each (x, y) from the input image, the "fish-eye" warping
-            // transfer it to (x', y') in the new image: Note: For this
-            // transformation ("fish-eye" warping), one can also calculate the
-            // inverse (x', y') -> (x, y) to fill in the "gaps".
-            for (int y = 0; y < data_->height(); ++y)
-            {
-                for (int x = 0; x < data_->width(); ++x)
-                {
-                    // Apply warping function to (x, y), and we can get (x', y')
-                    auto [new_x, new_y] =
-                        fisheye_warping(x, y, data_->width(), data_->height());
-                    // Copy the color from the original image to the result
-                    // image
-                    if (new_x >= 0 && new_x < data_->width() && new_y >= 0 &&
-                        new_y < data_->height())
-                    {
-                        std::vector<unsigned char> pixel =
-                            data_->get_pixel(x, y);
-                        warped_image.set_pixel(new_x, new_y, pixel);
-                    }
-                }
-            }
-            break;
-        }
-        case kIDW:
-        {
-            // HW2_TODO: Implement the IDW warping
-            // use selected points start_points_, end_points_ to construct the map
-            std::cout << "IDW not implemented." << std::endl;
-            break;
-        }
-        case kRBF:
-        {
-            // HW2_TODO: Implement the RBF warping
-            // use selected points start_points_, end_points_ to construct the map
-            std::cout << "RBF not implemented." << std::endl;
-            break;
-        }
+        case kFisheye: name = "fisheye"; break;
+        // use selected points start_points_, end_points_ to construct the map
+        case kIDW: name = "idw"; break;
+        case kRBF: name = "rbf"; break;
+        case kNeural: name = "neural"; break;
         default: break;
     }
-
-    *data_ = std::move(warped_image);
-    update();
+    warper_ = name ? create_warper(
+                         name,
+                         data_->width(),
+                         data_->height(),
+                         start_points,
+                         end_points)
+                   : nullptr;
+    inverse_warper_ = warper_ ? warper_->make_inverse() : nullptr;
+    warper_type_ = warping_type_;
+}
+void WarpingWidget::add_pair(const ImVec2& start, const ImVec2& end)
+{
+    start_points_.push_back(start);
+    end_points_.push_back(end);
+    // RBF updates its factorization and IDW refits in O(pairs^2), cheap
+    // enough for every click. The neural map retrains its networks: it is
+    // only fitted by warping(), once for all the pairs.
+    if (warping_type_ != kIDW && warping_type_ != kRBF)
+    {
+        warper_.reset();
+        inverse_warper_.reset();
+        return;
+    }
+    // Update the maps in place, instead of refitting them on warping()
+    if (warper_ && warper_type_ == warping_type_)
+    {
+        Warper::Point p(start.x, start.y), q(end.x, end.y);
+        warper_->add_control_point(p, q);
+        if (inverse_warper_)
+            inverse_warper_->add_control_point(q, p);
+    }
+    else
+    {
+        create_warpers();
+    }
 }
 void WarpingWidget::restore()
 {
-    *data_ = *back_up_;
+    history_.go_to(*data_, 0);
     update();
 }
+void WarpingWidget::undo()
+{
+    if (history_.undo(*data_))
+        update();
+}
+void WarpingWidget::redo()
+{
+    if (history_.redo(*data_))
+        update();
+}
 void WarpingWidget::set_default()
 {
     warping_type_ = kDefault;
@@ -195,6 +177,43 @@ void WarpingWidget::set_RBF()
 {
     warping_type_ = kRBF;
 }
+void WarpingWidget::set_neural()
+{
+    warping_type_ = kNeural;
+}
+void WarpingWidget::set_inverse_mapping(bool flag)
+{
+    inverse_mapping_ = flag;
+}
+bool WarpingWidget::inverse_mapping() const
+{
+    return inverse_mapping_;
+}
+void WarpingWidget::set_interpolation(Interpolation interpolation)
+{
+    interpolation_ = interpolation;
+}
+Interpolation WarpingWidget::interpolation() const
+{
+    return interpolation_;
+}
+void WarpingWidget::set_grid_cache(int spacing)
+{
+    grid_spacing_ = spacing;
+}
+void WarpingWidget::set_far_field(float tolerance)
+{
+    far_field_ = tolerance;
+}
+bool WarpingWidget::far_field_available() const
+{
+    // See Warper::supports_far_field()
+    return warping_type_ == kIDW;
+}
+void WarpingWidget::set_hole_filling(int k)
+{
+    hole_neighbors_ = k;
+}
 void WarpingWidget::enable_selecting(bool flag)
 {
     flag_enable_selecting_points_ = flag;
@@ -224,8 +243,7 @@ void WarpingWidget::select_points()
         end_ = ImVec2(io.MousePos.x - position_.x, io.MousePos.y - position_.y);
         if (!ImGui::IsMouseDown(ImGuiMouseButton_Left))
         {
-            start_points_.push_back(start_);
-            end_points_.push_back(end_);
+            add_pair(start_, end_);
             draw_status_ = false;
         }
     }
@@ -253,29 +271,13 @@ void WarpingWidget::init_selections()
 {
     start_points_.clear();
     end_points_.clear();
+    warper_.reset();
+    inverse_warper_.reset();
 }
-
-std::pair<int, int>
-WarpingWidget::fisheye_warping(int x, int y, int width, int height)
+void WarpingWidget::view_changed()
 {
-    float center_x = width / 2.0f;
-    float center_y = height / 2.0f;
-    float dx = x - center_x;
-    float dy = y - center_y;
-    float distance = std::sqrt(dx * dx + dy * dy);
-
-    // Simple non-linear transformation r -> r' = f(r)
-    float new_distance = std::sqrt(distance) * 10;
-
-    if (distance == 0)
-    {
-        return { static_cast<int>(center_x), static_cast<int>(center_y) };
-    }
-    // (x', y')
-    float ratio = new_distance / distance;
-    int new_x = static_cast<int>(center_x + dx * ratio);
-    int new_y = static_cast<int>(center_y + dy * ratio);
-
-    return { new_x, new_y };
+    history_.reset(*data_);
+    init_selections();
+    draw_status_ = false;
 }
 }  // namespace USTC_CG
\ No newline at end of file
@@ -1,6 +1,11 @@
 #pragma once
 
+#include <memory>
+
+#include "common/image_history.h"
 #include "common/image_widget.h"
+#include "core/resampler.h"
+#include "warper/warper.h"
 
 namespace USTC_CG
 {
@@ -10,7 +15,8 @@ class WarpingWidget : public ImageWidget
    public:
     explicit WarpingWidget(
         const std::string& label,
-        const std::string& filename);
+        const std::string& filename,
+        std::shared_ptr<Image> data = nullptr);
     virtual ~WarpingWidget() noexcept = default;
 
     void draw() override;
@@ -20,7 +26,10 @@ class WarpingWidget : public ImageWidget
     void mirror(bool is_horizontal, bool is_vertical);
     void gray_scale();
     void warping();
+    // Every edit is a step of the history
     void restore();
+    void undo();
+    void redo();
 
     // Enumeration for supported warping types.
     // HW2_TODO: more warping types.
@@ -30,32 +39,74 @@ class WarpingWidget : public ImageWidget
         kFisheye = 1,
         kIDW = 2,
         kRBF = 3,
+        kNeural = 4,
     };
     // Warping type setters.
     void set_default();
     void set_fisheye();
     void set_IDW();
     void set_RBF();
+    void set_neural();
+
+    // Resampling options. With inverse mapping enabled (the default), every
+    // target pixel is looked up in the source with the chosen interpolation;
+    // otherwise pixels are scattered forward, which may leave holes.
+    void set_inverse_mapping(bool flag);
+    bool inverse_mapping() const;
+    void set_interpolation(Interpolation interpolation);
+    Interpolation interpolation() const;
+    // Evaluate IDW/RBF maps on a lattice every `spacing` pixels (0: exact at
+    // every pixel), see Warper::set_grid_cache().
+    void set_grid_cache(int spacing);
+    // Hierarchical evaluation of IDW within `tolerance` pixels (0:
+    // exact sum over all pairs), see Warper::set_far_field(). Only used
+    // when far_field_available().
+    void set_far_field(float tolerance);
+    // Whether the selected warping type has a far-field backend
+    bool far_field_available() const;
+    // Fill the holes of forward warps from the k nearest warped pixels
+    // bordering them (0: leave them black), see fill_holes().
+    void set_hole_filling(int k);
 
     // Point selecting interaction
     void enable_selecting(bool flag);
     void select_points();
     void init_selections();
 
+   protected:
+    // A new view of a tiled image: its history and pairs start over
+    void view_changed() override;
+
    private:
-    // Store the original image data
-    std::shared_ptr<Image> back_up_;
+    // Build the maps of the selected pairs for the current warping type.
+    void create_warpers();
+    // Record a selected pair, and update the IDW or RBF maps with it; the
+    // other maps are built by warping().
+    void add_pair(const ImVec2& start, const ImVec2& end);
+
+    // Record the edit just applied to the whole image as a step
+    void commit_edit();
+
+    // Steps of the edits since the image was loaded
+    ImageHistory history_;
     // The selected point couples for image warping
     std::vector<ImVec2> start_points_, end_points_;
 
     ImVec2 start_, end_;
     bool flag_enable_selecting_points_ = false;
     bool draw_status_ = false;
-    WarpingType warping_type_;
-
-   private:
-    // A simple "fish-eye" warping function
-    std::pair<int, int> fisheye_warping(int x, int y, int width, int height);
+    WarpingType warping_type_ = kDefault;
+    bool inverse_mapping_ = true;
+    Interpolation interpolation_ = kBilinear;
+    int grid_spacing_ = 0;
+    float far_field_ = 0;
+    int hole_neighbors_ = 4;
+    // The map of the selected pairs and its inverse. IDW and RBF maps are
+    // created with the first pair and updated as pairs are added (RBF keeps
+    // its factorization), so warping() does not refit them from scratch;
+    // the others are created by warping().
+    std::unique_ptr<Warper> warper_, inverse_warper_;
+    WarpingType warper_type_ = kDefault;
 };
 
 }  // namespace USTC_CG
\ No newline at end of file
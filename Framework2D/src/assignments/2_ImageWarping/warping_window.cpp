@@ -2,6 +2,7 @@
 
 #include <ImGuiFileDialog.h>
 
+#include <filesystem>
 #include <iostream>
 
 namespace USTC_CG
@@ -15,10 +16,13 @@ ImageWarping::~ImageWarping()
 void ImageWarping::draw()
 {
     draw_toolbar();
+    draw_io_status();
     if (flag_open_file_dialog_)
         draw_open_image_file_dialog();
     if (flag_save_file_dialog_ && p_image_)
         draw_save_image_file_dialog();
+    if (flag_convert_file_dialog_)
+        draw_convert_image_file_dialog();
 
     const ImGuiViewport* viewport = ImGui::GetMainViewport();
     ImGui::SetNextWindowPos(viewport->WorkPos);
@@ -48,6 +52,12 @@ void ImageWarping::draw_toolbar()
             {
                 flag_save_file_dialog_ = true;
             }
+            // Large images are edited from a tiled copy, a view at a time;
+            // saving one exports the whole image as PNG
+            if (ImGui::MenuItem("Convert to Tiled.."))
+            {
+                flag_convert_file_dialog_ = true;
+            }
             ImGui::EndMenu();
         }
         ImGui::Separator();
@@ -81,18 +91,61 @@ void ImageWarping::draw_toolbar()
         ImGui::RadioButton("Fisheye", &warping_type, 0);
         ImGui::RadioButton("IDW", &warping_type, 1);
         ImGui::RadioButton("RBF", &warping_type, 2);
+        ImGui::RadioButton("Neural", &warping_type, 3);
         if (warping_type == 0 && p_image_)
             p_image_->set_fisheye();
         else if (warping_type == 1 && p_image_)
             p_image_->set_IDW();
         else if (warping_type == 2 && p_image_)
             p_image_->set_RBF();
+        else if (warping_type == 3 && p_image_)
+            p_image_->set_neural();
         // HW2_TODO: You can add more interactions for IDW, RBF, etc.
+        // Resampling: inverse mapping with the chosen interpolation, or the
+        // plain forward mapping when unchecked
+        ImGui::Separator();
+        static bool inverse_mapping = true;
+        static int interpolation = kBilinear;
+        ImGui::Checkbox("Inverse", &inverse_mapping);
+        ImGui::RadioButton("Nearest", &interpolation, kNearest);
+        ImGui::RadioButton("Bilinear", &interpolation, kBilinear);
+        ImGui::RadioButton("Bicubic", &interpolation, kBicubic);
+        // Approximate IDW/RBF on an 8 px lattice with adaptive refinement;
+        // off by default, since its error is estimated, not bounded
+        static bool grid_cache = false;
+        ImGui::Checkbox("Grid cache", &grid_cache);
+        // Quadtree far-field sums over the IDW pairs, within the given
+        // tolerance in pixels (0: exact); disabled for the other maps
+        static float far_field = 0.0f;
+        ImGui::BeginDisabled(!p_image_ || !p_image_->far_field_available());
+        ImGui::SliderFloat("Far field (px)", &far_field, 0.0f, 2.0f, "%.2f");
+        ImGui::EndDisabled();
+        // Forward warps: fill the holes from the 4 nearest warped pixels
+        // bordering them
+        static bool fill_holes = true;
+        ImGui::Checkbox("Fill holes", &fill_holes);
+        if (p_image_)
+        {
+            p_image_->set_inverse_mapping(inverse_mapping);
+            p_image_->set_interpolation(
+                static_cast<Interpolation>(interpolation));
+            p_image_->set_grid_cache(grid_cache ? 8 : 0);
+            p_image_->set_far_field(far_field);
+            p_image_->set_hole_filling(fill_holes ? 4 : 0);
+        }
         ImGui::Separator();
         if (ImGui::MenuItem("Restore") && p_image_)
         {
             p_image_->restore();
         }
+        if (ImGui::MenuItem("Undo") && p_image_)
+        {
+            p_image_->undo();
+        }
+        if (ImGui::MenuItem("Redo") && p_image_)
+        {
+            p_image_->redo();
+        }
         ImGui::EndMainMenuBar();
     }
 }
@@ -100,6 +153,8 @@ void ImageWarping::draw_image()
 {
     const auto& canvas_min = ImGui::GetCursorScreenPos();
     const auto& canvas_size = ImGui::GetContentRegionAvail();
+    // A tiled image shows as much of itself as the window holds
+    p_image_->fit_view(canvas_size);
     const auto& image_size = p_image_->get_image_size();
     // Center the image in the window
     ImVec2 pos = ImVec2(
@@ -114,7 +169,10 @@ void ImageWarping::draw_open_image_file_dialog()
     config.path = DATA_PATH;
     config.flags = ImGuiFileDialogFlags_Modal;
     ImGuiFileDialog::Instance()->OpenDialog(
-        "ChooseImageOpenFileDlg", "Choose Image File", ".png,.jpg", config);
+        "ChooseImageOpenFileDlg",
+        "Choose Image File",
+        ".png,.jpg,.uti",
+        config);
     ImVec2 main_size = ImGui::GetMainViewport()->WorkSize;
     ImVec2 dlg_size(main_size.x / 2, main_size.y / 2);
     if (ImGuiFileDialog::Instance()->Display(
@@ -124,8 +182,13 @@ void ImageWarping::draw_open_image_file_dialog()
         {
             std::string filePathName =
                 ImGuiFileDialog::Instance()->GetFilePathName();
-            std::string label = filePathName;
-            p_image_ = std::make_shared<WarpingWidget>(label, filePathName);
+            // Tiled images are mapped, not decoded: only the view is read.
+            // Others are decoded in the background, see draw_io_status().
+            if (is_tiled_image(filePathName))
+                p_image_ = std::make_shared<WarpingWidget>(
+                    filePathName, filePathName);
+            else
+                load_ = AsyncImageIO::instance().load(filePathName);
         }
         ImGuiFileDialog::Instance()->Close();
         flag_open_file_dialog_ = false;
@@ -147,12 +210,84 @@ void ImageWarping::draw_save_image_file_dialog()
         {
             std::string filePathName =
                 ImGuiFileDialog::Instance()->GetFilePathName();
-            std::string label = filePathName;
             if (p_image_)
-                p_image_->save_to_disk(filePathName);
+                save_ = p_image_->save_to_disk(filePathName);
         }
         ImGuiFileDialog::Instance()->Close();
         flag_save_file_dialog_ = false;
     }
 }
+void ImageWarping::draw_convert_image_file_dialog()
+{
+    IGFD::FileDialogConfig config;
+    config.path = DATA_PATH;
+    config.flags = ImGuiFileDialogFlags_Modal;
+    ImGuiFileDialog::Instance()->OpenDialog(
+        "ChooseImageConvertFileDlg",
+        "Convert Image to Tiled (.uti next to it)",
+        ".png,.jpg",
+        config);
+    ImVec2 main_size = ImGui::GetMainViewport()->WorkSize;
+    ImVec2 dlg_size(main_size.x / 2, main_size.y / 2);
+    if (ImGuiFileDialog::Instance()->Display(
+            "ChooseImageConvertFileDlg",
+            ImGuiWindowFlags_NoCollapse,
+            dlg_size))
+    {
+        if (ImGuiFileDialog::Instance()->IsOk())
+        {
+            std::string filePathName =
+                ImGuiFileDialog::Instance()->GetFilePathName();
+            convert_ = AsyncImageIO::instance().convert_to_tiled(
+                filePathName,
+                std::filesystem::path(filePathName)
+                    .replace_extension(".uti")
+                    .string());
+        }
+        ImGuiFileDialog::Instance()->Close();
+        flag_convert_file_dialog_ = false;
+    }
+}
+void ImageWarping::draw_io_status()
+{
+    // A decoded image becomes the widget on the frame after it is ready
+    if (load_.ready())
+    {
+        const std::string filename = load_.filename();
+        if (std::shared_ptr<Image> image = take_result(load_))
+            p_image_ =
+                std::make_shared<WarpingWidget>(filename, filename, image);
+        else
+            std::cout << "Failed to load image from file " << filename
+                      << std::endl;
+    }
+    if (save_.ready() && !take_result(save_))
+        std::cout << "Failed to save image to file " << save_.filename()
+                  << std::endl;
+    // A converted image is opened
+    if (convert_.ready())
+    {
+        const std::string filename = convert_.filename();
+        if (take_result(convert_))
+            p_image_ = std::make_shared<WarpingWidget>(filename, filename);
+        else
+            std::cout << "Failed to convert image to file " << filename
+                      << std::endl;
+    }
+
+    if (!load_.valid() && !save_.valid() && !convert_.valid())
+        return;
+    ImGui::Begin(
+        "Files",
+        nullptr,
+        ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoCollapse);
+    if (load_.valid())
+        draw_progress("Loading", load_.filename(), load_.progress());
+    if (save_.valid())
+        draw_progress("Saving", save_.filename(), save_.progress());
+    if (convert_.valid())
+        draw_progress(
+            "Converting to", convert_.filename(), convert_.progress());
+    ImGui::End();
+}
 }  // namespace USTC_CG
\ No newline at end of file
@@ -20,11 +20,19 @@ class ImageWarping : public Window
     void draw_image();
     void draw_open_image_file_dialog();
     void draw_save_image_file_dialog();
+    // Pick an image to convert to a tiled image, which is then opened
+    void draw_convert_image_file_dialog();
+    // Pick up the finished loads and saves, show the progress of the others
+    void draw_io_status();
 
     std::shared_ptr<WarpingWidget> p_image_ = nullptr;
+    // Files being loaded or saved in the background
+    IoTask<std::shared_ptr<Image>> load_;
+    IoTask<bool> save_, convert_;
 
     bool flag_show_main_view_ = true;
     bool flag_open_file_dialog_ = false;
     bool flag_save_file_dialog_ = false;
+    bool flag_convert_file_dialog_ = false;
 };
 }  // namespace USTC_CG
\ No newline at end of file
@@ -0,0 +1,316 @@
+#include "poisson/multigrid_solver.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace USTC_CG
+{
+namespace
+{
+// Coarsening stops at this many cells inside, solved directly; a larger
+// coarsest level is smoothed instead
+constexpr int kCoarsestCells = 64;
+constexpr int kCoarsestSweeps = 32;
+constexpr int kSmoothing = 2;
+// Constant prolongation underestimates smooth corrections by about half;
+// scaling them back is the classic fix for aggregation multigrid.
+constexpr float kOverCorrection = 1.8f;
+
+double dot(const std::vector<float>& a, const std::vector<float>& b)
+{
+    const long long size = static_cast<long long>(a.size());
+    double sum = 0;
+#pragma omp parallel for schedule(static) reduction(+ : sum)
+    for (long long i = 0; i < size; ++i)
+        sum += static_cast<double>(a[i]) * b[i];
+    return sum;
+}
+
+// Coordinate of the parent of a fine cell along an axis; with the extra
+// coarse column and row, the coarse border stays outside.
+int parent(int x, bool halve)
+{
+    return halve ? (x + 1) / 2 : x;
+}
+}  // namespace
+
+void MultigridSolver::set_domain(
+    int width,
+    int height,
+    const std::vector<unsigned char>& mask)
+{
+    levels_.clear();
+    Level finest;
+    finest.width = width;
+    finest.height = height;
+    finest.mask = mask;
+    const std::size_t finest_size = mask.size();
+    finest.diagonal.assign(finest_size, 0.0f);
+    finest.east.assign(finest_size, 0.0f);
+    finest.south.assign(finest_size, 0.0f);
+    for (std::size_t i = 0; i < finest_size; ++i)
+    {
+        if (!mask[i])
+            continue;
+        finest.diagonal[i] = 4;
+        finest.east[i] = mask[i + 1] ? 1.0f : 0.0f;
+        finest.south[i] = mask[i + width] ? 1.0f : 0.0f;
+    }
+    levels_.push_back(std::move(finest));
+
+    auto count_inside = [](const Level& level)
+    {
+        return static_cast<int>(std::count_if(
+            level.mask.begin(),
+            level.mask.end(),
+            [](unsigned char m) { return m != 0; }));
+    };
+    // An axis down to one cell inside the border is no longer halved, so a
+    // strip one cell thick still coarsens along its length.
+    while (count_inside(levels_.back()) > kCoarsestCells)
+    {
+        Level& fine = levels_.back();
+        fine.halve_x = fine.width > 3;
+        fine.halve_y = fine.height > 3;
+        if (!fine.halve_x && !fine.halve_y)
+            break;
+        Level coarse;
+        coarse.width = fine.halve_x ? fine.width / 2 + 2 : fine.width;
+        coarse.height = fine.halve_y ? fine.height / 2 + 2 : fine.height;
+        const std::size_t size =
+            static_cast<std::size_t>(coarse.width) * coarse.height;
+        coarse.mask.assign(size, 0);
+        coarse.diagonal.assign(size, 0.0f);
+        coarse.east.assign(size, 0.0f);
+        coarse.south.assign(size, 0.0f);
+        for (int y = 1; y < fine.height - 1; ++y)
+        {
+            for (int x = 1; x < fine.width - 1; ++x)
+            {
+                const std::size_t i =
+                    static_cast<std::size_t>(y) * fine.width + x;
+                if (!fine.mask[i])
+                    continue;
+                const int px = parent(x, fine.halve_x);
+                const int py = parent(y, fine.halve_y);
+                const std::size_t j =
+                    static_cast<std::size_t>(py) * coarse.width + px;
+                coarse.mask[j] = 1;
+                coarse.diagonal[j] += fine.diagonal[i];
+                // A link between two children is counted from both ends of
+                // P^T A P; a link to another parent becomes a coarse link.
+                if (parent(x + 1, fine.halve_x) == px)
+                    coarse.diagonal[j] -= 2 * fine.east[i];
+                else
+                    coarse.east[j] += fine.east[i];
+                if (parent(y + 1, fine.halve_y) == py)
+                    coarse.diagonal[j] -= 2 * fine.south[i];
+                else
+                    coarse.south[j] += fine.south[i];
+            }
+        }
+        levels_.push_back(std::move(coarse));
+    }
+
+    for (Level& level : levels_)
+    {
+        const std::size_t size =
+            static_cast<std::size_t>(level.width) * level.height;
+        level.u.assign(size, 0.0f);
+        level.b.assign(size, 0.0f);
+        level.r.assign(size, 0.0f);
+    }
+    residual_.assign(finest_size, 0.0f);
+    direction_.assign(finest_size, 0.0f);
+    product_.assign(finest_size, 0.0f);
+
+    // Dense system of the coarsest level
+    const Level& last = levels_.back();
+    coarsest_cells_.clear();
+    if (count_inside(last) > kCoarsestCells)
+        return;
+    std::vector<int> index(last.mask.size(), -1);
+    for (std::size_t i = 0; i < last.mask.size(); ++i)
+    {
+        if (last.mask[i])
+        {
+            index[i] = static_cast<int>(coarsest_cells_.size());
+            coarsest_cells_.push_back(static_cast<int>(i));
+        }
+    }
+    const int n = static_cast<int>(coarsest_cells_.size());
+    Eigen::MatrixXd matrix = Eigen::MatrixXd::Zero(n, n);
+    for (int k = 0; k < n; ++k)
+    {
+        const int cell = coarsest_cells_[k];
+        matrix(k, k) = last.diagonal[cell];
+        const int east = index[cell + 1];
+        const int south = index[cell + last.width];
+        if (east >= 0)
+            matrix(k, east) = matrix(east, k) = -last.east[cell];
+        if (south >= 0)
+            matrix(k, south) = matrix(south, k) = -last.south[cell];
+    }
+    coarsest_.compute(matrix);
+}
+
+void MultigridSolver::apply(
+    const Level& level,
+    const std::vector<float>& in,
+    std::vector<float>& out) const
+{
+    const int width = level.width, height = level.height;
+    const float* v = in.data();
+#pragma omp parallel for schedule(static)
+    for (int y = 1; y < height - 1; ++y)
+    {
+        const std::size_t row = static_cast<std::size_t>(y) * width;
+        for (int x = 1; x < width - 1; ++x)
+        {
+            const std::size_t i = row + x;
+            out[i] = level.mask[i]
+                         ? level.diagonal[i] * v[i] -
+                               level.east[i] * v[i + 1] -
+                               level.east[i - 1] * v[i - 1] -
+                               level.south[i] * v[i + width] -
+                               level.south[i - width] * v[i - width]
+                         : 0.0f;
+        }
+    }
+}
+
+void MultigridSolver::smooth(Level& level, int sweeps, bool reverse) const
+{
+    const int width = level.width, height = level.height;
+    const unsigned char* mask = level.mask.data();
+    const float* diagonal = level.diagonal.data();
+    const float* east = level.east.data();
+    const float* south = level.south.data();
+    const float* b = level.b.data();
+    float* u = level.u.data();
+    for (int sweep = 0; sweep < 2 * sweeps; ++sweep)
+    {
+        // Cells of one colour only depend on cells of the other one, so
+        // the rows of a colour can be updated in parallel.
+        const int color = (sweep & 1) ^ (reverse ? 1 : 0);
+#pragma omp parallel for schedule(static)
+        for (int y = 1; y < height - 1; ++y)
+        {
+            const std::size_t row = static_cast<std::size_t>(y) * width;
+            for (int x = 1 + ((y + color + 1) & 1); x < width - 1; x += 2)
+            {
+                const std::size_t i = row + x;
+                if (mask[i])
+                    u[i] = (b[i] + east[i] * u[i + 1] +
+                            east[i - 1] * u[i - 1] +
+                            south[i] * u[i + width] +
+                            south[i - width] * u[i - width]) /
+                           diagonal[i];
+            }
+        }
+    }
+}
+
+void MultigridSolver::solve_coarsest()
+{
+    Level& level = levels_.back();
+    if (coarsest_cells_.empty())
+    {
+        // Symmetric sweeps from u = 0 keep the V-cycle symmetric
+        std::fill(level.u.begin(), level.u.end(), 0.0f);
+        smooth(level, kCoarsestSweeps, false);
+        smooth(level, kCoarsestSweeps, true);
+        return;
+    }
+    Eigen::VectorXd rhs(coarsest_cells_.size());
+    for (std::size_t k = 0; k < coarsest_cells_.size(); ++k)
+        rhs(k) = level.b[coarsest_cells_[k]];
+    const Eigen::VectorXd solution = coarsest_.solve(rhs);
+    for (std::size_t k = 0; k < coarsest_cells_.size(); ++k)
+        level.u[coarsest_cells_[k]] = static_cast<float>(solution(k));
+}
+
+void MultigridSolver::v_cycle(std::size_t index)
+{
+    if (index + 1 == levels_.size())
+        return solve_coarsest();
+    Level& fine = levels_[index];
+    Level& coarse = levels_[index + 1];
+    std::fill(fine.u.begin(), fine.u.end(), 0.0f);
+    smooth(fine, kSmoothing, false);
+    apply(fine, fine.u, fine.r);
+    for (std::size_t i = 0; i < fine.r.size(); ++i)
+        fine.r[i] = fine.b[i] - fine.r[i];
+
+    // Restriction P^T: sum of the residuals of the children
+    std::fill(coarse.b.begin(), coarse.b.end(), 0.0f);
+    for (int y = 1; y < fine.height - 1; ++y)
+    {
+        const std::size_t row = static_cast<std::size_t>(y) * fine.width;
+        const std::size_t coarse_row =
+            static_cast<std::size_t>(parent(y, fine.halve_y)) * coarse.width;
+        for (int x = 1; x < fine.width - 1; ++x)
+            coarse.b[coarse_row + parent(x, fine.halve_x)] += fine.r[row + x];
+    }
+    v_cycle(index + 1);
+
+    // Prolongation P: the (scaled) correction is constant over the children
+#pragma omp parallel for schedule(static)
+    for (int y = 1; y < fine.height - 1; ++y)
+    {
+        const std::size_t row = static_cast<std::size_t>(y) * fine.width;
+        const float* coarse_row =
+            coarse.u.data() +
+            static_cast<std::size_t>(parent(y, fine.halve_y)) * coarse.width;
+        for (int x = 1; x < fine.width - 1; ++x)
+            if (fine.mask[row + x])
+                fine.u[row + x] +=
+                    kOverCorrection * coarse_row[parent(x, fine.halve_x)];
+    }
+    smooth(fine, kSmoothing, true);
+}
+
+int MultigridSolver::solve(
+    const std::vector<float>& b,
+    std::vector<float>& u,
+    float tolerance,
+    int max_iterations)
+{
+    if (levels_.empty())
+        return 0;
+    Level& finest = levels_.front();
+    const double threshold2 =
+        static_cast<double>(tolerance) * tolerance * dot(b, b);
+
+    // Conjugate gradients preconditioned by one V-cycle, which is symmetric
+    // (Galerkin operators, adjoint pre- and post-smoothing); the Krylov
+    // acceleration makes up for the slow decay of aggregation V-cycles.
+    apply(finest, u, residual_);
+    for (std::size_t i = 0; i < residual_.size(); ++i)
+        residual_[i] = b[i] - residual_[i];
+    double rho = 0;
+    int iterations = 0;
+    while (iterations < max_iterations &&
+           dot(residual_, residual_) > threshold2)
+    {
+        finest.b = residual_;
+        v_cycle(0);
+        const double previous = rho;
+        rho = dot(residual_, finest.u);
+        const double beta = iterations > 0 ? rho / previous : 0.0;
+        for (std::size_t i = 0; i < direction_.size(); ++i)
+            direction_[i] =
+                finest.u[i] + static_cast<float>(beta) * direction_[i];
+        apply(finest, direction_, product_);
+        const float alpha =
+            static_cast<float>(rho / dot(direction_, product_));
+        for (std::size_t i = 0; i < u.size(); ++i)
+        {
+            u[i] += alpha * direction_[i];
+            residual_[i] -= alpha * product_[i];
+        }
+        ++iterations;
+    }
+    return iterations;
+}
+}  // namespace USTC_CG
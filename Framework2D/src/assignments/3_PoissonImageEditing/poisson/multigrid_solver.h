@@ -0,0 +1,76 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <vector>
+
+namespace USTC_CG
+{
+// Multigrid solver for the masked 5-point Laplacian
+//   4 u_p - sum_{q in N_p, inside} u_q = b_p,
+// on the cells of a grid flagged by a mask (u = 0 outside, i.e. the
+// Dirichlet values are already folded into b).
+//
+// Each coarse cell merges 2 x 2 fine cells (2 x 1 or 1 x 2 once the other
+// axis is down to a single cell, so thin strips keep coarsening) and is
+// inside when any of them is. The coarse operators are the Galerkin
+// products R A P with constant prolongation P and R = P^T, which keeps a
+// 5-point stencil (with a weight per link) and follows the exact shape of
+// the region at every level. A V-cycle smoothed by red-black Gauss-Seidel
+// (rows in parallel with OpenMP) preconditions conjugate gradients on the
+// finest level; the coarsest level (at most a few dozen cells) is solved
+// directly, and is only smoothed if it is ever larger. Time and memory are
+// O(N) in the number of cells.
+class MultigridSolver
+{
+   public:
+    // Build the hierarchy for a width x height grid; mask[y * width + x] is
+    // nonzero inside. The border rows and columns of the grid must be
+    // outside.
+    void set_domain(
+        int width,
+        int height,
+        const std::vector<unsigned char>& mask);
+
+    // Solve for u (width * height values, zero outside; its content is the
+    // initial guess, e.g. the previous solution) until the residual norm is
+    // below tolerance * |b|, or max_iterations. Returns the number of
+    // iterations run, one V-cycle each.
+    int solve(
+        const std::vector<float>& b,
+        std::vector<float>& u,
+        float tolerance = 1e-5f,
+        int max_iterations = 30);
+
+   private:
+    struct Level
+    {
+        int width = 0, height = 0;
+        // Whether the next level halves this one along x and along y
+        bool halve_x = true, halve_y = true;
+        std::vector<unsigned char> mask;
+        // Stencil: diagonal, and weights of the links to x + 1 and y + 1
+        std::vector<float> diagonal, east, south;
+        std::vector<float> u, b, r;
+    };
+
+    // out = A in, on the cells of the level
+    void apply(
+        const Level& level,
+        const std::vector<float>& in,
+        std::vector<float>& out) const;
+    // Red-black sweeps; `reverse` swaps the colour order, so that the
+    // post-smoothing is the adjoint of the pre-smoothing.
+    void smooth(Level& level, int sweeps, bool reverse) const;
+    // u of the level approximates A^-1 b, from u = 0
+    void v_cycle(std::size_t index);
+    void solve_coarsest();
+
+    std::vector<Level> levels_;
+    // Conjugate gradients on the finest level
+    std::vector<float> residual_, direction_, product_;
+    // Dense factorization of the coarsest level, and its cells (empty when
+    // the level is too large to factor)
+    Eigen::LDLT<Eigen::MatrixXd> coarsest_;
+    std::vector<int> coarsest_cells_;
+};
+}  // namespace USTC_CG
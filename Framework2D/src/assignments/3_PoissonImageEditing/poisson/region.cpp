@@ -0,0 +1,111 @@
+#include "poisson/region.h"
+
+#include <algorithm>
+
+#include "common/tile_scheduler.h"
+
+namespace USTC_CG
+{
+Region::Region(std::vector<Span> spans, int width, int height)
+{
+    for (Span& span : spans)
+    {
+        span.x0 = std::max(span.x0, 0);
+        span.x1 = std::min(span.x1, width);
+    }
+    std::erase_if(
+        spans,
+        [&](const Span& span)
+        { return span.y < 0 || span.y >= height || span.x0 >= span.x1; });
+    std::sort(
+        spans.begin(),
+        spans.end(),
+        [](const Span& a, const Span& b)
+        { return a.y != b.y ? a.y < b.y : a.x0 < b.x0; });
+    for (const Span& span : spans)
+    {
+        if (!spans_.empty() && spans_.back().y == span.y &&
+            span.x0 <= spans_.back().x1)
+            spans_.back().x1 = std::max(spans_.back().x1, span.x1);
+        else
+            spans_.push_back(span);
+    }
+    if (spans_.empty())
+        return;
+
+    bounds_ = { spans_.front().x0, spans_.front().y, 0, spans_.back().y + 1 };
+    offsets_.reserve(spans_.size() + 1);
+    rows_.assign(static_cast<std::size_t>(bounds_.y1 - bounds_.y0) + 1, 0);
+    for (std::size_t s = 0; s < spans_.size(); ++s)
+    {
+        bounds_.x0 = std::min(bounds_.x0, spans_[s].x0);
+        bounds_.x1 = std::max(bounds_.x1, spans_[s].x1);
+        offsets_.push_back(offsets_.back() + spans_[s].x1 - spans_[s].x0);
+        ++rows_[spans_[s].y - bounds_.y0 + 1];
+    }
+    for (std::size_t r = 1; r < rows_.size(); ++r)
+        rows_[r] += rows_[r - 1];
+}
+
+bool Region::empty() const
+{
+    return spans_.empty();
+}
+
+int Region::size() const
+{
+    return offsets_.back();
+}
+
+const Region::Box& Region::bounds() const
+{
+    return bounds_;
+}
+
+const std::vector<Region::Span>& Region::spans() const
+{
+    return spans_;
+}
+
+int Region::first_index(std::size_t s) const
+{
+    return offsets_[s];
+}
+
+int Region::index(int x, int y) const
+{
+    if (y < bounds_.y0 || y >= bounds_.y1)
+        return -1;
+    const auto begin = spans_.begin() + rows_[y - bounds_.y0];
+    const auto end = spans_.begin() + rows_[y - bounds_.y0 + 1];
+    // Last span of the row starting at or before x
+    const auto it = std::upper_bound(
+        begin, end, x, [](int x, const Span& span) { return x < span.x0; });
+    if (it == begin || x >= std::prev(it)->x1)
+        return -1;
+    const std::size_t s = static_cast<std::size_t>(it - spans_.begin()) - 1;
+    return offsets_[s] + x - spans_[s].x0;
+}
+
+std::pair<int, int> Region::pixel(int k) const
+{
+    const std::size_t s = static_cast<std::size_t>(
+        std::upper_bound(offsets_.begin(), offsets_.end(), k) -
+        offsets_.begin() - 1);
+    return { spans_[s].x0 + k - offsets_[s], spans_[s].y };
+}
+
+void Region::fill(Image& mask, unsigned char value) const
+{
+    // Spans are disjoint, so they can be written in parallel
+    TileScheduler::instance().parallel_for(
+        spans_.size(),
+        [&](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t s = begin; s < end; ++s)
+                for (int x = spans_[s].x0; x < spans_[s].x1; ++x)
+                    mask.at_unchecked(x, spans_[s].y, 0) = value;
+        },
+        64);
+}
+}  // namespace USTC_CG
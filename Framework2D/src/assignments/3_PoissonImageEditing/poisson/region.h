@@ -0,0 +1,63 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include "common/image.h"
+
+namespace USTC_CG
+{
+// A set of pixels stored as runs on rows, so that everything derived from a
+// selection costs O(pixels of the region) instead of O(pixels of the image).
+//
+// The pixels are numbered row by row, left to right: this dense index is the
+// unknown of a pixel in the Poisson system. index() maps a pixel to its
+// index with a binary search among the runs of its row, pixel() maps back
+// with a binary search among the runs.
+class Region
+{
+   public:
+    // Pixels [x0, x1) of row y
+    struct Span
+    {
+        int y = 0;
+        int x0 = 0, x1 = 0;
+    };
+    // Bounding box [x0, x1) x [y0, y1)
+    struct Box
+    {
+        int x0 = 0, y0 = 0;
+        int x1 = 0, y1 = 0;
+    };
+
+    Region() = default;
+    // Spans in any order, possibly overlapping or touching. They are
+    // clipped to [0, width) x [0, height), sorted and merged.
+    Region(std::vector<Span> spans, int width, int height);
+
+    bool empty() const;
+    // Number of pixels
+    int size() const;
+    const Box& bounds() const;
+    // Disjoint and non-adjacent, sorted by row then column
+    const std::vector<Span>& spans() const;
+    // Index of the first pixel of spans()[s]
+    int first_index(std::size_t s) const;
+
+    // Index of the pixel (x, y), or -1 if it is outside.
+    int index(int x, int y) const;
+    // Pixel of the index k, in [0, size())
+    std::pair<int, int> pixel(int k) const;
+
+    // Set channel 0 of the pixels of the region to `value` in `mask`
+    void fill(Image& mask, unsigned char value) const;
+
+   private:
+    std::vector<Span> spans_;
+    // First index of each span, then size()
+    std::vector<int> offsets_ = { 0 };
+    // First span of each row of the bounding box, then spans_.size()
+    std::vector<int> rows_;
+    Box bounds_;
+};
+}  // namespace USTC_CG
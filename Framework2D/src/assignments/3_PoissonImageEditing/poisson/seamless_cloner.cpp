@@ -0,0 +1,347 @@
+#include "poisson/seamless_cloner.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "common/tile_scheduler.h"
+
+namespace USTC_CG
+{
+namespace
+{
+constexpr int kNeighborX[4] = { -1, 1, 0, 0 };
+constexpr int kNeighborY[4] = { 0, 0, -1, 1 };
+// Illumination change (Perez et al. 2003): a = kAlphaRatio * mean norm
+constexpr double kAlphaRatio = 0.2;
+constexpr double kBeta = 0.2;
+}  // namespace
+
+void SeamlessCloner::set_solver(Solver solver)
+{
+    solver_type_ = solver;
+}
+
+SeamlessCloner::Solver SeamlessCloner::solver() const
+{
+    return solver_type_;
+}
+
+void SeamlessCloner::set_guidance(Guidance guidance)
+{
+    if (guidance == guidance_type_)
+        return;
+    guidance_type_ = guidance;
+    if (channels_ > 0)
+        build_guidance();
+}
+
+SeamlessCloner::Guidance SeamlessCloner::guidance() const
+{
+    return guidance_type_;
+}
+
+void SeamlessCloner::set_edge_threshold(float threshold)
+{
+    edge_threshold_ = threshold;
+    if (channels_ > 0 && guidance_type_ == kFlatten)
+        build_guidance();
+}
+
+template<typename Fn>
+void SeamlessCloner::for_each_unknown(Fn fn) const
+{
+    const std::vector<Region::Span>& spans = region_.spans();
+    for (std::size_t s = 0; s < spans.size(); ++s)
+    {
+        int k = region_.first_index(s);
+        for (int x = spans[s].x0; x < spans[s].x1; ++x, ++k)
+            fn(k, x, spans[s].y);
+    }
+}
+
+template<typename Fn>
+void SeamlessCloner::for_each_grid_cell(Fn fn) const
+{
+    for_each_unknown(
+        [&](int k, int x, int y)
+        {
+            fn(k,
+               static_cast<std::size_t>(y - grid_y_) * grid_width_ +
+                   (x - grid_x_));
+        });
+}
+
+bool SeamlessCloner::set_region(const Region& region)
+{
+    region_ = region;
+    boundary_.clear();
+    prepared_ = false;
+    channels_ = 0;
+    for (auto& solution : warm_start_)
+        solution.clear();
+    const int n = region_.size();
+    if (n == 0)
+        return false;
+
+    // The horizontal neighbours of a pixel are the next unknowns of its
+    // span, or outside at the ends of the span (spans never touch); the
+    // vertical ones are looked up in the spans of the adjacent rows.
+    const bool direct = solver_type_ == kDirect;
+    std::vector<Eigen::Triplet<double>> entries;
+    if (direct)
+        entries.reserve(static_cast<std::size_t>(n) * 5);
+    const std::vector<Region::Span>& spans = region_.spans();
+    for (std::size_t s = 0; s < spans.size(); ++s)
+    {
+        const Region::Span& span = spans[s];
+        for (int x = span.x0, k = region_.first_index(s); x < span.x1;
+             ++x, ++k)
+        {
+            if (direct)
+                entries.emplace_back(k, k, 4.0);
+            const int neighbors[4] = {
+                x > span.x0 ? k - 1 : -1,
+                x + 1 < span.x1 ? k + 1 : -1,
+                region_.index(x, span.y - 1),
+                region_.index(x, span.y + 1),
+            };
+            for (int i = 0; i < 4; ++i)
+            {
+                if (neighbors[i] < 0)
+                    boundary_.push_back(
+                        { k, x + kNeighborX[i], span.y + kNeighborY[i] });
+                else if (direct)
+                    entries.emplace_back(k, neighbors[i], -1.0);
+            }
+        }
+    }
+    if (!direct)
+    {
+        const Region::Box& box = region_.bounds();
+        grid_x_ = box.x0 - 1;
+        grid_y_ = box.y0 - 1;
+        grid_width_ = box.x1 - box.x0 + 2;
+        grid_height_ = box.y1 - box.y0 + 2;
+        std::vector<unsigned char> cells(
+            static_cast<std::size_t>(grid_width_) * grid_height_, 0);
+        for_each_grid_cell([&](int, std::size_t cell) { cells[cell] = 1; });
+        multigrid_.set_domain(grid_width_, grid_height_, cells);
+        grid_rhs_.assign(cells.size(), 0.0f);
+        prepared_ = true;
+        return true;
+    }
+    Eigen::SparseMatrix<double> laplacian(n, n);
+    laplacian.setFromTriplets(entries.begin(), entries.end());
+    factorization_.compute(laplacian);
+    prepared_ = factorization_.info() == Eigen::Success;
+    return prepared_;
+}
+
+void SeamlessCloner::set_source(const Image& source)
+{
+    channels_ = std::min(source.channels(), 3);
+    const Region::Box& box = region_.bounds();
+    source_width_ = box.x1 - box.x0 + 2;
+    const int source_height = box.y1 - box.y0 + 2;
+    source_.resize(static_cast<std::size_t>(source_width_) * source_height * 3);
+    for (int y = 0; y < source_height; ++y)
+    {
+        // Gradients across the source border are zero
+        const int sy = std::clamp(box.y0 - 1 + y, 0, source.height() - 1);
+        for (int x = 0; x < source_width_; ++x)
+        {
+            const int sx = std::clamp(box.x0 - 1 + x, 0, source.width() - 1);
+            float* value =
+                &source_[(static_cast<std::size_t>(y) * source_width_ + x) * 3];
+            for (int c = 0; c < channels_; ++c)
+                value[c] = source.at_unchecked(sx, sy, c);
+        }
+    }
+    build_guidance();
+}
+
+float SeamlessCloner::source_value(int x, int y, int c) const
+{
+    const Region::Box& box = region_.bounds();
+    return source_
+        [(static_cast<std::size_t>(y - box.y0 + 1) * source_width_ + x -
+          box.x0 + 1) *
+             3 +
+         c];
+}
+
+void SeamlessCloner::build_guidance()
+{
+    guidance_ = Eigen::MatrixX3d::Zero(region_.size(), 3);
+    const bool log_domain = guidance_type_ == kIllumination;
+    auto f = [&](int x, int y, int c)
+    {
+        const double value = source_value(x, y, c);
+        return log_domain ? std::log1p(value) : value;
+    };
+    auto gradient_norm = [&](int x, int y, int c)
+    {
+        return 0.5 * std::hypot(
+                         f(x + 1, y, c) - f(x - 1, y, c),
+                         f(x, y + 1, c) - f(x, y - 1, c));
+    };
+    double alpha[3] = {};
+    if (log_domain)
+    {
+        for_each_unknown(
+            [&](int, int x, int y)
+            {
+                for (int c = 0; c < channels_; ++c)
+                    alpha[c] += gradient_norm(x, y, c);
+            });
+        for (int c = 0; c < channels_; ++c)
+            alpha[c] *= kAlphaRatio / region_.size();
+    }
+
+    for_each_unknown(
+        [&](int k, int x, int y)
+        {
+            for (int i = 0; i < 4; ++i)
+            {
+                const int qx = x + kNeighborX[i], qy = y + kNeighborY[i];
+                if (guidance_type_ == kFlatten)
+                {
+                    float difference = 0;
+                    for (int c = 0; c < channels_; ++c)
+                        difference = std::max(
+                            difference,
+                            std::abs(
+                                source_value(x, y, c) -
+                                source_value(qx, qy, c)));
+                    if (difference <= edge_threshold_)
+                        continue;
+                }
+                for (int c = 0; c < channels_; ++c)
+                    guidance_(k, c) += f(x, y, c) - f(qx, qy, c);
+            }
+            if (log_domain)
+            {
+                for (int c = 0; c < channels_; ++c)
+                    guidance_(k, c) *=
+                        std::pow(alpha[c], kBeta) *
+                        std::pow(
+                            std::max(gradient_norm(x, y, c), 1e-6), -kBeta);
+            }
+        });
+}
+
+Eigen::MatrixX3d SeamlessCloner::mixed_guidance(
+    const Image& target,
+    int offset_x,
+    int offset_y,
+    int channels) const
+{
+    Eigen::MatrixX3d guidance = Eigen::MatrixX3d::Zero(region_.size(), 3);
+    auto t = [&](int x, int y, int c)
+    {
+        x = std::clamp(x + offset_x, 0, target.width() - 1);
+        y = std::clamp(y + offset_y, 0, target.height() - 1);
+        return static_cast<double>(target.at_unchecked(x, y, c));
+    };
+    for_each_unknown(
+        [&](int k, int x, int y)
+        {
+            for (int c = 0; c < channels; ++c)
+            {
+                const double source_center = source_value(x, y, c);
+                const double target_center = t(x, y, c);
+                double sum = 0;
+                for (int i = 0; i < 4; ++i)
+                {
+                    const int qx = x + kNeighborX[i], qy = y + kNeighborY[i];
+                    const double ds = source_center - source_value(qx, qy, c);
+                    const double dt = target_center - t(qx, qy, c);
+                    sum += std::abs(ds) > std::abs(dt) ? ds : dt;
+                }
+                guidance(k, c) = sum;
+            }
+        });
+    return guidance;
+}
+
+bool SeamlessCloner::ready() const
+{
+    return prepared_ && channels_ > 0;
+}
+
+void SeamlessCloner::clone(Image& target, int offset_x, int offset_y)
+{
+    if (!ready() || target.width() == 0 || target.height() == 0)
+        return;
+    const int channels = std::min(channels_, target.channels());
+    const int width = target.width(), height = target.height();
+
+    // Boundary values, read before any region pixel of the target is written
+    const bool log_domain = guidance_type_ == kIllumination;
+    Eigen::MatrixX3d rhs =
+        guidance_type_ == kMixed
+            ? mixed_guidance(target, offset_x, offset_y, channels)
+            : guidance_;
+    for (const BoundaryLink& link : boundary_)
+    {
+        const int x = std::clamp(link.x + offset_x, 0, width - 1);
+        const int y = std::clamp(link.y + offset_y, 0, height - 1);
+        for (int c = 0; c < channels; ++c)
+        {
+            const double value = target.at_unchecked(x, y, c);
+            rhs(link.row, c) += log_domain ? std::log1p(value) : value;
+        }
+    }
+    Eigen::MatrixX3d solution(rhs.rows(), 3);
+    if (solver_type_ == kDirect)
+    {
+        solution = factorization_.solve(rhs);
+    }
+    else
+    {
+        for (int c = 0; c < channels; ++c)
+        {
+            std::vector<float>& u = warm_start_[c];
+            u.resize(grid_rhs_.size(), 0.0f);
+            for_each_grid_cell(
+                [&](int k, std::size_t cell)
+                { grid_rhs_[cell] = static_cast<float>(rhs(k, c)); });
+            multigrid_.solve(grid_rhs_, u);
+            for_each_grid_cell(
+                [&](int k, std::size_t cell) { solution(k, c) = u[cell]; });
+        }
+    }
+
+    // Spans are disjoint, so they can be written in parallel
+    const std::vector<Region::Span>& spans = region_.spans();
+    TileScheduler::instance().parallel_for(
+        spans.size(),
+        [&](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t s = begin; s < end; ++s)
+            {
+                const int y = spans[s].y + offset_y;
+                if (y < 0 || y >= height)
+                    continue;
+                int k = region_.first_index(s);
+                for (int x = spans[s].x0 + offset_x;
+                     x < spans[s].x1 + offset_x;
+                     ++x, ++k)
+                {
+                    if (x < 0 || x >= width)
+                        continue;
+                    for (int c = 0; c < channels; ++c)
+                    {
+                        const double value =
+                            log_domain ? std::expm1(solution(k, c))
+                                       : solution(k, c);
+                        target.at_unchecked(x, y, c) =
+                            static_cast<unsigned char>(
+                                std::lround(std::clamp(value, 0.0, 255.0)));
+                    }
+                }
+            }
+        },
+        16);
+}
+}  // namespace USTC_CG
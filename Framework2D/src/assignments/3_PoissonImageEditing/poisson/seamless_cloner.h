@@ -0,0 +1,137 @@
+// Poisson image blending (seamless cloning, Perez et al. 2003), free of any
+// GUI/OpenGL dependency.
+#pragma once
+
+#include <Eigen/Sparse>
+#include <Eigen/SparseCholesky>
+#include <vector>
+
+#include "common/image.h"
+#include "poisson/multigrid_solver.h"
+#include "poisson/region.h"
+
+namespace USTC_CG
+{
+// Solves, over the pixels p of a region (the unknowns f_p),
+//   |N_p| f_p - sum_{q in N_p, inside} f_q
+//       = sum_{q in N_p, outside} t_q + sum_{q in N_p} (s_p - s_q),
+// with N_p the 4 neighbours of p, t the target and s the source image.
+//
+// The matrix only depends on the shape of the region, so it is assembled and
+// factored (sparse LDLT) once in set_region(). The guidance term only
+// depends on the source and is computed once in set_source(). Moving the
+// region over the target (e.g. while dragging) then costs a right-hand side
+// update on the boundary and one back substitution for the three colour
+// channels together.
+//
+// The guidance term sum_q (s_p - s_q) can be replaced by other guidance
+// fields v_pq (see Guidance). They only change the right-hand side, so all
+// of them share the factorization of the region.
+//
+// Direct factorization needs memory superlinear in the region size; for
+// regions around a megapixel and above, the multigrid backend solves in
+// O(N) time and memory instead, warm-started from the previous solution so
+// that dragging needs few V-cycles per frame.
+class SeamlessCloner
+{
+   public:
+    enum Solver
+    {
+        kDirect = 0,
+        kMultigrid = 1
+    };
+
+    // Guidance field v_pq, for a pixel p of the region and a neighbour q
+    enum Guidance
+    {
+        // s_p - s_q: seamless cloning
+        kImport = 0,
+        // The stronger of s_p - s_q and t_p - t_q (per channel), which
+        // keeps the target texture through holes of the source
+        kMixed = 1,
+        // s_p - s_q across the edges of the source only, 0 elsewhere
+        kFlatten = 2,
+        // Gradients of log(s) scaled by a^b |grad log s|^-b (b = 0.2, a a
+        // fifth of their mean norm), solved in the log domain: evens out
+        // highlights and shadows
+        kIllumination = 3
+    };
+
+    // Select the backend used by the next set_region().
+    void set_solver(Solver solver);
+    Solver solver() const;
+    // Select the guidance field, without refactoring.
+    void set_guidance(Guidance guidance);
+    Guidance guidance() const;
+    // Largest channel difference |s_p - s_q| above which kFlatten sees an
+    // edge between p and q
+    void set_edge_threshold(float threshold);
+
+    // Assemble the Laplacian over the pixels of `region` (unknown k is the
+    // pixel of dense index k) and factor it. Returns false if the region is
+    // empty or the factorization failed.
+    bool set_region(const Region& region);
+    // Keep the pixels of `source` around the region (in the coordinates of
+    // the region) and compute the guidance field. Must be called after
+    // set_region().
+    void set_source(const Image& source);
+    // Whether both the region and the source are set.
+    bool ready() const;
+
+    // Clone the region into `target`, with its pixel (x, y) at
+    // (x + offset_x, y + offset_y). Only the colour channels of the pixels
+    // inside the target are written; outside the target, the boundary
+    // values are taken from its nearest edge pixel.
+    void clone(Image& target, int offset_x, int offset_y);
+
+   private:
+    // Calls fn(k, x, y) for the unknowns k, with their pixel (x, y)
+    template<typename Fn>
+    void for_each_unknown(Fn fn) const;
+    // Calls fn(k, cell) for the unknowns k, with their cell in the grid
+    template<typename Fn>
+    void for_each_grid_cell(Fn fn) const;
+    // Source pixel (x, y), in region coordinates next to the region
+    float source_value(int x, int y, int c) const;
+    // Sum of v_pq over the neighbours of each unknown, for the guidance
+    // fields that only depend on the source
+    void build_guidance();
+    // Same for kMixed, which depends on the target under the region
+    Eigen::MatrixX3d mixed_guidance(
+        const Image& target,
+        int offset_x,
+        int offset_y,
+        int channels) const;
+
+    // A neighbour q of an unknown lying outside the region: t_q goes to the
+    // right-hand side of the row.
+    struct BoundaryLink
+    {
+        int row;
+        int x, y;  // q in region coordinates
+    };
+
+    Region region_;
+    std::vector<BoundaryLink> boundary_;
+
+    Solver solver_type_ = kDirect;
+    bool prepared_ = false;
+    Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>> factorization_;
+    // Multigrid: the grid covers the bounding box of the region plus a
+    // border of one cell, from (grid_x_, grid_y_) in region coordinates
+    MultigridSolver multigrid_;
+    int grid_x_ = 0, grid_y_ = 0, grid_width_ = 0, grid_height_ = 0;
+    std::vector<float> grid_rhs_;
+    // Last solution of each channel on the grid, the next initial guess
+    std::vector<float> warm_start_[3];
+    Guidance guidance_type_ = kImport;
+    float edge_threshold_ = 24.0f;
+    // Source over the bounding box of the region plus a ring of one pixel
+    // (clamped to the source image), channels interleaved
+    std::vector<float> source_;
+    int source_width_ = 0;
+    // sum_q v_pq of each unknown, one column per colour channel
+    Eigen::MatrixX3d guidance_;
+    int channels_ = 0;
+};
+}  // namespace USTC_CG
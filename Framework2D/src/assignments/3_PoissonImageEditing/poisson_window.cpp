@@ -18,6 +18,7 @@ PoissonWindow::~PoissonWindow()
 void PoissonWindow::draw()
 {
     draw_toolbar();
+    draw_io_status();
     if (flag_open_target_file_dialog_)
         draw_open_target_image_file_dialog();
     if (flag_open_source_file_dialog_ && p_target_)
@@ -62,7 +63,15 @@ void PoissonWindow::draw_toolbar()
         {
             p_target_->restore();
         }
-        add_tooltips("Replace the target image with back up data.");
+        add_tooltips("Undo all the clones.");
+        if (ImGui::MenuItem("Undo") && p_target_)
+        {
+            p_target_->undo();
+        }
+        if (ImGui::MenuItem("Redo") && p_target_)
+        {
+            p_target_->redo();
+        }
 
         ImGui::Separator();
 
@@ -73,6 +82,21 @@ void PoissonWindow::draw_toolbar()
             "to select rectangle (default) in the source.");
         if (p_source_)
             p_source_->enable_selecting(selectable);
+        if (ImGui::BeginMenu("Region"))
+        {
+            if (ImGui::MenuItem("Rect") && p_source_)
+                p_source_->set_rect();
+            add_tooltips("Drag left mouse to select a rectangle.");
+            if (ImGui::MenuItem("Polygon") && p_source_)
+                p_source_->set_polygon();
+            add_tooltips(
+                "Left click to add the vertices of a polygon, right click to "
+                "close it.");
+            if (ImGui::MenuItem("Freehand") && p_source_)
+                p_source_->set_freehand();
+            add_tooltips("Drag left mouse to draw a lasso around the region.");
+            ImGui::EndMenu();
+        }
         static bool realtime = false;
         ImGui::Checkbox("Realtime", &realtime);
         add_tooltips(
@@ -81,6 +105,14 @@ void PoissonWindow::draw_toolbar()
             "mouse.");
         if (p_target_)
             p_target_->set_realtime(realtime);
+        static bool multigrid = false;
+        ImGui::Checkbox("Multigrid", &multigrid);
+        add_tooltips(
+            "On: Solve seamless cloning with multigrid, in linear time and "
+            "memory. Faster to set up than the default factorization for "
+            "large selections (around a megapixel).");
+        if (p_target_)
+            p_target_->set_multigrid(multigrid);
 
         ImGui::Separator();
 
@@ -91,8 +123,38 @@ void PoissonWindow::draw_toolbar()
         add_tooltips(
             "Press this button and then click in the target image, to "
             "clone the selected region to the target image.");
-        // HW3_TODO: You may add more items in the menu for the different types
-        // of Poisson editing.
+
+        if (ImGui::MenuItem("Seamless") && p_target_ && p_source_)
+        {
+            p_target_->set_seamless();
+        }
+        add_tooltips(
+            "Press this button and then click in the target image, to blend "
+            "the selected region into the target image by solving the "
+            "Poisson equation. The system is factored once per selection, so "
+            "it can be dragged in realtime mode.");
+        if (ImGui::MenuItem("Mixed") && p_target_ && p_source_)
+        {
+            p_target_->set_mixed();
+        }
+        add_tooltips(
+            "Seamless cloning guided by the stronger of the source and target "
+            "gradients, so that the target texture shows through the flat "
+            "parts of the source.");
+        if (ImGui::MenuItem("Flatten") && p_target_ && p_source_)
+        {
+            p_target_->set_flatten();
+        }
+        add_tooltips(
+            "Seamless cloning that only keeps the gradients of the source on "
+            "its edges, which flattens its texture.");
+        if (ImGui::MenuItem("Illumination") && p_target_ && p_source_)
+        {
+            p_target_->set_illumination();
+        }
+        add_tooltips(
+            "Seamless cloning with compressed gradients in the log domain, "
+            "which evens out the highlights and shadows of the source.");
 
         ImGui::EndMainMenuBar();
     }
@@ -104,6 +166,13 @@ void PoissonWindow::draw_target()
     ImGui::SetNextWindowSize(ImVec2(image_size.x + 60, image_size.y + 60));
     if (ImGui::Begin("Target Image", &flag_show_target_view_))
     {
+        // Texture upload of the last edit, which only sends the changed
+        // rectangles
+        const auto& upload = p_target_->last_upload();
+        ImGui::Text(
+            "Upload: %zu KB (%zu KB skipped)",
+            upload.uploaded_bytes / 1024,
+            upload.saved_bytes / 1024);
         // Place the image in the center of the window
         const auto& min = ImGui::GetCursorScreenPos();
         const auto& size = ImGui::GetContentRegionAvail();
@@ -140,7 +209,10 @@ void PoissonWindow::draw_open_target_image_file_dialog()
     config.path = DATA_PATH;
     config.flags = ImGuiFileDialogFlags_Modal;
     ImGuiFileDialog::Instance()->OpenDialog(
-        "ChooseTargetOpenFileDlg", "Choose Image File", ".jpg,.png", config);
+        "ChooseTargetOpenFileDlg",
+        "Choose Image File",
+        ".jpg,.png,.uti",
+        config);
     ImVec2 main_size = ImGui::GetMainViewport()->WorkSize;
     ImVec2 dlg_size(main_size.x / 2, main_size.y / 2);
     if (ImGuiFileDialog::Instance()->Display(
@@ -150,10 +222,13 @@ void PoissonWindow::draw_open_target_image_file_dialog()
         {
             std::string filePathName =
                 ImGuiFileDialog::Instance()->GetFilePathName();
-            std::string label = filePathName;
-            p_target_ = std::make_shared<TargetImageWidget>(label, filePathName);
-            if (p_source_)
-                p_target_->set_source(p_source_);
+            // Tiled images are mapped, not decoded: only the view is read.
+            // Others are decoded in the background, see draw_io_status().
+            if (is_tiled_image(filePathName))
+                set_target(std::make_shared<TargetImageWidget>(
+                    filePathName, filePathName));
+            else
+                target_load_ = AsyncImageIO::instance().load(filePathName);
         }
         ImGuiFileDialog::Instance()->Close();
         flag_open_target_file_dialog_ = false;
@@ -166,7 +241,10 @@ void PoissonWindow::draw_open_source_image_file_dialog()
     config.path = DATA_PATH;
     config.flags = ImGuiFileDialogFlags_Modal;
     ImGuiFileDialog::Instance()->OpenDialog(
-        "ChooseSourceOpenFileDlg", "Choose Image File", ".jpg,.png", config);
+        "ChooseSourceOpenFileDlg",
+        "Choose Image File",
+        ".jpg,.png,.uti",
+        config);
     ImVec2 main_size = ImGui::GetMainViewport()->WorkSize;
     ImVec2 dlg_size(main_size.x / 2, main_size.y / 2);
     if (ImGuiFileDialog::Instance()->Display(
@@ -176,11 +254,11 @@ void PoissonWindow::draw_open_source_image_file_dialog()
         {
             std::string filePathName =
                 ImGuiFileDialog::Instance()->GetFilePathName();
-            std::string label = filePathName;
-            p_source_ = std::make_shared<SourceImageWidget>(label, filePathName);
-            // Bind the source image to the target
-            if (p_source_)
-                p_target_->set_source(p_source_);
+            if (is_tiled_image(filePathName))
+                set_source(std::make_shared<SourceImageWidget>(
+                    filePathName, filePathName));
+            else
+                source_load_ = AsyncImageIO::instance().load(filePathName);
         }
         ImGuiFileDialog::Instance()->Close();
         flag_open_source_file_dialog_ = false;
@@ -203,14 +281,72 @@ void PoissonWindow::draw_save_image_file_dialog()
         {
             std::string filePathName =
                 ImGuiFileDialog::Instance()->GetFilePathName();
-            std::string label = filePathName;
             if (p_target_)
-                p_target_->save_to_disk(filePathName);
+                save_ = p_target_->save_to_disk(filePathName);
         }
         ImGuiFileDialog::Instance()->Close();
         flag_save_file_dialog_ = false;
     }
 }
+void PoissonWindow::draw_io_status()
+{
+    // Decoded images become widgets on the frame after they are ready
+    if (target_load_.ready())
+    {
+        const std::string filename = target_load_.filename();
+        if (std::shared_ptr<Image> image = take_result(target_load_))
+            set_target(
+                std::make_shared<TargetImageWidget>(filename, filename, image));
+        else
+            std::cout << "Failed to load image from file " << filename
+                      << std::endl;
+    }
+    if (source_load_.ready())
+    {
+        const std::string filename = source_load_.filename();
+        if (std::shared_ptr<Image> image = take_result(source_load_))
+            set_source(
+                std::make_shared<SourceImageWidget>(filename, filename, image));
+        else
+            std::cout << "Failed to load image from file " << filename
+                      << std::endl;
+    }
+    if (save_.ready() && !take_result(save_))
+        std::cout << "Failed to save image to file " << save_.filename()
+                  << std::endl;
+
+    if (!target_load_.valid() && !source_load_.valid() && !save_.valid())
+        return;
+    ImGui::Begin(
+        "Files",
+        nullptr,
+        ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoCollapse);
+    if (target_load_.valid())
+        draw_progress(
+            "Loading", target_load_.filename(), target_load_.progress());
+    if (source_load_.valid())
+        draw_progress(
+            "Loading", source_load_.filename(), source_load_.progress());
+    if (save_.valid())
+        draw_progress("Saving", save_.filename(), save_.progress());
+    ImGui::End();
+}
+
+void PoissonWindow::set_target(std::shared_ptr<TargetImageWidget> target)
+{
+    p_target_ = std::move(target);
+    if (p_source_)
+        p_target_->set_source(p_source_);
+}
+
+void PoissonWindow::set_source(std::shared_ptr<SourceImageWidget> source)
+{
+    p_source_ = std::move(source);
+    // Bind the source image to the target
+    if (p_target_)
+        p_target_->set_source(p_source_);
+}
+
 void PoissonWindow::add_tooltips(std::string desc)
 {
     if (ImGui::BeginItemTooltip())
@@ -24,6 +24,11 @@ class PoissonWindow : public Window
     void draw_open_target_image_file_dialog();
     void draw_open_source_image_file_dialog();
     void draw_save_image_file_dialog();
+    // Pick up the finished loads and saves, show the progress of the others
+    void draw_io_status();
+    // Show a new image and bind the source to the target
+    void set_target(std::shared_ptr<TargetImageWidget> target);
+    void set_source(std::shared_ptr<SourceImageWidget> source);
 
     void add_tooltips(std::string desc);
 
@@ -32,6 +37,10 @@ class PoissonWindow : public Window
     // Source Image Component
     std::shared_ptr<SourceImageWidget> p_source_ = nullptr;
 
+    // Files being loaded or saved in the background
+    IoTask<std::shared_ptr<Image>> target_load_, source_load_;
+    IoTask<bool> save_;
+
     bool flag_show_target_view_ = true;
     bool flag_show_source_view_ = true;
     bool flag_open_target_file_dialog_ = false;
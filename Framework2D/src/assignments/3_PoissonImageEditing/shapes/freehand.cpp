@@ -0,0 +1,19 @@
+#include "freehand.h"
+
+namespace USTC_CG
+{
+Freehand::Freehand(float start_point_x, float start_point_y)
+{
+    x_list_.push_back(start_point_x);
+    y_list_.push_back(start_point_y);
+}
+
+void Freehand::update(float x, float y)
+{
+    const float dx = x - x_list_.back(), dy = y - y_list_.back();
+    if (dx * dx + dy * dy < 1.0f)
+        return;
+    x_list_.push_back(x);
+    y_list_.push_back(y);
+}
+}  // namespace USTC_CG
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "polygon.h"
+
+namespace USTC_CG
+{
+// Lasso: a polygon with a vertex at every mouse position of the stroke
+class Freehand : public Polygon
+{
+   public:
+    Freehand() = default;
+
+    // Initialize the stroke at its start point
+    Freehand(float start_point_x, float start_point_y);
+
+    virtual ~Freehand() = default;
+
+    // Overrides Polygon's update function to append the mouse position, if
+    // it moved by at least a pixel
+    void update(float x, float y) override;
+};
+}  // namespace USTC_CG
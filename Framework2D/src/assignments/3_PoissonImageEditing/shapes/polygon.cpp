@@ -0,0 +1,121 @@
+#include "polygon.h"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace USTC_CG
+{
+Polygon::Polygon(float start_point_x, float start_point_y)
+    : x_list_{ start_point_x, start_point_x },
+      y_list_{ start_point_y, start_point_y }
+{
+}
+
+// Draw the polygon using ImGui
+void Polygon::draw(const Config& config) const
+{
+    ImDrawList* draw_list = ImGui::GetWindowDrawList();
+
+    std::vector<ImVec2> points(x_list_.size());
+    for (std::size_t i = 0; i < points.size(); ++i)
+        points[i] = ImVec2(
+            config.bias[0] + x_list_[i], config.bias[1] + y_list_[i]);
+    draw_list->AddPolyline(
+        points.data(),
+        static_cast<int>(points.size()),
+        IM_COL32(
+            config.line_color[0],
+            config.line_color[1],
+            config.line_color[2],
+            config.line_color[3]),
+        ImDrawFlags_Closed,
+        config.line_thickness);
+}
+
+void Polygon::update(float x, float y)
+{
+    x_list_.back() = x;
+    y_list_.back() = y;
+}
+
+void Polygon::add_control_point(float x, float y)
+{
+    x_list_.push_back(x);
+    y_list_.push_back(y);
+}
+
+std::vector<Region::Span> Polygon::get_interior_spans() const
+{
+    const std::size_t n = x_list_.size();
+    if (n < 3)
+        return {};
+
+    // Edge table. Pixel centers sit at (x + 0.5, y + 0.5); an edge crosses
+    // the rows whose center is in [y_min, y_max), so that a vertex shared
+    // by two edges is only counted once.
+    struct Edge
+    {
+        int y_begin, y_end;  // rows crossed
+        double x;            // at the center of the current row
+        double slope;        // dx / dy
+    };
+    std::vector<Edge> edges;
+    edges.reserve(n);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        double x0 = x_list_[i], y0 = y_list_[i];
+        double x1 = x_list_[(i + 1) % n], y1 = y_list_[(i + 1) % n];
+        if (y0 > y1)
+        {
+            std::swap(x0, x1);
+            std::swap(y0, y1);
+        }
+        const int y_begin = static_cast<int>(std::ceil(y0 - 0.5));
+        const int y_end = static_cast<int>(std::ceil(y1 - 0.5));
+        // Horizontal, or between two row centers
+        if (y_begin >= y_end)
+            continue;
+        const double slope = (x1 - x0) / (y1 - y0);
+        edges.push_back(
+            { y_begin, y_end, x0 + (y_begin + 0.5 - y0) * slope, slope });
+    }
+    std::sort(
+        edges.begin(),
+        edges.end(),
+        [](const Edge& a, const Edge& b) { return a.y_begin < b.y_begin; });
+
+    // Active edge table, sorted by x on each row
+    std::vector<Region::Span> spans;
+    std::vector<Edge> active;
+    std::size_t next = 0;
+    int y = 0;
+    while (next < edges.size() || !active.empty())
+    {
+        if (active.empty())
+            y = edges[next].y_begin;
+        while (next < edges.size() && edges[next].y_begin == y)
+            active.push_back(edges[next++]);
+        // Insertion sort: the order barely changes from a row to the next
+        for (std::size_t i = 1; i < active.size(); ++i)
+            for (std::size_t j = i; j > 0 && active[j].x < active[j - 1].x;
+                 --j)
+                std::swap(active[j], active[j - 1]);
+        // Pixels whose center is between two consecutive crossings
+        for (std::size_t i = 0; i + 1 < active.size(); i += 2)
+        {
+            const int x0 = static_cast<int>(std::ceil(active[i].x - 0.5));
+            const int x1 = static_cast<int>(std::ceil(active[i + 1].x - 0.5));
+            if (x0 < x1)
+                spans.push_back({ y, x0, x1 });
+        }
+
+        ++y;
+        std::erase_if(active, [y](const Edge& e) { return e.y_end <= y; });
+        for (Edge& edge : active)
+            edge.x += edge.slope;
+    }
+    return spans;
+}
+}  // namespace USTC_CG
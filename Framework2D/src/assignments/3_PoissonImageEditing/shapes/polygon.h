@@ -0,0 +1,39 @@
+#pragma once
+
+#include "shape.h"
+
+#include <vector>
+
+namespace USTC_CG
+{
+class Polygon : public Shape
+{
+   public:
+    Polygon() = default;
+
+    // Initialize a polygon at a start point, with a second vertex that
+    // follows the mouse
+    Polygon(float start_point_x, float start_point_y);
+
+    virtual ~Polygon() = default;
+
+    // Draws the closed polygon on the screen
+    void draw(const Config& config) const override;
+
+    // Overrides Shape's update function to move the last vertex during
+    // interaction
+    void update(float x, float y) override;
+
+    // Fixes the last vertex and starts a new one at (x, y)
+    void add_control_point(float x, float y) override;
+
+    // Scanline fill of the interior (even-odd rule) with an edge table,
+    // producing runs directly: O(vertices log vertices + rows * crossings)
+    // instead of a test per pixel of the bounding box.
+    std::vector<Region::Span> get_interior_spans() const override;
+
+   protected:
+    // Vertices, the polygon being closed from the last one to the first
+    std::vector<float> x_list_, y_list_;
+};
+}  // namespace USTC_CG
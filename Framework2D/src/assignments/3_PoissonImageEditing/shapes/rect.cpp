@@ -2,6 +2,8 @@
 
 #include <imgui.h>
 
+#include <algorithm>
+
 namespace USTC_CG
 {
 // Draw the rectangle using ImGui
@@ -29,35 +31,17 @@ void Rect::update(float x, float y)
     end_point_y_ = y;
 }
 
-std::vector<std::pair<int, int>> Rect::get_interior_pixels() const
+std::vector<Region::Span> Rect::get_interior_spans() const
 {
-    int start_pixel_x = static_cast<int>(start_point_x_);
-    int start_pixel_y = static_cast<int>(start_point_y_);
-    int end_pixel_x = static_cast<int>(end_point_x_);
-    int end_pixel_y = static_cast<int>(end_point_y_);
-    // Sort the start and end points
-    if (start_pixel_x > end_pixel_x)
-    {
-        std::swap(start_pixel_x, end_pixel_x);
-    }
-    if (start_pixel_y > end_pixel_y)
-    {
-        std::swap(start_pixel_y, end_pixel_y);
-    }
-    // Then the width and height are positive
-    int width = end_pixel_x - start_pixel_x + 1;
-    int height = end_pixel_y - start_pixel_y + 1;
-    // Pick the pixels in the rectangle (including the boundary)
-    std::vector<std::pair<int, int>> int_pixels;
-    int_pixels.reserve(width * height);
-    for (int i = start_pixel_x; i <= end_pixel_x; ++i)
-    {
-        for (int j = start_pixel_y; j <= end_pixel_y; ++j)
-        {
-            int_pixels.push_back(std::make_pair(i, j));
-        }
-    }
-    return int_pixels;
+    const int x0 = static_cast<int>(std::min(start_point_x_, end_point_x_));
+    const int x1 = static_cast<int>(std::max(start_point_x_, end_point_x_));
+    const int y0 = static_cast<int>(std::min(start_point_y_, end_point_y_));
+    const int y1 = static_cast<int>(std::max(start_point_y_, end_point_y_));
+    std::vector<Region::Span> spans;
+    spans.reserve(y1 - y0 + 1);
+    for (int y = y0; y <= y1; ++y)
+        spans.push_back({ y, x0, x1 + 1 });
+    return spans;
 }
 
 }  // namespace USTC_CG
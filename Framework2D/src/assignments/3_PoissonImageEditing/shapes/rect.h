@@ -34,9 +34,9 @@ class Rect : public Shape
     // interaction
     void update(float x, float y) override;
 
-    // Get the interior rasterized pixels of the rectangle
-    // Returns the array of pixel coordinates that are inside the rectangle
-    std::vector<std::pair<int, int>> get_interior_pixels() const;
+    // The pixels inside the rectangle (its boundary included), one span per
+    // row
+    std::vector<Region::Span> get_interior_spans() const override;
 
    private:
     // Coordinates of the top-left and bottom-right corners of the rectangle
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <vector>
+
+#include "poisson/region.h"
+
 namespace USTC_CG
 {
 class Shape
@@ -47,5 +51,16 @@ class Shape
      * @param x, y Control point to be added. e.g. vertex of a polygon.
      */
     virtual void add_control_point(float x, float y) {}
+    /**
+     * Rasterizes the interior of the shape, for region selection.
+     * Shapes without an interior (e.g. lines) return no pixels.
+     *
+     * @return The interior pixels as runs [x0, x1) on rows y, a pixel being
+     * inside when its center is.
+     */
+    virtual std::vector<Region::Span> get_interior_spans() const
+    {
+        return {};
+    }
 };
 }  // namespace USTC_CG
\ No newline at end of file
@@ -3,20 +3,35 @@
 #include <algorithm>
 #include <cmath>
 
+#include "shapes/freehand.h"
+#include "shapes/polygon.h"
+#include "shapes/rect.h"
+
 namespace USTC_CG
 {
 using uchar = unsigned char;
 
 SourceImageWidget::SourceImageWidget(
     const std::string& label,
-    const std::string& filename)
-    : ImageWidget(label, filename)
+    const std::string& filename,
+    std::shared_ptr<Image> data)
+    : ImageWidget(label, filename, std::move(data))
 {
     if (data_)
         selected_region_mask_ =
             std::make_shared<Image>(data_->width(), data_->height(), 1);
 }
 
+void SourceImageWidget::view_changed()
+{
+    selected_region_mask_ =
+        std::make_shared<Image>(data_->width(), data_->height(), 1);
+    selected_region_ = Region();
+    selected_shape_.reset();
+    draw_status_ = false;
+    ++region_version_;
+}
+
 void SourceImageWidget::draw()
 {
     // Draw the image
@@ -52,6 +67,8 @@ void SourceImageWidget::select_region()
     mouse_move_event();
     if (!ImGui::IsMouseDown(ImGuiMouseButton_Left))
         mouse_release_event();
+    if (is_hovered_ && ImGui::IsMouseClicked(ImGuiMouseButton_Right))
+        mouse_right_click_event();
 
     // Region Shape Visualization
     if (selected_shape_)
@@ -64,11 +81,31 @@ void SourceImageWidget::select_region()
     }  
 }
 
+void SourceImageWidget::set_rect()
+{
+    region_type_ = kRect;
+}
+
+void SourceImageWidget::set_polygon()
+{
+    region_type_ = kPolygon;
+}
+
+void SourceImageWidget::set_freehand()
+{
+    region_type_ = kFreehand;
+}
+
 std::shared_ptr<Image> SourceImageWidget::get_region_mask()
 {
     return selected_region_mask_;
 }
 
+const Region& SourceImageWidget::get_region() const
+{
+    return selected_region_;
+}
+
 std::shared_ptr<Image> SourceImageWidget::get_data()
 {
     return data_;
@@ -79,6 +116,11 @@ ImVec2 SourceImageWidget::get_position() const
     return start_;
 }
 
+int SourceImageWidget::region_version() const
+{
+    return region_version_;
+}
+
 void SourceImageWidget::mouse_click_event()
 {
     // Start drawing the region 
@@ -86,9 +128,6 @@ void SourceImageWidget::mouse_click_event()
     {
         draw_status_ = true;
         start_ = end_ = mouse_pos_in_canvas();
-        // HW3_TODO(optional): You can add more shapes for region selection. You
-        // can also consider using the implementation in HW1. (We use rectangle
-        // for example)
         switch (region_type_)
         {
             case USTC_CG::SourceImageWidget::kDefault: break;
@@ -98,9 +137,26 @@ void SourceImageWidget::mouse_click_event()
                     std::make_unique<Rect>(start_.x, start_.y, end_.x, end_.y);
                 break;
             }
+            case USTC_CG::SourceImageWidget::kPolygon:
+            {
+                selected_shape_ = std::make_unique<Polygon>(start_.x, start_.y);
+                break;
+            }
+            case USTC_CG::SourceImageWidget::kFreehand:
+            {
+                selected_shape_ =
+                    std::make_unique<Freehand>(start_.x, start_.y);
+                break;
+            }
             default: break;
         }
     }
+    // Fix the current vertex of the polygon
+    else if (region_type_ == kPolygon && selected_shape_)
+    {
+        end_ = mouse_pos_in_canvas();
+        selected_shape_->add_control_point(end_.x, end_.y);
+    }
 }
 
 void SourceImageWidget::mouse_move_event()
@@ -116,13 +172,22 @@ void SourceImageWidget::mouse_move_event()
 
 void SourceImageWidget::mouse_release_event()
 {
-    // Finish drawing the region
+    // Finish drawing the region; a polygon is finished by a right click
+    if (draw_status_ && selected_shape_ && region_type_ != kPolygon)
+        finish_region();
+}
+
+void SourceImageWidget::mouse_right_click_event()
+{
     if (draw_status_ && selected_shape_)
-    {
-        draw_status_ = false;
-        // Update the selected region.
-        update_selected_region();
-    }
+        finish_region();
+}
+
+void SourceImageWidget::finish_region()
+{
+    draw_status_ = false;
+    // Update the selected region.
+    update_selected_region();
 }
 
 ImVec2 SourceImageWidget::mouse_pos_in_canvas() const
@@ -140,24 +205,15 @@ void SourceImageWidget::update_selected_region()
 {
     if (selected_shape_ == nullptr)
         return;
-    // HW3_TODO(Optional): The selected_shape_ call its get_interior_pixels()
-    // function to get the interior pixels. For other shapes, you can implement
-    // their own get_interior_pixels()
-    std::vector<std::pair<int, int>> interior_pixels =
-        selected_shape_->get_interior_pixels();
-    // Clear the selected region mask
-    for (int i = 0; i < selected_region_mask_->width(); ++i)
-        for (int j = 0; j < selected_region_mask_->height(); ++j)
-            selected_region_mask_->set_pixel(i, j, { 0 });
-    // Set the selected pixels with 255
-    for (const auto& pixel : interior_pixels)
-    {
-        int x = pixel.first;
-        int y = pixel.second;
-        if (x < 0 || x >= selected_region_mask_->width() || 
-            y < 0 || y >= selected_region_mask_->height())
-            continue;
-        selected_region_mask_->set_pixel(x, y, { 255 });
-    }
+    // The selected_shape_ rasterizes its interior into row runs
+    Region region(
+        selected_shape_->get_interior_spans(),
+        selected_region_mask_->width(),
+        selected_region_mask_->height());
+    // Only the pixels of the previous and of the new region change
+    selected_region_.fill(*selected_region_mask_, 0);
+    region.fill(*selected_region_mask_, 255);
+    selected_region_ = std::move(region);
+    ++region_version_;
 }
 }  // namespace USTC_CG
\ No newline at end of file
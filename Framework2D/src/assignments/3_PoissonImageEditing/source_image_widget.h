@@ -1,23 +1,26 @@
 #pragma once
 
 #include "common/image_widget.h"
-#include "shapes/rect.h"
+#include "poisson/region.h"
+#include "shapes/shape.h"
 
 namespace USTC_CG
 {
 class SourceImageWidget : public ImageWidget
 {
    public:
-    // HW3_TODO(optional): Add more region shapes like polygon and freehand.
     enum RegionType
     {
         kDefault = 0,
-        kRect = 1
+        kRect = 1,
+        kPolygon = 2,
+        kFreehand = 3
     };
 
     explicit SourceImageWidget(
         const std::string& label,
-        const std::string& filename);
+        const std::string& filename,
+        std::shared_ptr<Image> data = nullptr);
     virtual ~SourceImageWidget() noexcept = default;
 
     void draw() override;
@@ -25,39 +28,60 @@ class SourceImageWidget : public ImageWidget
     // Region selecting interaction
     void enable_selecting(bool flag);
     void select_region();
+    // Shape of the next selection. A rectangle is dragged, a polygon gets a
+    // vertex per left click and is closed by a right click, a freehand lasso
+    // follows the mouse until it is released.
+    void set_rect();
+    void set_polygon();
+    void set_freehand();
     // Get the selected region in the source image, this would be a binary mask.
     // The **size** of the mask should be the same as the source image.
     // The **value** of the mask should be 0 or 255: 0 for the background and
     // 255 for the selected region.
     std::shared_ptr<Image> get_region_mask();
+    // The same selection as row spans, with its bounding box and the dense
+    // index of its pixels
+    const Region& get_region() const;
     // Get the source image data
     std::shared_ptr<Image> get_data();
     // Get the position to locate the region in the target image.
     // We return the start point of the selected region as default.
     ImVec2 get_position() const;
+    // Incremented whenever the region mask changes, so that users can cache
+    // data derived from it.
+    int region_version() const;
+
+   protected:
+    // A new view of a tiled image: the selection is cleared
+    void view_changed() override;
 
    private:
     // Event handlers for mouse interactions.
     void mouse_click_event();
     void mouse_move_event();
     void mouse_release_event();
+    void mouse_right_click_event();
 
     // Calculates mouse's relative position in the canvas.
     ImVec2 mouse_pos_in_canvas() const;
 
     // Fill the selected region by the picking the pixels in the selected shape
     void update_selected_region();
+    // Stop drawing the shape and select its interior
+    void finish_region();
 
     RegionType region_type_ = kRect;
     // The shape we draw in the source image to select the region.
     // By default, we use a rectangle to select the region.
-    // HW3_TODO(optional): You can add more shapes for region selection.
-    std::unique_ptr<Rect> selected_shape_;
+    std::unique_ptr<Shape> selected_shape_;
     // The selected region in the source image, this would be a binary mask.
     // The **size** of the mask should be the same as the source image.
     // The **value** of the mask should be 0 or 255: 0 for the background and
     // 255 for the selected region.
     std::shared_ptr<Image> selected_region_mask_;
+    // The pixels set in the mask; only they are cleared on the next update
+    Region selected_region_;
+    int region_version_ = 0;
 
     ImVec2 start_, end_;
     bool flag_enable_selecting_region_ = false;
@@ -1,18 +1,30 @@
 #include "target_image_widget.h"
 
+#include <algorithm>
 #include <cmath>
 
+#include "common/profiler.h"
+#include "common/tile_scheduler.h"
+
 namespace USTC_CG
 {
 using uchar = unsigned char;
 
 TargetImageWidget::TargetImageWidget(
     const std::string& label,
-    const std::string& filename)
-    : ImageWidget(label, filename)
+    const std::string& filename,
+    std::shared_ptr<Image> data)
+    : ImageWidget(label, filename, std::move(data))
 {
     if (data_)
-        back_up_ = std::make_shared<Image>(*data_);
+        history_.reset(*data_);
+}
+
+void TargetImageWidget::view_changed()
+{
+    history_.reset(*data_);
+    cloned_rect_ = {};
+    edit_status_ = false;
 }
 
 void TargetImageWidget::draw()
@@ -45,6 +57,7 @@ void TargetImageWidget::draw()
 void TargetImageWidget::set_source(std::shared_ptr<SourceImageWidget> source)
 {
     source_image_ = source;
+    cloner_region_version_ = -1;
 }
 
 void TargetImageWidget::set_realtime(bool flag)
@@ -52,12 +65,45 @@ void TargetImageWidget::set_realtime(bool flag)
     flag_realtime_updating = flag;
 }
 
+void TargetImageWidget::set_multigrid(bool flag)
+{
+    const auto solver =
+        flag ? SeamlessCloner::kMultigrid : SeamlessCloner::kDirect;
+    if (cloner_.solver() == solver)
+        return;
+    cloner_.set_solver(solver);
+    cloner_region_version_ = -1;
+}
+
 void TargetImageWidget::restore()
 {
-    *data_ = *back_up_;
+    undo_clone();
+    history_.go_to(*data_, 0);
     update();
 }
 
+void TargetImageWidget::undo()
+{
+    undo_clone();
+    history_.undo(*data_);
+    update();
+}
+
+void TargetImageWidget::redo()
+{
+    undo_clone();
+    history_.redo(*data_);
+    update();
+}
+
+void TargetImageWidget::undo_clone()
+{
+    if (cloned_rect_.empty())
+        return;
+    history_.restore(*data_, cloned_rect_);
+    cloned_rect_ = {};
+}
+
 void TargetImageWidget::set_paste()
 {
     clone_type_ = kPaste;
@@ -68,8 +114,24 @@ void TargetImageWidget::set_seamless()
     clone_type_ = kSeamless;
 }
 
+void TargetImageWidget::set_mixed()
+{
+    clone_type_ = kMixed;
+}
+
+void TargetImageWidget::set_flatten()
+{
+    clone_type_ = kFlatten;
+}
+
+void TargetImageWidget::set_illumination()
+{
+    clone_type_ = kIllumination;
+}
+
 void TargetImageWidget::clone()
 {
+    ScopedTimer timer("clone");
     // The implementation of different types of cloning
     // HW3_TODO: 
     // 1. In this function, you should at least implement the "seamless"
@@ -80,55 +142,91 @@ void TargetImageWidget::clone()
     // solve the linear system). The real-time updating (update when the mouse
     // is moving) is only available when the checkerboard is selected. 
     if (data_ == nullptr || source_image_ == nullptr ||
-        source_image_->get_region_mask() == nullptr)
+        source_image_->get_data() == nullptr)
         return;
-    // The selected region in the source image, this would be a binary mask.
-    // The **size** of the mask should be the same as the source image.
-    // The **value** of the mask should be 0 or 255: 0 for the background and
-    // 255 for the selected region.
-    std::shared_ptr<Image> mask = source_image_->get_region_mask();
+    // The selected region in the source image, as row spans: the cloning
+    // only visits its pixels, whatever the size of the source image.
+    const Region& region = source_image_->get_region();
+    std::shared_ptr<Image> source = source_image_->get_data();
+    // The source pixel (x, y) goes to (x + offset_x, y + offset_y)
+    const int offset_x = static_cast<int>(mouse_position_.x) -
+                         static_cast<int>(source_image_->get_position().x);
+    const int offset_y = static_cast<int>(mouse_position_.y) -
+                         static_cast<int>(source_image_->get_position().y);
 
     switch (clone_type_)
     {
         case USTC_CG::TargetImageWidget::kDefault: break;
         case USTC_CG::TargetImageWidget::kPaste:
         {
-            restore();
+            undo_clone();
 
-            for (int x = 0; x < mask->width(); ++x)
-            {
-                for (int y = 0; y < mask->height(); ++y)
+            const int channels =
+                std::min(source->channels(), data_->channels());
+            // Every source pixel has its own target pixel, so the spans can
+            // be copied in parallel.
+            const std::vector<Region::Span>& spans = region.spans();
+            TileScheduler::instance().parallel_for(
+                spans.size(),
+                [&](std::size_t begin, std::size_t end)
                 {
-                    int tar_x =
-                        static_cast<int>(mouse_position_.x) + x -
-                        static_cast<int>(source_image_->get_position().x);
-                    int tar_y =
-                        static_cast<int>(mouse_position_.y) + y -
-                        static_cast<int>(source_image_->get_position().y);
-                    if (0 <= tar_x && tar_x < image_width_ && 0 <= tar_y &&
-                        tar_y < image_height_ && mask->get_pixel(x, y)[0] > 0)
+                    for (std::size_t s = begin; s < end; ++s)
                     {
-                        data_->set_pixel(
-                            tar_x,
-                            tar_y,
-                            source_image_->get_data()->get_pixel(x, y));
+                        const int y = spans[s].y;
+                        const int tar_y = y + offset_y;
+                        if (tar_y < 0 || tar_y >= image_height_)
+                            continue;
+                        const int x0 = std::max(spans[s].x0, -offset_x);
+                        const int x1 =
+                            std::min(spans[s].x1, image_width_ - offset_x);
+                        for (int x = x0; x < x1; ++x)
+                            for (int c = 0; c < channels; ++c)
+                                data_->at_unchecked(x + offset_x, tar_y, c) =
+                                    source->at_unchecked(x, y, c);
                     }
-                }
-            }
+                },
+                16);
             break;
         }
         case USTC_CG::TargetImageWidget::kSeamless:
+        case USTC_CG::TargetImageWidget::kMixed:
+        case USTC_CG::TargetImageWidget::kFlatten:
+        case USTC_CG::TargetImageWidget::kIllumination:
         {
-            // HW3_TODO: You should implement your own seamless cloning. For
-            // each pixel in the selected region, calculate the final RGB color
-            // by solving Poisson Equations.
-            restore();
-
+            // For each pixel in the selected region, the final RGB color
+            // solves the Poisson equations. The system only depends on the
+            // region, so it is factored again only when the selection
+            // changes; moving the region or changing the type of cloning
+            // (the guidance field) only updates the right-hand side.
+            undo_clone();
+            constexpr SeamlessCloner::Guidance kGuidance[] = {
+                SeamlessCloner::kImport,
+                SeamlessCloner::kMixed,
+                SeamlessCloner::kFlatten,
+                SeamlessCloner::kIllumination
+            };
+            cloner_.set_guidance(kGuidance[clone_type_ - kSeamless]);
+            if (cloner_region_version_ != source_image_->region_version())
+            {
+                cloner_region_version_ = source_image_->region_version();
+                if (cloner_.set_region(region))
+                    cloner_.set_source(*source);
+            }
+            cloner_.clone(*data_, offset_x, offset_y);
             break;
         }
         default: break;
     }
 
+    if (clone_type_ != kDefault)
+    {
+        const Region::Box& box = region.bounds();
+        cloned_rect_ = { std::max(box.x0 + offset_x, 0),
+                         std::max(box.y0 + offset_y, 0),
+                         std::min(box.x1 + offset_x, image_width_),
+                         std::min(box.y1 + offset_y, image_height_) };
+        data_->mark_dirty(cloned_rect_);
+    }
     update();
 }
 
@@ -154,6 +252,12 @@ void TargetImageWidget::mouse_release_event()
     if (edit_status_)
     {
         edit_status_ = false;
+        // The clone stays: it becomes a step of the history
+        if (!cloned_rect_.empty())
+        {
+            history_.commit(*data_, cloned_rect_);
+            cloned_rect_ = {};
+        }
     }
 }
 
@@ -1,7 +1,9 @@
 #pragma once
 
 #include "source_image_widget.h"
+#include "common/image_history.h"
 #include "common/image_widget.h"
+#include "poisson/seamless_cloner.h"
 
 namespace USTC_CG
 {
@@ -14,12 +16,16 @@ class TargetImageWidget : public ImageWidget
     {
         kDefault = 0,
         kPaste = 1,
-        kSeamless = 2
+        kSeamless = 2,
+        kMixed = 3,
+        kFlatten = 4,
+        kIllumination = 5
     };
 
     explicit TargetImageWidget(
         const std::string& label,
-        const std::string& filename);
+        const std::string& filename,
+        std::shared_ptr<Image> data = nullptr);
     virtual ~TargetImageWidget() noexcept = default;
 
     void draw() override;
@@ -27,16 +33,30 @@ class TargetImageWidget : public ImageWidget
     void set_source(std::shared_ptr<SourceImageWidget> source);
     // Enable real-time updating
     void set_realtime(bool flag);
-    // Restore the target image
+    // Solve seamless cloning with multigrid instead of a sparse
+    // factorization, for large regions
+    void set_multigrid(bool flag);
+    // Restore the target image. Each clone (a drag of the mouse) is a step
+    // of the history, which restore() rewinds to the start.
     void restore();
-    // HW3_TODO: Add more types of cloning, we have implemented the "Paste"
-    // type, you can implement seamless cloning, mix-gradient cloning, etc.
+    void undo();
+    void redo();
+    // Types of cloning. All the Poisson ones (every type but "Paste") share
+    // the factorization of the region, so switching between them only
+    // rebuilds the right-hand side.
     void set_paste();
     void set_seamless();
+    void set_mixed();
+    void set_flatten();
+    void set_illumination();
 
     // The clone function
     void clone();
 
+   protected:
+    // A new view of a tiled image: its history starts over
+    void view_changed() override;
+
    private:
     // Event handlers for mouse interactions.
     void mouse_click_event();
@@ -46,11 +66,23 @@ class TargetImageWidget : public ImageWidget
     // Calculates mouse's relative position in the canvas.
     ImVec2 mouse_pos_in_canvas() const;
 
-    // Store the original image data
-    std::shared_ptr<Image> back_up_;
+    // Copy back, from the history, the pixels written by the clone being
+    // dragged.
+    void undo_clone();
+
+    // Steps of the clones committed so far
+    ImageHistory history_;
+    // Pixels that the clone being dragged may have written, the only ones
+    // that differ from the current step: restoring and uploading them is
+    // enough on a move, and committing them on release.
+    Tile cloned_rect_;
     // Source image
     std::shared_ptr<SourceImageWidget> source_image_;
     CloneType clone_type_ = kDefault;
+    // Factored Poisson system of the selected region, and the version of the
+    // region it was built for (-1: none)
+    SeamlessCloner cloner_;
+    int cloner_region_version_ = -1;
 
     ImVec2 mouse_position_;
     bool edit_status_ = false;
@@ -0,0 +1,139 @@
+#include "common/async_io.h"
+
+#include <algorithm>
+
+#include "common/profiler.h"
+#include "common/tile_scheduler.h"
+
+namespace USTC_CG
+{
+AsyncImageIO::AsyncImageIO(int num_threads)
+{
+    // Jobs use the scheduler: create it first, so that it is destroyed last
+    TileScheduler::instance();
+    for (int i = 0; i < std::max(num_threads, 1); ++i)
+        workers_.emplace_back([this] { worker_loop(); });
+}
+
+AsyncImageIO::~AsyncImageIO()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_)
+        worker.join();
+}
+
+AsyncImageIO& AsyncImageIO::instance()
+{
+    static AsyncImageIO io;
+    return io;
+}
+
+IoTask<std::shared_ptr<Image>> AsyncImageIO::load(
+    const std::string& filename,
+    int channels)
+{
+    return submit<std::shared_ptr<Image>>(
+        filename,
+        [filename, channels](const IoProgress& progress)
+        {
+            ScopedTimer timer("load image");
+            return load_image(filename, channels, progress);
+        });
+}
+
+IoTask<bool> AsyncImageIO::save(
+    std::shared_ptr<const Image> image,
+    const std::string& filename,
+    int jpg_quality)
+{
+    return submit<bool>(
+        filename,
+        [image, filename, jpg_quality](const IoProgress& progress)
+        {
+            ScopedTimer timer("save image");
+            return image &&
+                   save_image(*image, filename, jpg_quality, progress);
+        });
+}
+
+IoTask<bool> AsyncImageIO::convert_to_tiled(
+    const std::string& input,
+    const std::string& output)
+{
+    return submit<bool>(
+        output,
+        [input, output](const IoProgress&)
+        {
+            ScopedTimer timer("convert to tiled");
+            return USTC_CG::convert_to_tiled(input, output);
+        });
+}
+
+IoTask<bool> AsyncImageIO::export_png(
+    std::shared_ptr<const TiledImage> image,
+    const std::string& filename)
+{
+    return submit<bool>(
+        filename,
+        [image, filename](const IoProgress& progress)
+        {
+            ScopedTimer timer("export png");
+            return image && USTC_CG::export_png(*image, filename, progress);
+        });
+}
+
+template<typename T>
+IoTask<T> AsyncImageIO::submit(
+    const std::string& filename,
+    std::function<T(const IoProgress&)> job)
+{
+    IoTask<T> task;
+    task.filename_ = filename;
+    task.progress_ = std::make_shared<std::atomic<float>>(0.0f);
+    // std::function must be copyable, the promise is not
+    auto promise = std::make_shared<std::promise<T>>();
+    task.future_ = promise->get_future();
+    auto progress = task.progress_;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        jobs_.emplace_back(
+            [promise, progress, job = std::move(job)]
+            {
+                try
+                {
+                    T result = job([&](float done) { progress->store(done); });
+                    progress->store(1.0f);
+                    promise->set_value(std::move(result));
+                }
+                catch (...)
+                {
+                    progress->store(1.0f);
+                    promise->set_exception(std::current_exception());
+                }
+            });
+    }
+    wake_.notify_one();
+    return task;
+}
+
+void AsyncImageIO::worker_loop()
+{
+    while (true)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+            if (jobs_.empty())
+                return;
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+        }
+        job();
+    }
+}
+}  // namespace USTC_CG
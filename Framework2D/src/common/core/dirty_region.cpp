@@ -0,0 +1,134 @@
+#include "common/dirty_region.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace USTC_CG
+{
+namespace
+{
+// Collapse into the whole image above this fraction of its area
+constexpr double kWholeFraction = 0.75;
+
+std::size_t area_of(const Tile& rect)
+{
+    return static_cast<std::size_t>(rect.width()) * rect.height();
+}
+
+Tile bounding_box(const Tile& a, const Tile& b)
+{
+    return { std::min(a.x0, b.x0),
+             std::min(a.y0, b.y0),
+             std::max(a.x1, b.x1),
+             std::max(a.y1, b.y1) };
+}
+
+// Overlapping or sharing an edge
+bool touching(const Tile& a, const Tile& b)
+{
+    return a.x0 <= b.x1 && b.x0 <= a.x1 && a.y0 <= b.y1 && b.y0 <= a.y1;
+}
+}  // namespace
+
+void DirtyRegion::reset(int width, int height)
+{
+    width_ = width;
+    height_ = height;
+    rects_.clear();
+}
+
+void DirtyRegion::add(Tile rect)
+{
+    rect.x0 = std::max(rect.x0, 0);
+    rect.y0 = std::max(rect.y0, 0);
+    rect.x1 = std::min(rect.x1, width_);
+    rect.y1 = std::min(rect.y1, height_);
+    if (rect.empty() || whole())
+        return;
+
+    // Absorb every rectangle the new one touches, until it touches none
+    // (the union may reach rectangles the original did not).
+    for (;;)
+    {
+        const auto it = std::find_if(
+            rects_.begin(),
+            rects_.end(),
+            [&](const Tile& other) { return touching(rect, other); });
+        if (it == rects_.end())
+            break;
+        rect = bounding_box(rect, *it);
+        rects_.erase(it);
+    }
+    rects_.push_back(rect);
+
+    if (rects_.size() > kMaxRects)
+    {
+        std::size_t best_i = 0, best_j = 1;
+        std::size_t best_waste = std::numeric_limits<std::size_t>::max();
+        for (std::size_t i = 0; i < rects_.size(); ++i)
+        {
+            for (std::size_t j = i + 1; j < rects_.size(); ++j)
+            {
+                const std::size_t waste =
+                    area_of(bounding_box(rects_[i], rects_[j])) -
+                    area_of(rects_[i]) - area_of(rects_[j]);
+                if (waste < best_waste)
+                {
+                    best_waste = waste;
+                    best_i = i;
+                    best_j = j;
+                }
+            }
+        }
+        const Tile merged = bounding_box(rects_[best_i], rects_[best_j]);
+        rects_.erase(rects_.begin() + best_j);
+        rects_.erase(rects_.begin() + best_i);
+        // The merged box may now touch others
+        return add(merged);
+    }
+
+    if (static_cast<double>(area()) >
+        kWholeFraction * static_cast<double>(total_area()))
+        add_all();
+}
+
+void DirtyRegion::add_all()
+{
+    if (total_area() > 0)
+        rects_.assign(1, Tile{ 0, 0, width_, height_ });
+}
+
+void DirtyRegion::clear()
+{
+    rects_.clear();
+}
+
+bool DirtyRegion::empty() const
+{
+    return rects_.empty();
+}
+
+bool DirtyRegion::whole() const
+{
+    return rects_.size() == 1 && rects_[0].x0 == 0 && rects_[0].y0 == 0 &&
+           rects_[0].x1 == width_ && rects_[0].y1 == height_;
+}
+
+const std::vector<Tile>& DirtyRegion::rects() const
+{
+    return rects_;
+}
+
+std::size_t DirtyRegion::area() const
+{
+    std::size_t sum = 0;
+    for (const Tile& rect : rects_)
+        sum += area_of(rect);
+    return sum;
+}
+
+std::size_t DirtyRegion::total_area() const
+{
+    return static_cast<std::size_t>(width_) * height_;
+}
+}  // namespace USTC_CG
@@ -0,0 +1,248 @@
+#include "common/image_history.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+namespace USTC_CG
+{
+namespace
+{
+Tile intersection(const Tile& a, const Tile& b)
+{
+    return { std::max(a.x0, b.x0),
+             std::max(a.y0, b.y0),
+             std::min(a.x1, b.x1),
+             std::min(a.y1, b.y1) };
+}
+
+// Bytes of one row of `rect` in one plane (the only plane when interleaved)
+std::size_t run_length(const Image& image, const Tile& rect)
+{
+    return static_cast<std::size_t>(rect.width()) * image.pixel_stride();
+}
+
+int num_planes(const Image& image)
+{
+    return image.layout() == Image::kInterleaved ? 1 : image.channels();
+}
+}  // namespace
+
+void ImageHistory::reset(const Image& image)
+{
+    width_ = image.width();
+    height_ = image.height();
+    tiles_x_ = (width_ + kTileSize - 1) / kTileSize;
+    tiles_y_ = (height_ + kTileSize - 1) / kTileSize;
+    Step step(static_cast<std::size_t>(tiles_x_) * tiles_y_);
+    for (std::size_t t = 0; t < step.size(); ++t)
+    {
+        auto data = std::make_shared<std::vector<unsigned char>>();
+        read(image, t, *data);
+        step[t] = std::move(data);
+    }
+    steps_.assign(1, std::move(step));
+    current_ = 0;
+}
+
+void ImageHistory::commit(const Image& image, const Tile& changed)
+{
+    if (steps_.empty())
+        return reset(image);
+    const Tile rect = intersection(changed, { 0, 0, width_, height_ });
+    Step step = steps_[current_];
+    bool changed_any = false;
+    if (!rect.empty())
+    {
+        const int tx0 = rect.x0 / kTileSize, tx1 = (rect.x1 - 1) / kTileSize;
+        const int ty0 = rect.y0 / kTileSize, ty1 = (rect.y1 - 1) / kTileSize;
+        auto data = std::make_shared<std::vector<unsigned char>>();
+        for (int ty = ty0; ty <= ty1; ++ty)
+        {
+            for (int tx = tx0; tx <= tx1; ++tx)
+            {
+                const std::size_t t =
+                    static_cast<std::size_t>(ty) * tiles_x_ + tx;
+                read(image, t, *data);
+                // Unchanged tiles stay shared
+                if (*data == *step[t])
+                    continue;
+                step[t] = std::move(data);
+                data = std::make_shared<std::vector<unsigned char>>();
+                changed_any = true;
+            }
+        }
+    }
+    // An edit that changed nothing is not a step
+    if (!changed_any)
+        return;
+    steps_.resize(current_ + 1);
+    steps_.push_back(std::move(step));
+    current_ = steps_.size() - 1;
+    if (steps_.size() > max_steps_)
+    {
+        steps_.erase(steps_.begin());
+        --current_;
+    }
+}
+
+void ImageHistory::commit(const Image& image)
+{
+    commit(image, { 0, 0, width_, height_ });
+}
+
+void ImageHistory::restore(Image& image, const Tile& rect) const
+{
+    if (steps_.empty())
+        return;
+    const Tile clipped = intersection(rect, { 0, 0, width_, height_ });
+    if (clipped.empty())
+        return;
+    for (int ty = clipped.y0 / kTileSize; ty <= (clipped.y1 - 1) / kTileSize;
+         ++ty)
+    {
+        for (int tx = clipped.x0 / kTileSize;
+             tx <= (clipped.x1 - 1) / kTileSize;
+             ++tx)
+        {
+            const std::size_t t = static_cast<std::size_t>(ty) * tiles_x_ + tx;
+            write(
+                image,
+                t,
+                *steps_[current_][t],
+                intersection(clipped, tile_rect(t)));
+        }
+    }
+    image.mark_dirty(clipped);
+}
+
+bool ImageHistory::can_undo() const
+{
+    return current_ > 0;
+}
+
+bool ImageHistory::can_redo() const
+{
+    return current_ + 1 < steps_.size();
+}
+
+bool ImageHistory::undo(Image& image)
+{
+    if (!can_undo())
+        return false;
+    go_to(image, current_ - 1);
+    return true;
+}
+
+bool ImageHistory::redo(Image& image)
+{
+    if (!can_redo())
+        return false;
+    go_to(image, current_ + 1);
+    return true;
+}
+
+void ImageHistory::go_to(Image& image, std::size_t step)
+{
+    if (step >= steps_.size() || step == current_)
+        return;
+    const Step& from = steps_[current_];
+    const Step& to = steps_[step];
+    for (std::size_t t = 0; t < to.size(); ++t)
+    {
+        if (to[t] == from[t])
+            continue;
+        write(image, t, *to[t], tile_rect(t));
+        image.mark_dirty(tile_rect(t));
+    }
+    current_ = step;
+}
+
+std::size_t ImageHistory::step() const
+{
+    return current_;
+}
+
+std::size_t ImageHistory::num_steps() const
+{
+    return steps_.size();
+}
+
+void ImageHistory::set_max_steps(std::size_t max_steps)
+{
+    max_steps_ = std::max<std::size_t>(max_steps, 1);
+    while (steps_.size() > max_steps_ && current_ > 0)
+    {
+        steps_.erase(steps_.begin());
+        --current_;
+    }
+    if (steps_.size() > max_steps_)
+        steps_.resize(max_steps_);
+}
+
+std::size_t ImageHistory::memory() const
+{
+    std::unordered_set<const std::vector<unsigned char>*> seen;
+    std::size_t bytes = 0;
+    for (const Step& step : steps_)
+        for (const TileData& data : step)
+            if (seen.insert(data.get()).second)
+                bytes += data->size();
+    return bytes;
+}
+
+Tile ImageHistory::tile_rect(std::size_t t) const
+{
+    const int x0 = static_cast<int>(t % tiles_x_) * kTileSize;
+    const int y0 = static_cast<int>(t / tiles_x_) * kTileSize;
+    return { x0,
+             y0,
+             std::min(x0 + kTileSize, width_),
+             std::min(y0 + kTileSize, height_) };
+}
+
+void ImageHistory::read(
+    const Image& image,
+    std::size_t t,
+    std::vector<unsigned char>& data) const
+{
+    // Rows of the tile, plane after plane
+    const Tile rect = tile_rect(t);
+    const std::size_t run = run_length(image, rect);
+    const int planes = num_planes(image);
+    data.resize(run * rect.height() * planes);
+    unsigned char* out = data.data();
+    for (int p = 0; p < planes; ++p)
+    {
+        const std::size_t plane = p * image.channel_stride();
+        for (int y = rect.y0; y < rect.y1; ++y, out += run)
+        {
+            const unsigned char* row = image.pixel_unchecked(rect.x0, y);
+            std::copy(row + plane, row + plane + run, out);
+        }
+    }
+}
+
+void ImageHistory::write(
+    Image& image,
+    std::size_t t,
+    const std::vector<unsigned char>& data,
+    const Tile& rect) const
+{
+    const Tile tile = tile_rect(t);
+    const std::size_t tile_run = run_length(image, tile);
+    const std::size_t run = run_length(image, rect);
+    const std::size_t skip = (rect.x0 - tile.x0) * image.pixel_stride();
+    const int planes = num_planes(image);
+    for (int p = 0; p < planes; ++p)
+    {
+        const std::size_t plane = p * image.channel_stride();
+        const unsigned char* in =
+            data.data() +
+            (static_cast<std::size_t>(p) * tile.height() + rect.y0 - tile.y0) *
+                tile_run +
+            skip;
+        for (int y = rect.y0; y < rect.y1; ++y, in += tile_run)
+            std::copy(in, in + run, image.pixel_unchecked(rect.x0, y) + plane);
+    }
+}
+}  // namespace USTC_CG
@@ -0,0 +1,284 @@
+#include "common/image_io.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdio>
+#include <vector>
+
+#include "common/tile_scheduler.h"
+#include "common/tiled_image.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+
+namespace USTC_CG
+{
+namespace
+{
+std::string lower_extension(const std::string& filename)
+{
+    auto dot = filename.find_last_of('.');
+    if (dot == std::string::npos)
+        return "";
+    std::string ext = filename.substr(dot + 1);
+    std::transform(
+        ext.begin(),
+        ext.end(),
+        ext.begin(),
+        [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return ext;
+}
+
+// stb reads the file through these, which lets the progress follow it
+struct ReadContext
+{
+    std::FILE* file = nullptr;
+    long size = 0;
+    long done = 0;
+    const IoProgress* progress = nullptr;
+};
+
+int read_file(void* user, char* data, int size)
+{
+    auto* context = static_cast<ReadContext*>(user);
+    const int read = static_cast<int>(std::fread(data, 1, size, context->file));
+    context->done += read;
+    if (*context->progress && context->size > 0)
+        (*context->progress)(
+            std::min(1.0f, static_cast<float>(context->done) / context->size));
+    return read;
+}
+
+void skip_file(void* user, int n)
+{
+    auto* context = static_cast<ReadContext*>(user);
+    std::fseek(context->file, n, SEEK_CUR);
+    context->done += n;
+}
+
+int end_of_file(void* user)
+{
+    return std::feof(static_cast<ReadContext*>(user)->file);
+}
+
+void append_bytes(void* context, void* data, int size)
+{
+    auto* out = static_cast<std::vector<unsigned char>*>(context);
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    out->insert(out->end(), bytes, bytes + size);
+}
+
+int read_u16(const std::vector<unsigned char>& bytes, std::size_t at)
+{
+    return (bytes[at] << 8) | bytes[at + 1];
+}
+
+// Encode an interleaved image as a JPEG by strips (see save_image). stb
+// encodes each strip as a full JPEG, whose DC predictors start from zero
+// and whose scan ends byte-aligned and padded with ones: exactly a restart
+// interval. The headers of the first strip, with the full height and a DRI
+// segment, then the scans separated by RSTn markers make the whole image.
+bool write_jpg_strips(
+    const Image& image,
+    const std::string& filename,
+    int quality,
+    const IoProgress& progress)
+{
+    const int width = image.width(), height = image.height();
+    const int channels = image.channels();
+    // stb subsamples the chroma (16 x 16 MCUs) at quality 90 and below
+    const int mcu = (quality ? quality : 90) <= 90 ? 16 : 8;
+    const int mcus_x = (width + mcu - 1) / mcu;
+    // Strips of whole MCU rows, within the 16-bit restart interval, about
+    // four per thread
+    const int max_rows = 65535 / mcus_x;
+    const int threads = TileScheduler::instance().num_threads();
+    int strip_rows = (height + mcu - 1) / mcu / (4 * threads);
+    strip_rows = std::clamp(strip_rows, 1, std::max(max_rows, 1));
+    const int strip_height = strip_rows * mcu;
+    const int strips = (height + strip_height - 1) / strip_height;
+    if (max_rows < 1 || strips < 2)
+    {
+        const bool ok = stbi_write_jpg(
+                            filename.c_str(),
+                            width,
+                            height,
+                            channels,
+                            image.data(),
+                            quality) != 0;
+        if (progress)
+            progress(1.0f);
+        return ok;
+    }
+
+    std::vector<std::vector<unsigned char>> encoded(strips);
+    std::atomic<int> finished = 0;
+    std::atomic<bool> ok = true;
+    TileScheduler::instance().parallel_for(
+        strips,
+        [&](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t s = begin; s < end; ++s)
+            {
+                const int y0 = static_cast<int>(s) * strip_height;
+                const int rows = std::min(strip_height, height - y0);
+                if (!stbi_write_jpg_to_func(
+                        append_bytes,
+                        &encoded[s],
+                        width,
+                        rows,
+                        channels,
+                        image.pixel_unchecked(0, y0),
+                        quality))
+                    ok = false;
+                if (progress)
+                    progress(static_cast<float>(++finished) / strips);
+            }
+        },
+        1);
+    if (!ok)
+        return false;
+
+    // Headers of the first strip: segments up to the start of scan
+    const std::vector<unsigned char>& first = encoded[0];
+    std::size_t sof = 0, sos = 2;
+    while (sos + 4 <= first.size() && first[sos + 1] != 0xDA)
+    {
+        if (first[sos + 1] == 0xC0)
+            sof = sos;
+        sos += 2 + read_u16(first, sos + 2);
+    }
+    if (sof == 0 || sos + 4 > first.size())
+        return false;
+    const std::size_t scan = sos + 2 + read_u16(first, sos + 2);
+
+    std::FILE* file = std::fopen(filename.c_str(), "wb");
+    if (file == nullptr)
+        return false;
+    std::vector<unsigned char> header(first.begin(), first.begin() + sos);
+    header[sof + 5] = static_cast<unsigned char>(height >> 8);
+    header[sof + 6] = static_cast<unsigned char>(height);
+    const int interval = mcus_x * strip_rows;
+    const unsigned char dri[] = { 0xFF,
+                                  0xDD,
+                                  0,
+                                  4,
+                                  static_cast<unsigned char>(interval >> 8),
+                                  static_cast<unsigned char>(interval) };
+    header.insert(header.end(), dri, dri + sizeof(dri));
+    header.insert(header.end(), first.begin() + sos, first.begin() + scan);
+    bool written =
+        std::fwrite(header.data(), 1, header.size(), file) == header.size();
+    for (int s = 0; s < strips && written; ++s)
+    {
+        // The scan of the strip, without its headers and EOI
+        const std::vector<unsigned char>& bytes = encoded[s];
+        const std::size_t size = bytes.size() - scan - 2;
+        written = std::fwrite(bytes.data() + scan, 1, size, file) == size;
+        const unsigned char marker[] = {
+            0xFF,
+            static_cast<unsigned char>(s + 1 < strips ? 0xD0 + s % 8 : 0xD9)
+        };
+        written = written && std::fwrite(marker, 1, 2, file) == 2;
+    }
+    return std::fclose(file) == 0 && written;
+}
+}  // namespace
+
+bool is_tiled_image(const std::string& filename)
+{
+    return lower_extension(filename) == "uti";
+}
+
+std::shared_ptr<Image> load_image(
+    const std::string& filename,
+    int channels,
+    const IoProgress& progress)
+{
+    if (is_tiled_image(filename))
+    {
+        TiledImage tiled;
+        if (!tiled.open(filename) || tiled.channels() != channels)
+            return nullptr;
+        auto image = std::make_shared<Image>(
+            tiled.read({ 0, 0, tiled.width(), tiled.height() }));
+        if (progress)
+            progress(1.0f);
+        return image;
+    }
+    ReadContext context;
+    context.file = std::fopen(filename.c_str(), "rb");
+    if (context.file == nullptr)
+        return nullptr;
+    std::fseek(context.file, 0, SEEK_END);
+    context.size = std::ftell(context.file);
+    std::fseek(context.file, 0, SEEK_SET);
+    context.progress = &progress;
+    const stbi_io_callbacks callbacks = { read_file, skip_file, end_of_file };
+    int width = 0, height = 0;
+    unsigned char* image_data = stbi_load_from_callbacks(
+        &callbacks, &context, &width, &height, nullptr, channels);
+    std::fclose(context.file);
+    if (image_data == nullptr)
+        return nullptr;
+    // stbi_load allocates with malloc; copy into the Image-owned buffer so
+    // the deleter of the unique_ptr matches.
+    auto pixels = std::make_unique<unsigned char[]>(
+        static_cast<std::size_t>(width) * height * channels);
+    std::copy(
+        image_data,
+        image_data + static_cast<std::size_t>(width) * height * channels,
+        pixels.get());
+    stbi_image_free(image_data);
+    return std::make_shared<Image>(width, height, channels, std::move(pixels));
+}
+
+bool save_image(
+    const Image& image,
+    const std::string& filename,
+    int jpg_quality,
+    const IoProgress& progress)
+{
+    if (image.data() == nullptr)
+        return false;
+    const std::string ext = lower_extension(filename);
+    if (ext == "uti")
+    {
+        TiledImage tiled;
+        const bool ok =
+            tiled.create(
+                filename, image.width(), image.height(), image.channels()) &&
+            tiled.write(image, 0, 0);
+        if (progress)
+            progress(1.0f);
+        return ok;
+    }
+    // stb expects interleaved pixels
+    Image interleaved;
+    const Image* source = &image;
+    if (image.layout() != Image::kInterleaved)
+    {
+        interleaved = image;
+        interleaved.convert_layout(Image::kInterleaved);
+        source = &interleaved;
+    }
+    if (ext == "jpg" || ext == "jpeg")
+        return write_jpg_strips(*source, filename, jpg_quality, progress);
+    const char* name = filename.c_str();
+    const int w = source->width(), h = source->height();
+    const int c = source->channels();
+    int ok = 0;
+    if (ext == "bmp")
+        ok = stbi_write_bmp(name, w, h, c, source->data());
+    else if (ext == "tga")
+        ok = stbi_write_tga(name, w, h, c, source->data());
+    else
+        ok = stbi_write_png(name, w, h, c, source->data(), w * c);
+    if (progress)
+        progress(1.0f);
+    return ok != 0;
+}
+}  // namespace USTC_CG
@@ -0,0 +1,536 @@
+#include "common/image_ops.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || \
+    defined(_M_IX86)
+#define USTC_CG_IMAGE_OPS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+// MSVC exposes every intrinsic without per-function target flags.
+#define USTC_CG_TARGET_AVX2
+#else
+#define USTC_CG_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace USTC_CG
+{
+namespace image_ops
+{
+namespace
+{
+using uchar = unsigned char;
+
+std::atomic<int> current_level{ -1 };
+
+SimdLevel active_level()
+{
+    int level = current_level.load(std::memory_order_relaxed);
+    if (level < 0)
+    {
+        level = detect_simd_level();
+        current_level.store(level, std::memory_order_relaxed);
+    }
+    return static_cast<SimdLevel>(level);
+}
+
+bool is_rgba(const Image& image)
+{
+    return image.channels() == 4 && image.layout() == Image::kInterleaved;
+}
+
+// Number of leading channels that carry color (alpha is the 4th channel).
+int color_channels(const Image& image)
+{
+    return std::min(image.channels(), 3);
+}
+
+std::uint32_t load_u32(const uchar* p)
+{
+    std::uint32_t v;
+    std::memcpy(&v, p, 4);
+    return v;
+}
+
+void store_u32(uchar* p, std::uint32_t v)
+{
+    std::memcpy(p, &v, 4);
+}
+
+// XOR mask applied to every 4 bytes of interleaved data by invert(): all
+// ones, except for the alpha byte of RGBA pixels.
+std::uint32_t invert_mask(const Image& image)
+{
+    if (image.channels() != 4)
+        return 0xFFFFFFFFu;
+    const uchar bytes[4] = { 0xFF, 0xFF, 0xFF, 0x00 };
+    return load_u32(bytes);
+}
+
+uchar luminance(int r, int g, int b)
+{
+    return static_cast<uchar>((77 * r + 150 * g + 29 * b + 128) >> 8);
+}
+
+// ---------------------------------------------------------------------------
+// Scalar kernels (any channel count and layout)
+// ---------------------------------------------------------------------------
+
+void invert_bytes_scalar(uchar* data, std::size_t n, std::uint32_t mask)
+{
+    // `mask` repeats every 4 bytes; for non-RGBA data it is all ones.
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        store_u32(data + i, load_u32(data + i) ^ mask);
+    for (; i < n; ++i)
+        data[i] = static_cast<uchar>(data[i] ^ 0xFF);
+}
+
+void invert_scalar(Image& image)
+{
+    if (image.layout() == Image::kPlanar)
+    {
+        for (int c = 0; c < color_channels(image); ++c)
+        {
+            auto plane = image.plane(c);
+            invert_bytes_scalar(plane.data(), plane.size(), 0xFFFFFFFFu);
+        }
+        return;
+    }
+    invert_bytes_scalar(image.data(), image.size(), invert_mask(image));
+}
+
+void reverse_row_scalar(uchar* row, int width, int pixel_bytes)
+{
+    for (int i = 0, j = width - 1; i < j; ++i, --j)
+        std::swap_ranges(
+            row + i * pixel_bytes,
+            row + (i + 1) * pixel_bytes,
+            row + j * pixel_bytes);
+}
+
+void reverse_row_rgba_scalar(uchar* row, int begin, int end)
+{
+    // Reverse the pixels in [begin, end).
+    for (int i = begin, j = end - 1; i < j; ++i, --j)
+    {
+        std::uint32_t a = load_u32(row + 4 * i);
+        store_u32(row + 4 * i, load_u32(row + 4 * j));
+        store_u32(row + 4 * j, a);
+    }
+}
+
+void swap_rows(uchar* a, uchar* b, std::size_t n)
+{
+    // std::swap_ranges over bytes is vectorized by every mainstream compiler.
+    std::swap_ranges(a, a + n, b);
+}
+
+void mirror_vertical(Image& image)
+{
+    const int height = image.height();
+    if (image.layout() == Image::kPlanar)
+    {
+        for (int c = 0; c < image.channels(); ++c)
+            for (int y = 0; y < height / 2; ++y)
+                swap_rows(
+                    image.plane_row(c, y).data(),
+                    image.plane_row(c, height - 1 - y).data(),
+                    image.row_stride());
+        return;
+    }
+    for (int y = 0; y < height / 2; ++y)
+        swap_rows(
+            image.row(y).data(),
+            image.row(height - 1 - y).data(),
+            image.row_stride());
+}
+
+void mirror_horizontal_scalar(Image& image)
+{
+    if (image.layout() == Image::kPlanar)
+    {
+        for (int c = 0; c < image.channels(); ++c)
+            for (int y = 0; y < image.height(); ++y)
+                std::reverse(
+                    image.plane_row(c, y).begin(), image.plane_row(c, y).end());
+        return;
+    }
+    for (int y = 0; y < image.height(); ++y)
+    {
+        if (image.channels() == 4)
+            reverse_row_rgba_scalar(image.row(y).data(), 0, image.width());
+        else
+            reverse_row_scalar(
+                image.row(y).data(), image.width(), image.channels());
+    }
+}
+
+void gray_scale_rgba_scalar(uchar* p, std::size_t pixels)
+{
+    for (std::size_t i = 0; i < pixels; ++i, p += 4)
+    {
+        uchar y = luminance(p[0], p[1], p[2]);
+        p[0] = p[1] = p[2] = y;
+    }
+}
+
+void gray_scale_scalar(Image& image)
+{
+    if (image.channels() < 3)
+        return;
+    const std::size_t pixels =
+        static_cast<std::size_t>(image.width()) * image.height();
+    if (image.layout() == Image::kPlanar)
+    {
+        uchar* r = image.plane(0).data();
+        uchar* g = image.plane(1).data();
+        uchar* b = image.plane(2).data();
+        for (std::size_t i = 0; i < pixels; ++i)
+            r[i] = luminance(r[i], g[i], b[i]);
+        std::memcpy(g, r, pixels);
+        std::memcpy(b, r, pixels);
+        return;
+    }
+    if (image.channels() == 4)
+    {
+        gray_scale_rgba_scalar(image.data(), pixels);
+        return;
+    }
+    const int channels = image.channels();
+    uchar* p = image.data();
+    for (std::size_t i = 0; i < pixels; ++i, p += channels)
+    {
+        uchar y = luminance(p[0], p[1], p[2]);
+        p[0] = p[1] = p[2] = y;
+    }
+}
+
+void swizzle_scalar(Image& image, const std::array<int, 4>& order)
+{
+    const int channels = image.channels();
+    if (image.layout() == Image::kPlanar)
+    {
+        // Permuting planes is a matter of moving whole planes around.
+        Image copy(image);
+        for (int c = 0; c < channels; ++c)
+            std::copy(
+                copy.plane(order[c]).begin(),
+                copy.plane(order[c]).end(),
+                image.plane(c).begin());
+        return;
+    }
+    const std::size_t pixels =
+        static_cast<std::size_t>(image.width()) * image.height();
+    uchar* p = image.data();
+    uchar tmp[4];
+    for (std::size_t i = 0; i < pixels; ++i, p += channels)
+    {
+        for (int c = 0; c < channels; ++c)
+            tmp[c] = p[order[c]];
+        for (int c = 0; c < channels; ++c)
+            p[c] = tmp[c];
+    }
+}
+
+#ifdef USTC_CG_IMAGE_OPS_X86
+// ---------------------------------------------------------------------------
+// SSE2 kernels (interleaved RGBA)
+// ---------------------------------------------------------------------------
+
+void invert_sse2(uchar* data, std::size_t n, std::uint32_t mask)
+{
+    const __m128i m = _mm_set1_epi32(static_cast<int>(mask));
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        _mm_storeu_si128(
+            reinterpret_cast<__m128i*>(data + i), _mm_xor_si128(v, m));
+    }
+    invert_bytes_scalar(data + i, n - i, mask);
+}
+
+void reverse_row_rgba_sse2(uchar* row, int width)
+{
+    int i = 0, j = width - 4;
+    for (; i + 4 <= j; i += 4, j -= 4)
+    {
+        __m128i* pi = reinterpret_cast<__m128i*>(row + 4 * i);
+        __m128i* pj = reinterpret_cast<__m128i*>(row + 4 * j);
+        __m128i a = _mm_shuffle_epi32(_mm_loadu_si128(pi), 0x1B);
+        __m128i b = _mm_shuffle_epi32(_mm_loadu_si128(pj), 0x1B);
+        _mm_storeu_si128(pi, b);
+        _mm_storeu_si128(pj, a);
+    }
+    reverse_row_rgba_scalar(row, i, j + 4);
+}
+
+// Luminance of 4 RGBA pixels as 32-bit lanes.
+__m128i luminance4_sse2(__m128i v)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i weights = _mm_setr_epi16(77, 150, 29, 0, 77, 150, 29, 0);
+    __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(v, zero), weights);
+    __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(v, zero), weights);
+    // (r*77 + g*150) + (b*29) for each pixel, in lanes 0 and 2
+    lo = _mm_add_epi32(lo, _mm_shuffle_epi32(lo, _MM_SHUFFLE(2, 3, 0, 1)));
+    hi = _mm_add_epi32(hi, _mm_shuffle_epi32(hi, _MM_SHUFFLE(2, 3, 0, 1)));
+    __m128i y = _mm_castps_si128(_mm_shuffle_ps(
+        _mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(2, 0, 2, 0)));
+    return _mm_srli_epi32(_mm_add_epi32(y, _mm_set1_epi32(128)), 8);
+}
+
+void gray_scale_rgba_sse2(uchar* p, std::size_t pixels)
+{
+    const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+    std::size_t i = 0;
+    for (; i + 4 <= pixels; i += 4, p += 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i y = luminance4_sse2(v);
+        __m128i yyy = _mm_or_si128(
+            _mm_or_si128(y, _mm_slli_epi32(y, 8)), _mm_slli_epi32(y, 16));
+        _mm_storeu_si128(
+            reinterpret_cast<__m128i*>(p),
+            _mm_or_si128(yyy, _mm_and_si128(v, alpha)));
+    }
+    gray_scale_rgba_scalar(p, pixels - i);
+}
+
+// ---------------------------------------------------------------------------
+// AVX2 kernels (interleaved RGBA)
+// ---------------------------------------------------------------------------
+
+USTC_CG_TARGET_AVX2 void
+invert_avx2(uchar* data, std::size_t n, std::uint32_t mask)
+{
+    const __m256i m = _mm256_set1_epi32(static_cast<int>(mask));
+    std::size_t i = 0;
+    for (; i + 32 <= n; i += 32)
+    {
+        __m256i v =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        _mm256_storeu_si256(
+            reinterpret_cast<__m256i*>(data + i), _mm256_xor_si256(v, m));
+    }
+    invert_bytes_scalar(data + i, n - i, mask);
+}
+
+USTC_CG_TARGET_AVX2 void reverse_row_rgba_avx2(uchar* row, int width)
+{
+    const __m256i reverse = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+    int i = 0, j = width - 8;
+    for (; i + 8 <= j; i += 8, j -= 8)
+    {
+        __m256i* pi = reinterpret_cast<__m256i*>(row + 4 * i);
+        __m256i* pj = reinterpret_cast<__m256i*>(row + 4 * j);
+        __m256i a =
+            _mm256_permutevar8x32_epi32(_mm256_loadu_si256(pi), reverse);
+        __m256i b =
+            _mm256_permutevar8x32_epi32(_mm256_loadu_si256(pj), reverse);
+        _mm256_storeu_si256(pi, b);
+        _mm256_storeu_si256(pj, a);
+    }
+    reverse_row_rgba_scalar(row, i, j + 8);
+}
+
+USTC_CG_TARGET_AVX2 void gray_scale_rgba_avx2(uchar* p, std::size_t pixels)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i weights = _mm256_setr_epi16(
+        77, 150, 29, 0, 77, 150, 29, 0, 77, 150, 29, 0, 77, 150, 29, 0);
+    const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+    const __m256i round = _mm256_set1_epi32(128);
+    std::size_t i = 0;
+    for (; i + 8 <= pixels; i += 8, p += 32)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        // unpack works per 128-bit lane, the final shuffle restores order
+        __m256i lo = _mm256_madd_epi16(_mm256_unpacklo_epi8(v, zero), weights);
+        __m256i hi = _mm256_madd_epi16(_mm256_unpackhi_epi8(v, zero), weights);
+        lo = _mm256_add_epi32(
+            lo, _mm256_shuffle_epi32(lo, _MM_SHUFFLE(2, 3, 0, 1)));
+        hi = _mm256_add_epi32(
+            hi, _mm256_shuffle_epi32(hi, _MM_SHUFFLE(2, 3, 0, 1)));
+        __m256i y = _mm256_castps_si256(_mm256_shuffle_ps(
+            _mm256_castsi256_ps(lo),
+            _mm256_castsi256_ps(hi),
+            _MM_SHUFFLE(2, 0, 2, 0)));
+        y = _mm256_srli_epi32(_mm256_add_epi32(y, round), 8);
+        __m256i yyy = _mm256_or_si256(
+            _mm256_or_si256(y, _mm256_slli_epi32(y, 8)),
+            _mm256_slli_epi32(y, 16));
+        _mm256_storeu_si256(
+            reinterpret_cast<__m256i*>(p),
+            _mm256_or_si256(yyy, _mm256_and_si256(v, alpha)));
+    }
+    gray_scale_rgba_scalar(p, pixels - i);
+}
+
+USTC_CG_TARGET_AVX2 void
+swizzle_rgba_avx2(uchar* p, std::size_t pixels, const std::array<int, 4>& order)
+{
+    alignas(32) char indices[32];
+    for (int i = 0; i < 32; ++i)
+        indices[i] = static_cast<char>((i & ~3) + order[i & 3]);
+    const __m256i shuffle =
+        _mm256_load_si256(reinterpret_cast<const __m256i*>(indices));
+    std::size_t i = 0;
+    for (; i + 8 <= pixels; i += 8, p += 32)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        _mm256_storeu_si256(
+            reinterpret_cast<__m256i*>(p), _mm256_shuffle_epi8(v, shuffle));
+    }
+    for (; i < pixels; ++i, p += 4)
+    {
+        uchar tmp[4] = { p[order[0]], p[order[1]], p[order[2]], p[order[3]] };
+        std::memcpy(p, tmp, 4);
+    }
+}
+#endif  // USTC_CG_IMAGE_OPS_X86
+}  // namespace
+
+SimdLevel detect_simd_level()
+{
+#ifdef USTC_CG_IMAGE_OPS_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] >= 7)
+    {
+        __cpuidex(info, 7, 0);
+        bool avx2 = (info[1] & (1 << 5)) != 0;
+        __cpuid(info, 1);
+        // AVX2 also needs the OS to save the YMM registers (OSXSAVE + XCR0).
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        if (avx2 && osxsave && (_xgetbv(0) & 0x6) == 0x6)
+            return kAVX2;
+    }
+    return kSSE2;
+#else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return kAVX2;
+    if (__builtin_cpu_supports("sse2"))
+        return kSSE2;
+    return kScalar;
+#endif
+#else
+    return kScalar;
+#endif
+}
+
+SimdLevel simd_level()
+{
+    return active_level();
+}
+
+void set_simd_level(SimdLevel level)
+{
+    level = std::min(level, detect_simd_level());
+    current_level.store(level, std::memory_order_relaxed);
+}
+
+const char* simd_level_name(SimdLevel level)
+{
+    switch (level)
+    {
+        case kScalar: return "scalar";
+        case kSSE2: return "SSE2";
+        case kAVX2: return "AVX2";
+        default: return "unknown";
+    }
+}
+
+void invert(Image& image)
+{
+    if (!image.data())
+        return;
+#ifdef USTC_CG_IMAGE_OPS_X86
+    if (image.layout() == Image::kInterleaved && active_level() != kScalar)
+    {
+        const std::uint32_t mask = invert_mask(image);
+        if (active_level() == kAVX2)
+            invert_avx2(image.data(), image.size(), mask);
+        else
+            invert_sse2(image.data(), image.size(), mask);
+        return;
+    }
+#endif
+    invert_scalar(image);
+}
+
+void mirror(Image& image, bool is_horizontal, bool is_vertical)
+{
+    if (!image.data())
+        return;
+    if (is_vertical)
+        mirror_vertical(image);
+    if (!is_horizontal)
+        return;
+#ifdef USTC_CG_IMAGE_OPS_X86
+    if (is_rgba(image) && active_level() != kScalar)
+    {
+        for (int y = 0; y < image.height(); ++y)
+        {
+            if (active_level() == kAVX2)
+                reverse_row_rgba_avx2(image.row(y).data(), image.width());
+            else
+                reverse_row_rgba_sse2(image.row(y).data(), image.width());
+        }
+        return;
+    }
+#endif
+    mirror_horizontal_scalar(image);
+}
+
+void gray_scale(Image& image)
+{
+    if (!image.data())
+        return;
+#ifdef USTC_CG_IMAGE_OPS_X86
+    if (is_rgba(image) && active_level() != kScalar)
+    {
+        const std::size_t pixels =
+            static_cast<std::size_t>(image.width()) * image.height();
+        if (active_level() == kAVX2)
+            gray_scale_rgba_avx2(image.data(), pixels);
+        else
+            gray_scale_rgba_sse2(image.data(), pixels);
+        return;
+    }
+#endif
+    gray_scale_scalar(image);
+}
+
+void swizzle(Image& image, const std::array<int, 4>& order)
+{
+    if (!image.data())
+        return;
+    for (int c = 0; c < image.channels(); ++c)
+    {
+        if (order[c] < 0 || order[c] >= image.channels())
+            throw std::invalid_argument("Swizzle index out of range");
+    }
+#ifdef USTC_CG_IMAGE_OPS_X86
+    // SSE2 has no byte shuffle, so only the AVX2 level gets a vector path.
+    if (is_rgba(image) && active_level() == kAVX2)
+    {
+        swizzle_rgba_avx2(
+            image.data(),
+            static_cast<std::size_t>(image.width()) * image.height(),
+            order);
+        return;
+    }
+#endif
+    swizzle_scalar(image, order);
+}
+}  // namespace image_ops
+}  // namespace USTC_CG
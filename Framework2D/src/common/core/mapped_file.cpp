@@ -0,0 +1,153 @@
+#include "common/mapped_file.h"
+
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace USTC_CG
+{
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+    swap(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other)
+    {
+        close();
+        swap(other);
+    }
+    return *this;
+}
+
+void MappedFile::swap(MappedFile& other) noexcept
+{
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+    std::swap(writable_, other.writable_);
+    std::swap(file_, other.file_);
+#ifdef _WIN32
+    std::swap(mapping_, other.mapping_);
+#endif
+}
+
+#ifdef _WIN32
+bool MappedFile::open(const std::string& filename, bool writable)
+{
+    close();
+    file_ = CreateFileA(
+        filename.c_str(),
+        writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+        FILE_SHARE_READ,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        nullptr);
+    if (file_ == INVALID_HANDLE_VALUE)
+    {
+        file_ = nullptr;
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file_, &size) || size.QuadPart == 0)
+    {
+        close();
+        return false;
+    }
+    mapping_ = CreateFileMappingA(
+        file_,
+        nullptr,
+        writable ? PAGE_READWRITE : PAGE_READONLY,
+        0,
+        0,
+        nullptr);
+    if (mapping_ != nullptr)
+        data_ = static_cast<unsigned char*>(MapViewOfFile(
+            mapping_,
+            writable ? FILE_MAP_WRITE : FILE_MAP_READ,
+            0,
+            0,
+            0));
+    if (data_ == nullptr)
+    {
+        close();
+        return false;
+    }
+    size_ = static_cast<std::size_t>(size.QuadPart);
+    writable_ = writable;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (data_ != nullptr)
+        UnmapViewOfFile(data_);
+    if (mapping_ != nullptr)
+        CloseHandle(mapping_);
+    if (file_ != nullptr)
+        CloseHandle(file_);
+    data_ = nullptr;
+    mapping_ = file_ = nullptr;
+    size_ = 0;
+    writable_ = false;
+}
+#else
+bool MappedFile::open(const std::string& filename, bool writable)
+{
+    close();
+    file_ = ::open(filename.c_str(), writable ? O_RDWR : O_RDONLY);
+    if (file_ < 0)
+        return false;
+    struct stat status;
+    if (fstat(file_, &status) != 0 || status.st_size == 0)
+    {
+        close();
+        return false;
+    }
+    void* data = mmap(
+        nullptr,
+        static_cast<std::size_t>(status.st_size),
+        writable ? PROT_READ | PROT_WRITE : PROT_READ,
+        MAP_SHARED,
+        file_,
+        0);
+    if (data == MAP_FAILED)
+    {
+        close();
+        return false;
+    }
+    data_ = static_cast<unsigned char*>(data);
+    size_ = static_cast<std::size_t>(status.st_size);
+    writable_ = writable;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (data_ != nullptr)
+        munmap(data_, size_);
+    if (file_ >= 0)
+        ::close(file_);
+    data_ = nullptr;
+    file_ = -1;
+    size_ = 0;
+    writable_ = false;
+}
+#endif
+}  // namespace USTC_CG
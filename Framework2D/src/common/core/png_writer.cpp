@@ -0,0 +1,186 @@
+#include "common/png_writer.h"
+
+#include <algorithm>
+#include <array>
+
+namespace USTC_CG
+{
+namespace
+{
+// Largest stored deflate block
+constexpr std::size_t kBlockSize = 65535;
+
+std::uint32_t crc32(
+    std::uint32_t crc,
+    const unsigned char* data,
+    std::size_t size)
+{
+    static const std::array<std::uint32_t, 256> table = []
+    {
+        std::array<std::uint32_t, 256> table{};
+        for (std::uint32_t n = 0; n < 256; ++n)
+        {
+            std::uint32_t c = n;
+            for (int k = 0; k < 8; ++k)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[n] = c;
+        }
+        return table;
+    }();
+    for (std::size_t i = 0; i < size; ++i)
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+void put_u32(unsigned char* out, std::uint32_t value)
+{
+    out[0] = static_cast<unsigned char>(value >> 24);
+    out[1] = static_cast<unsigned char>(value >> 16);
+    out[2] = static_cast<unsigned char>(value >> 8);
+    out[3] = static_cast<unsigned char>(value);
+}
+}  // namespace
+
+PngWriter::~PngWriter()
+{
+    close();
+}
+
+bool PngWriter::open(
+    const std::string& filename,
+    int width,
+    int height,
+    int channels)
+{
+    close();
+    static const unsigned char kColorType[] = { 0, 4, 2, 6 };
+    if (width <= 0 || height <= 0 || channels < 1 || channels > 4)
+        return false;
+    file_ = std::fopen(filename.c_str(), "wb");
+    if (file_ == nullptr)
+        return false;
+    ok_ = true;
+    row_size_ = static_cast<std::size_t>(width) * channels;
+    height_ = height;
+    rows_ = 0;
+    remaining_ = static_cast<std::uint64_t>(height) * (row_size_ + 1);
+    block_.clear();
+    block_.reserve(kBlockSize);
+    first_block_ = true;
+    adler_a_ = 1;
+    adler_b_ = 0;
+
+    static const unsigned char kSignature[] = { 0x89, 'P',  'N',  'G',
+                                                '\r', '\n', 0x1A, '\n' };
+    ok_ = std::fwrite(kSignature, 1, sizeof(kSignature), file_) ==
+          sizeof(kSignature);
+    unsigned char header[13];
+    put_u32(header, static_cast<std::uint32_t>(width));
+    put_u32(header + 4, static_cast<std::uint32_t>(height));
+    header[8] = 8;  // bits per channel
+    header[9] = kColorType[channels - 1];
+    header[10] = header[11] = header[12] = 0;
+    write_chunk("IHDR", header, sizeof(header));
+    return ok_;
+}
+
+bool PngWriter::write_rows(const unsigned char* rows, int count)
+{
+    if (file_ == nullptr || rows_ + count > height_)
+        return false;
+    for (int r = 0; r < count; ++r, ++rows_)
+    {
+        // Filter type 0 (none), then the row
+        block_.push_back(0);
+        --remaining_;
+        const unsigned char* row = rows + r * row_size_;
+        for (std::size_t done = 0; done < row_size_;)
+        {
+            if (block_.size() == kBlockSize)
+                flush_block();
+            const std::size_t n =
+                std::min(row_size_ - done, kBlockSize - block_.size());
+            block_.insert(block_.end(), row + done, row + done + n);
+            remaining_ -= n;
+            done += n;
+        }
+        if (block_.size() == kBlockSize && remaining_ > 0)
+            flush_block();
+    }
+    if (remaining_ == 0)
+        flush_block();
+    return ok_;
+}
+
+bool PngWriter::close()
+{
+    if (file_ == nullptr)
+        return false;
+    const bool complete = rows_ == height_;
+    if (complete)
+        write_chunk("IEND", nullptr, 0);
+    ok_ = std::fclose(file_) == 0 && ok_ && complete;
+    file_ = nullptr;
+    return ok_;
+}
+
+void PngWriter::flush_block()
+{
+    // Adler-32 of the uncompressed stream; the sums fit in 32 bits for
+    // blocks of up to 5552 bytes between reductions.
+    for (std::size_t i = 0; i < block_.size();)
+    {
+        const std::size_t end = std::min(block_.size(), i + 5552);
+        for (; i < end; ++i)
+        {
+            adler_a_ += block_[i];
+            adler_b_ += adler_a_;
+        }
+        adler_a_ %= 65521;
+        adler_b_ %= 65521;
+    }
+
+    std::vector<unsigned char> chunk;
+    chunk.reserve(block_.size() + 11);
+    if (first_block_)
+    {
+        // zlib header: deflate, 32K window, no dictionary
+        chunk.push_back(0x78);
+        chunk.push_back(0x01);
+        first_block_ = false;
+    }
+    const bool last = remaining_ == 0;
+    const auto size = static_cast<std::uint16_t>(block_.size());
+    chunk.push_back(last ? 1 : 0);  // BFINAL, BTYPE = stored
+    chunk.push_back(static_cast<unsigned char>(size));
+    chunk.push_back(static_cast<unsigned char>(size >> 8));
+    chunk.push_back(static_cast<unsigned char>(~size));
+    chunk.push_back(static_cast<unsigned char>(~size >> 8));
+    chunk.insert(chunk.end(), block_.begin(), block_.end());
+    if (last)
+    {
+        chunk.resize(chunk.size() + 4);
+        put_u32(chunk.data() + chunk.size() - 4, (adler_b_ << 16) | adler_a_);
+    }
+    write_chunk("IDAT", chunk.data(), chunk.size());
+    block_.clear();
+}
+
+void PngWriter::write_chunk(
+    const char* type,
+    const unsigned char* data,
+    std::size_t size)
+{
+    unsigned char head[8];
+    put_u32(head, static_cast<std::uint32_t>(size));
+    std::copy(type, type + 4, head + 4);
+    std::uint32_t crc = crc32(0xFFFFFFFFu, head + 4, 4);
+    if (size > 0)
+        crc = crc32(crc, data, size);
+    unsigned char tail[4];
+    put_u32(tail, crc ^ 0xFFFFFFFFu);
+    ok_ = ok_ && std::fwrite(head, 1, 8, file_) == 8 &&
+          (size == 0 || std::fwrite(data, 1, size, file_) == size) &&
+          std::fwrite(tail, 1, 4, file_) == 4;
+}
+}  // namespace USTC_CG
@@ -0,0 +1,210 @@
+#include "common/profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+
+namespace USTC_CG
+{
+namespace
+{
+// Small, stable thread numbers for the trace
+std::uint32_t thread_number()
+{
+    static std::atomic<std::uint32_t> next = 0;
+    thread_local const std::uint32_t number = next++;
+    return number;
+}
+
+double percentile(const std::vector<double>& sorted, double fraction)
+{
+    const std::size_t i = static_cast<std::size_t>(
+        fraction * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[std::min(i, sorted.size() - 1)];
+}
+
+// Zone names are ours, but escape them anyway
+std::string json_string(const std::string& text)
+{
+    std::string out = "\"";
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+            out += '\\';
+        if (static_cast<unsigned char>(c) >= 0x20)
+            out += c;
+    }
+    return out + "\"";
+}
+}  // namespace
+
+Profiler::Profiler() : epoch_(Clock::now())
+{
+}
+
+Profiler& Profiler::instance()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+void Profiler::set_enabled(bool enabled)
+{
+    enabled_ = enabled;
+}
+
+bool Profiler::enabled() const
+{
+    return enabled_;
+}
+
+int Profiler::zone(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = index_.find(name);
+    if (it != index_.end())
+        return it->second;
+    const int index = static_cast<int>(zones_.size());
+    zones_.push_back(std::make_unique<Zone>());
+    zones_.back()->name = name;
+    index_.emplace(name, index);
+    return index;
+}
+
+void Profiler::record(int zone, Clock::time_point start, Clock::time_point end)
+{
+    Zone& target = zone_at(zone);
+    Sample sample;
+    sample.start =
+        std::chrono::duration<double, std::micro>(start - epoch_).count();
+    sample.duration =
+        std::chrono::duration<double, std::micro>(end - start).count();
+    sample.thread = thread_number();
+    std::lock_guard<std::mutex> lock(target.mutex);
+    target.samples[target.count % kHistory] = sample;
+    ++target.count;
+}
+
+std::size_t Profiler::num_zones() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return zones_.size();
+}
+
+std::string Profiler::zone_name(int zone) const
+{
+    return zone_at(zone).name;
+}
+
+Profiler::Zone& Profiler::zone_at(int zone) const
+{
+    // Zones are never removed, only the vector holding them can move
+    std::lock_guard<std::mutex> lock(mutex_);
+    return *zones_[zone];
+}
+
+std::vector<Profiler::Sample> Profiler::samples(const Zone& zone) const
+{
+    std::lock_guard<std::mutex> lock(zone.mutex);
+    const std::size_t size = std::min(zone.count, kHistory);
+    std::vector<Sample> out(size);
+    // Oldest first
+    for (std::size_t i = 0; i < size; ++i)
+        out[i] = zone.samples[(zone.count - size + i) % kHistory];
+    return out;
+}
+
+Profiler::Stats Profiler::stats(int zone) const
+{
+    const std::vector<Sample> all = samples(zone_at(zone));
+    Stats stats;
+    stats.count = all.size();
+    if (all.empty())
+        return stats;
+    std::vector<double> sorted(all.size());
+    for (std::size_t i = 0; i < all.size(); ++i)
+    {
+        sorted[i] = all[i].duration / 1000.0;
+        stats.mean += sorted[i];
+    }
+    stats.last = sorted.back();
+    stats.mean /= static_cast<double>(sorted.size());
+    std::sort(sorted.begin(), sorted.end());
+    stats.max = sorted.back();
+    stats.p50 = percentile(sorted, 0.50);
+    stats.p95 = percentile(sorted, 0.95);
+    stats.p99 = percentile(sorted, 0.99);
+    return stats;
+}
+
+std::vector<float> Profiler::history(int zone) const
+{
+    const std::vector<Sample> all = samples(zone_at(zone));
+    std::vector<float> durations(all.size());
+    for (std::size_t i = 0; i < all.size(); ++i)
+        durations[i] = static_cast<float>(all[i].duration / 1000.0);
+    return durations;
+}
+
+void Profiler::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& zone : zones_)
+    {
+        std::lock_guard<std::mutex> zone_lock(zone->mutex);
+        zone->count = 0;
+    }
+}
+
+bool Profiler::write_chrome_trace(const std::string& filename) const
+{
+    std::FILE* file = std::fopen(filename.c_str(), "w");
+    if (file == nullptr)
+        return false;
+    std::fputs("{\"traceEvents\":[\n", file);
+    bool first = true;
+    const std::size_t zones = num_zones();
+    for (std::size_t z = 0; z < zones; ++z)
+    {
+        const std::string name = json_string(zone_name(static_cast<int>(z)));
+        for (const Sample& sample : samples(zone_at(static_cast<int>(z))))
+        {
+            std::fprintf(
+                file,
+                "%s{\"name\":%s,\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                "\"pid\":0,\"tid\":%u}",
+                first ? "" : ",\n",
+                name.c_str(),
+                sample.start,
+                sample.duration,
+                static_cast<unsigned>(sample.thread));
+            first = false;
+        }
+    }
+    std::fputs("\n],\"displayTimeUnit\":\"ms\"}\n", file);
+    return std::fclose(file) == 0;
+}
+
+ScopedTimer::ScopedTimer(const std::string& zone)
+{
+    Profiler& profiler = Profiler::instance();
+    if (!profiler.enabled())
+        return;
+    zone_ = profiler.zone(zone);
+    start_ = Profiler::Clock::now();
+}
+
+ScopedTimer::ScopedTimer(int zone)
+{
+    if (!Profiler::instance().enabled())
+        return;
+    zone_ = zone;
+    start_ = Profiler::Clock::now();
+}
+
+ScopedTimer::~ScopedTimer()
+{
+    if (zone_ >= 0)
+        Profiler::instance().record(zone_, start_, Profiler::Clock::now());
+}
+}  // namespace USTC_CG
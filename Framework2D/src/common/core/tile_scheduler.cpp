@@ -0,0 +1,201 @@
+#include "common/tile_scheduler.h"
+
+#include <atomic>
+#include <exception>
+
+namespace USTC_CG
+{
+namespace
+{
+// Set while the current thread executes a task, so that nested parallel
+// calls fall back to serial execution instead of dead-locking the pool.
+thread_local bool in_task = false;
+}  // namespace
+
+TileScheduler::TileScheduler(int num_threads)
+{
+    if (num_threads <= 0)
+        num_threads =
+            std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    for (int i = 0; i < num_threads; ++i)
+        queues_.push_back(std::make_unique<Queue>());
+    // The thread calling run() works as thread 0.
+    for (int i = 1; i < num_threads; ++i)
+        workers_.emplace_back([this, i] { worker_loop(i); });
+}
+
+TileScheduler::~TileScheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_)
+        worker.join();
+}
+
+TileScheduler& TileScheduler::instance()
+{
+    static TileScheduler scheduler;
+    return scheduler;
+}
+
+void TileScheduler::parallel_for_tiles(
+    int width,
+    int height,
+    const std::function<void(const Tile&)>& fn,
+    int tile_size)
+{
+    if (width <= 0 || height <= 0)
+        return;
+    tile_size = std::max(1, tile_size);
+    const int tiles_x = (width + tile_size - 1) / tile_size;
+    const int tiles_y = (height + tile_size - 1) / tile_size;
+    run(static_cast<std::size_t>(tiles_x) * tiles_y,
+        [&](std::size_t i)
+        {
+            Tile tile;
+            tile.x0 = static_cast<int>(i % tiles_x) * tile_size;
+            tile.y0 = static_cast<int>(i / tiles_x) * tile_size;
+            tile.x1 = std::min(tile.x0 + tile_size, width);
+            tile.y1 = std::min(tile.y0 + tile_size, height);
+            fn(tile);
+        });
+}
+
+void TileScheduler::parallel_for(
+    std::size_t count,
+    const std::function<void(std::size_t, std::size_t)>& fn,
+    std::size_t grain)
+{
+    grain = std::max<std::size_t>(1, grain);
+    run((count + grain - 1) / grain,
+        [&](std::size_t i)
+        { fn(i * grain, std::min(count, (i + 1) * grain)); });
+}
+
+void TileScheduler::run(
+    std::size_t count,
+    const std::function<void(std::size_t)>& task)
+{
+    if (count == 0)
+        return;
+    // A caller that finds the pool busy with another job (e.g. a background
+    // save while the UI warps) runs its own serially rather than wait for
+    // the whole of the other one.
+    std::unique_lock<std::mutex> run_lock(run_mutex_, std::defer_lock);
+    if (in_task || workers_.empty() || count == 1 || !run_lock.try_lock())
+    {
+        for (std::size_t i = 0; i < count; ++i)
+            task(i);
+        return;
+    }
+
+    // Publish the task before any index becomes visible in a queue, so a
+    // worker that pops an index always sees the matching task.
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        task_ = &task;
+        pending_ = count;
+        error_ = nullptr;
+    }
+    // Contiguous blocks per thread keep neighbouring tiles on the same core;
+    // stealing rebalances when some tiles are more expensive than others.
+    const std::size_t threads = queues_.size();
+    for (std::size_t t = 0; t < threads; ++t)
+    {
+        std::lock_guard<std::mutex> lock(queues_[t]->mutex);
+        for (std::size_t i = t * count / threads;
+             i < (t + 1) * count / threads;
+             ++i)
+            queues_[t]->tasks.push_back(i);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++generation_;
+    }
+    wake_.notify_all();
+
+    work(0);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return pending_ == 0 && active_workers_ == 0; });
+    task_ = nullptr;
+    if (error_)
+        std::rethrow_exception(error_);
+}
+
+void TileScheduler::worker_loop(int index)
+{
+    std::size_t seen = 0;
+    while (true)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+        if (stop_)
+            return;
+        seen = generation_;
+        ++active_workers_;
+        lock.unlock();
+
+        work(index);
+
+        lock.lock();
+        --active_workers_;
+        if (pending_ == 0 && active_workers_ == 0)
+            done_.notify_all();
+    }
+}
+
+void TileScheduler::work(int index)
+{
+    const bool was_in_task = in_task;
+    in_task = true;
+    std::size_t i;
+    while (pop(index, i) || steal(index, i))
+    {
+        try
+        {
+            (*task_)(i);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!error_)
+                error_ = std::current_exception();
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--pending_ == 0)
+            done_.notify_all();
+    }
+    in_task = was_in_task;
+}
+
+bool TileScheduler::pop(int index, std::size_t& task)
+{
+    Queue& queue = *queues_[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty())
+        return false;
+    task = queue.tasks.front();
+    queue.tasks.pop_front();
+    return true;
+}
+
+bool TileScheduler::steal(int thief, std::size_t& task)
+{
+    const int threads = static_cast<int>(queues_.size());
+    for (int k = 1; k < threads; ++k)
+    {
+        Queue& queue = *queues_[(thief + k) % threads];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty())
+            continue;
+        task = queue.tasks.back();
+        queue.tasks.pop_back();
+        return true;
+    }
+    return false;
+}
+}  // namespace USTC_CG
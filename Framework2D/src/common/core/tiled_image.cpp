@@ -0,0 +1,315 @@
+#include "common/tiled_image.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include "common/png_writer.h"
+#include "common/tile_scheduler.h"
+#include "stb_image.h"
+
+namespace USTC_CG
+{
+namespace
+{
+constexpr char kMagic[4] = { 'U', 'T', 'I', '1' };
+
+// Tiles are copied in parallel, a few rows of tiles per task
+constexpr std::size_t kTilesPerTask = 16;
+
+Tile clip(const Tile& rect, int width, int height)
+{
+    return { std::max(rect.x0, 0),
+             std::max(rect.y0, 0),
+             std::min(rect.x1, width),
+             std::min(rect.y1, height) };
+}
+}  // namespace
+
+bool TiledImage::create(
+    const std::string& filename,
+    int width,
+    int height,
+    int channels,
+    int tile_size)
+{
+    close();
+    if (width <= 0 || height <= 0 || channels <= 0 || tile_size <= 0)
+        return false;
+    const std::uint32_t header[] = { static_cast<std::uint32_t>(width),
+                                     static_cast<std::uint32_t>(height),
+                                     static_cast<std::uint32_t>(channels),
+                                     static_cast<std::uint32_t>(tile_size) };
+    char bytes[kHeaderSize] = {};
+    std::memcpy(bytes, kMagic, sizeof(kMagic));
+    std::memcpy(bytes + sizeof(kMagic), header, sizeof(header));
+    {
+        std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+        if (!out.write(bytes, kHeaderSize))
+            return false;
+    }
+    const std::size_t tiles =
+        static_cast<std::size_t>((width + tile_size - 1) / tile_size) *
+        ((height + tile_size - 1) / tile_size);
+    std::error_code error;
+    std::filesystem::resize_file(
+        filename,
+        kHeaderSize + tiles * tile_size * tile_size * channels,
+        error);
+    return !error && open(filename, true);
+}
+
+bool TiledImage::open(const std::string& filename, bool writable)
+{
+    close();
+    if (!file_.open(filename, writable))
+        return false;
+    std::uint32_t header[4];
+    if (file_.size() < kHeaderSize ||
+        std::memcmp(file_.data(), kMagic, sizeof(kMagic)) != 0)
+    {
+        close();
+        return false;
+    }
+    std::memcpy(header, file_.data() + sizeof(kMagic), sizeof(header));
+    width_ = static_cast<int>(header[0]);
+    height_ = static_cast<int>(header[1]);
+    channels_ = static_cast<int>(header[2]);
+    tile_size_ = static_cast<int>(header[3]);
+    if (width_ <= 0 || height_ <= 0 || channels_ <= 0 || tile_size_ <= 0)
+    {
+        close();
+        return false;
+    }
+    tiles_x_ = (width_ + tile_size_ - 1) / tile_size_;
+    tiles_y_ = (height_ + tile_size_ - 1) / tile_size_;
+    if (file_.size() <
+        kHeaderSize + static_cast<std::size_t>(tiles_x_) * tiles_y_ *
+                          tile_bytes())
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void TiledImage::close()
+{
+    file_.close();
+    width_ = height_ = channels_ = 0;
+    tile_size_ = tiles_x_ = tiles_y_ = 0;
+}
+
+Tile TiledImage::tile_rect(int tx, int ty) const
+{
+    return clip(
+        { tx * tile_size_,
+          ty * tile_size_,
+          (tx + 1) * tile_size_,
+          (ty + 1) * tile_size_ },
+        width_,
+        height_);
+}
+
+std::span<const unsigned char> TiledImage::tile(int tx, int ty) const
+{
+    const std::size_t index = static_cast<std::size_t>(ty) * tiles_x_ + tx;
+    return { file_.data() + kHeaderSize + index * tile_bytes(),
+             tile_bytes() };
+}
+
+std::span<unsigned char> TiledImage::tile(int tx, int ty)
+{
+    const std::size_t index = static_cast<std::size_t>(ty) * tiles_x_ + tx;
+    return { file_.data() + kHeaderSize + index * tile_bytes(),
+             tile_bytes() };
+}
+
+Image TiledImage::read(const Tile& rect, Image::Layout layout) const
+{
+    const Tile view = clip(rect, width_, height_);
+    if (!is_open() || view.empty())
+        return Image();
+    Image image(view.width(), view.height(), channels_);
+    const int tx0 = view.x0 / tile_size_, tx1 = (view.x1 - 1) / tile_size_;
+    const int ty0 = view.y0 / tile_size_, ty1 = (view.y1 - 1) / tile_size_;
+    const int columns = tx1 - tx0 + 1;
+    const std::size_t tile_row = static_cast<std::size_t>(tile_size_) *
+                                 channels_;
+    // Each tile fills its own part of the image
+    TileScheduler::instance().parallel_for(
+        static_cast<std::size_t>(columns) * (ty1 - ty0 + 1),
+        [&](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t t = begin; t < end; ++t)
+            {
+                const int tx = tx0 + static_cast<int>(t % columns);
+                const int ty = ty0 + static_cast<int>(t / columns);
+                const Tile part = tile_rect(tx, ty);
+                const Tile copy = { std::max(part.x0, view.x0),
+                                    std::max(part.y0, view.y0),
+                                    std::min(part.x1, view.x1),
+                                    std::min(part.y1, view.y1) };
+                const unsigned char* pixels = tile(tx, ty).data();
+                const std::size_t run =
+                    static_cast<std::size_t>(copy.width()) * channels_;
+                for (int y = copy.y0; y < copy.y1; ++y)
+                {
+                    const unsigned char* in =
+                        pixels + (y - part.y0) * tile_row +
+                        static_cast<std::size_t>(copy.x0 - part.x0) *
+                            channels_;
+                    std::copy(
+                        in,
+                        in + run,
+                        image.pixel_unchecked(
+                            copy.x0 - view.x0, y - view.y0));
+                }
+            }
+        },
+        kTilesPerTask);
+    image.convert_layout(layout);
+    return image;
+}
+
+void TiledImage::read_rows(int y0, int y1, unsigned char* rows) const
+{
+    const std::size_t row_size = static_cast<std::size_t>(width_) * channels_;
+    const std::size_t tile_row = static_cast<std::size_t>(tile_size_) *
+                                 channels_;
+    for (int y = std::max(y0, 0); y < std::min(y1, height_); ++y)
+    {
+        const int ty = y / tile_size_;
+        unsigned char* out = rows + (y - y0) * row_size;
+        for (int tx = 0; tx < tiles_x_; ++tx)
+        {
+            const Tile part = tile_rect(tx, ty);
+            const unsigned char* in =
+                tile(tx, ty).data() + (y - part.y0) * tile_row;
+            out = std::copy(
+                in,
+                in + static_cast<std::size_t>(part.width()) * channels_,
+                out);
+        }
+    }
+}
+
+bool TiledImage::write(const Image& image, int x, int y)
+{
+    if (image.channels() != channels_)
+        return false;
+    if (image.layout() == Image::kInterleaved)
+        return write(image.data(), image.width(), image.height(), x, y);
+    Image interleaved = image;
+    interleaved.convert_layout(Image::kInterleaved);
+    return write(interleaved.data(), image.width(), image.height(), x, y);
+}
+
+bool TiledImage::write(
+    const unsigned char* pixels,
+    int width,
+    int height,
+    int x,
+    int y,
+    std::size_t row_bytes)
+{
+    if (!file_.writable())
+        return false;
+    const Tile target =
+        clip({ x, y, x + width, y + height }, width_, height_);
+    if (target.empty())
+        return true;
+    const std::size_t row_size =
+        row_bytes ? row_bytes : static_cast<std::size_t>(width) * channels_;
+    const int tx0 = target.x0 / tile_size_, tx1 = (target.x1 - 1) / tile_size_;
+    const int ty0 = target.y0 / tile_size_, ty1 = (target.y1 - 1) / tile_size_;
+    const int columns = tx1 - tx0 + 1;
+    const std::size_t tile_row = static_cast<std::size_t>(tile_size_) *
+                                 channels_;
+    TileScheduler::instance().parallel_for(
+        static_cast<std::size_t>(columns) * (ty1 - ty0 + 1),
+        [&](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t t = begin; t < end; ++t)
+            {
+                const int tx = tx0 + static_cast<int>(t % columns);
+                const int ty = ty0 + static_cast<int>(t / columns);
+                const Tile part = tile_rect(tx, ty);
+                const Tile copy = { std::max(part.x0, target.x0),
+                                    std::max(part.y0, target.y0),
+                                    std::min(part.x1, target.x1),
+                                    std::min(part.y1, target.y1) };
+                unsigned char* out = tile(tx, ty).data();
+                const std::size_t run =
+                    static_cast<std::size_t>(copy.width()) * channels_;
+                for (int py = copy.y0; py < copy.y1; ++py)
+                {
+                    const unsigned char* in =
+                        pixels + (py - y) * row_size +
+                        static_cast<std::size_t>(copy.x0 - x) * channels_;
+                    std::copy(
+                        in,
+                        in + run,
+                        out + (py - part.y0) * tile_row +
+                            static_cast<std::size_t>(copy.x0 - part.x0) *
+                                channels_);
+                }
+            }
+        },
+        kTilesPerTask);
+    return true;
+}
+
+std::size_t TiledImage::tile_bytes() const
+{
+    return static_cast<std::size_t>(tile_size_) * tile_size_ * channels_;
+}
+
+bool convert_to_tiled(
+    const std::string& input,
+    const std::string& output,
+    int channels,
+    int tile_size)
+{
+    int width = 0, height = 0;
+    unsigned char* pixels =
+        stbi_load(input.c_str(), &width, &height, nullptr, channels);
+    if (pixels == nullptr)
+        return false;
+    TiledImage tiled;
+    const bool ok =
+        tiled.create(output, width, height, channels, tile_size) &&
+        tiled.write(pixels, width, height, 0, 0);
+    stbi_image_free(pixels);
+    return ok;
+}
+
+bool export_png(
+    const TiledImage& image,
+    const std::string& output,
+    const IoProgress& progress)
+{
+    if (!image.is_open())
+        return false;
+    PngWriter writer;
+    if (!writer.open(output, image.width(), image.height(), image.channels()))
+        return false;
+    // One row of tiles in memory at a time
+    std::vector<unsigned char> band(
+        static_cast<std::size_t>(image.width()) * image.channels() *
+        image.tile_size());
+    bool ok = true;
+    for (int y = 0; y < image.height() && ok; y += image.tile_size())
+    {
+        const int rows = std::min(image.tile_size(), image.height() - y);
+        image.read_rows(y, y + rows, band.data());
+        ok = writer.write_rows(band.data(), rows);
+        if (progress)
+            progress(static_cast<float>(y + rows) / image.height());
+    }
+    return writer.close() && ok;
+}
+}  // namespace USTC_CG
@@ -1,23 +1,34 @@
 #include "common/image_widget.h"
 
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
 #include <stdexcept>
 
-#define STB_IMAGE_IMPLEMENTATION
-#include "iostream"
-#include "stb_image.h"
-#define STB_IMAGE_WRITE_IMPLEMENTATION
-#include "stb_image_write.h"
+#include "common/image_io.h"
+#include "common/profiler.h"
 
 namespace USTC_CG
 {
-ImageWidget::ImageWidget(const std::string& label, const std::string& filename)
+namespace
+{
+// Side of the view of a tiled image until fit_view() sizes it
+constexpr int kInitialView = 1024;
+}  // namespace
+
+ImageWidget::ImageWidget(
+    const std::string& label,
+    const std::string& filename,
+    std::shared_ptr<Image> data)
     : filename_(filename),
       Widget(label)
 {
     glGenTextures(1, &tex_id_);
-    auto image_data =
-        stbi_load(filename.c_str(), &image_width_, &image_height_, NULL, 4);
-    if (image_data == nullptr)
+    if (!data && is_tiled_image(filename))
+        open_tiled(filename);
+    else
+        data_ = data ? std::move(data) : load_image(filename, 4);
+    if (data_ == nullptr)
     {
         std::cout << "Failed to load image from file " << filename << std::endl;
         data_ = std::make_shared<Image>(image_width_, image_height_, 4);
@@ -26,9 +37,8 @@ ImageWidget::ImageWidget(const std::string& label, const std::string& filename)
     {
         std::cout << "Successfully load image from file " << filename
                   << std::endl;
-        std::unique_ptr<unsigned char[]> tmp(image_data);
-        data_ = std::make_shared<Image>(
-            image_width_, image_height_, 4, std::move(tmp));
+        image_width_ = data_->width();
+        image_height_ = data_->height();
     }
     load_gltexture();
 }
@@ -40,6 +50,8 @@ ImageWidget::~ImageWidget()
 
 void ImageWidget::draw()
 {
+    if (tiled_)
+        pan_view();
     draw_image();
 }
 
@@ -55,21 +67,140 @@ ImVec2 ImageWidget::get_image_size() const
 
 void ImageWidget::update()
 {
+    ScopedTimer timer("texture upload");
+    if (tiled_)
+        write_back();
+    const DirtyRegion& dirty = data_->dirty();
+    const bool same_storage = tex_width_ == data_->width() &&
+                              tex_height_ == data_->height() &&
+                              tex_channels_ == data_->channels();
+    // Nothing marked means the pixels were written without marking them
+    if (dirty.empty() || dirty.whole() || !same_storage ||
+        data_->layout() != Image::kInterleaved)
+    {
+        load_gltexture();
+        return;
+    }
+    update_gltexture();
+}
+
+const ImageWidget::UploadStats& ImageWidget::last_upload() const
+{
+    return last_upload_;
+}
+
+IoTask<bool> ImageWidget::save_to_disk(const std::string& filename)
+{
+    if (tiled_)
+        return AsyncImageIO::instance().export_png(
+            tiled_,
+            std::filesystem::path(filename).replace_extension(".png").string());
+    return AsyncImageIO::instance().save(
+        std::make_shared<const Image>(*data_), filename);
+}
+
+bool ImageWidget::is_tiled() const
+{
+    return tiled_ != nullptr;
+}
+
+const Tile& ImageWidget::view() const
+{
+    return view_;
+}
+
+void ImageWidget::fit_view(const ImVec2& size)
+{
+    if (!tiled_)
+        return;
+    set_view({ view_.x0,
+               view_.y0,
+               view_.x0 + std::max(static_cast<int>(size.x), 1),
+               view_.y0 + std::max(static_cast<int>(size.y), 1) });
+}
+
+void ImageWidget::open_tiled(const std::string& filename)
+{
+    tiled_ = std::make_shared<TiledImage>();
+    const bool opened =
+        tiled_->open(filename, true) || tiled_->open(filename, false);
+    // The texture takes 3 or 4 channels
+    if (!opened || (tiled_->channels() != 3 && tiled_->channels() != 4))
+    {
+        tiled_.reset();
+        return;
+    }
+    if (!tiled_->writable())
+        std::cout << "Tiled image " << filename
+                  << " is read-only: edits are not saved" << std::endl;
+    view_ = { 0,
+              0,
+              std::min(kInitialView, tiled_->width()),
+              std::min(kInitialView, tiled_->height()) };
+    data_ = std::make_shared<Image>(tiled_->read(view_));
+}
+
+void ImageWidget::set_view(const Tile& rect)
+{
+    const int width = std::clamp(rect.width(), 1, tiled_->width());
+    const int height = std::clamp(rect.height(), 1, tiled_->height());
+    const int x = std::clamp(rect.x0, 0, tiled_->width() - width);
+    const int y = std::clamp(rect.y0, 0, tiled_->height() - height);
+    const Tile view = { x, y, x + width, y + height };
+    if (view.x0 == view_.x0 && view.y0 == view_.y0 && view.x1 == view_.x1 &&
+        view.y1 == view_.y1)
+        return;
+    ScopedTimer timer("read view");
+    view_ = view;
+    *data_ = tiled_->read(view_);
+    image_width_ = width;
+    image_height_ = height;
     load_gltexture();
+    view_changed();
 }
 
-void ImageWidget::save_to_disk(const std::string& filename)
+void ImageWidget::pan_view()
 {
-    if (data_)
+    const ImVec2 max(position_.x + image_width_, position_.y + image_height_);
+    if (ImGui::IsMouseClicked(ImGuiMouseButton_Middle) &&
+        ImGui::IsMouseHoveringRect(position_, max))
+        panning_ = true;
+    if (!ImGui::IsMouseDown(ImGuiMouseButton_Middle))
+        panning_ = false;
+    if (!panning_)
+        return;
+    // The image follows the mouse
+    const ImVec2 delta = ImGui::GetIO().MouseDelta;
+    pan_ = ImVec2(pan_.x - delta.x, pan_.y - delta.y);
+    const int dx = static_cast<int>(pan_.x), dy = static_cast<int>(pan_.y);
+    pan_ = ImVec2(pan_.x - dx, pan_.y - dy);
+    if (dx != 0 || dy != 0)
+        set_view(
+            { view_.x0 + dx, view_.y0 + dy, view_.x1 + dx, view_.y1 + dy });
+}
+
+void ImageWidget::write_back()
+{
+    if (!tiled_->writable())
+        return;
+    const DirtyRegion& dirty = data_->dirty();
+    // Nothing marked means the pixels were written without marking them
+    if (dirty.empty() || dirty.whole() ||
+        data_->layout() != Image::kInterleaved)
     {
-        stbi_write_png(
-            filename.c_str(),
-            data_->width(),
-            data_->height(),
-            data_->channels(),
-            data_->data(),
-            data_->width() * data_->channels());
+        tiled_->write(*data_, view_.x0, view_.y0);
+        return;
     }
+    const std::size_t row_bytes =
+        static_cast<std::size_t>(data_->width()) * data_->channels();
+    for (const Tile& rect : dirty.rects())
+        tiled_->write(
+            data_->pixel_unchecked(rect.x0, rect.y0),
+            rect.width(),
+            rect.height(),
+            view_.x0 + rect.x0,
+            view_.y0 + rect.y0,
+            row_bytes);
 }
 
 void ImageWidget::load_gltexture()
@@ -80,8 +211,18 @@ void ImageWidget::load_gltexture()
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
+    // OpenGL expects interleaved pixels
+    Image interleaved;
+    const Image* image = data_.get();
+    if (data_->layout() != Image::kInterleaved)
+    {
+        interleaved = *data_;
+        interleaved.convert_layout(Image::kInterleaved);
+        image = &interleaved;
+    }
+
     // Upload pixels into texture (different type of channels)
-    if (data_->channels() == 3)
+    if (image->channels() == 3)
     {
         glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
         glTexImage2D(
@@ -93,10 +234,10 @@ void ImageWidget::load_gltexture()
             0,
             GL_RGB,
             GL_UNSIGNED_BYTE,
-            data_->data());
+            image->data());
         glPixelStorei(GL_UNPACK_ALIGNMENT, 4); 
     }
-    else if (data_->channels() == 4)
+    else if (image->channels() == 4)
     {
         glTexImage2D(
             GL_TEXTURE_2D,
@@ -107,12 +248,49 @@ void ImageWidget::load_gltexture()
             0,
             GL_RGBA,
             GL_UNSIGNED_BYTE,
-            data_->data());
+            image->data());
     }
     else
     {
         throw std::runtime_error("Unsupported number of channels");
     }
+    tex_width_ = image->width();
+    tex_height_ = image->height();
+    tex_channels_ = image->channels();
+    last_upload_ = { image->size(), 0 };
+    data_->clear_dirty();
+}
+
+void ImageWidget::update_gltexture()
+{
+    glBindTexture(GL_TEXTURE_2D, tex_id_);
+    const GLenum format = data_->channels() == 3 ? GL_RGB : GL_RGBA;
+    // Rectangles are read in place from the whole rows of the image
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, data_->width());
+    for (const Tile& rect : data_->dirty().rects())
+    {
+        glPixelStorei(GL_UNPACK_SKIP_PIXELS, rect.x0);
+        glPixelStorei(GL_UNPACK_SKIP_ROWS, rect.y0);
+        glTexSubImage2D(
+            GL_TEXTURE_2D,
+            0,
+            rect.x0,
+            rect.y0,
+            rect.width(),
+            rect.height(),
+            format,
+            GL_UNSIGNED_BYTE,
+            data_->data());
+    }
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    const std::size_t bytes = data_->dirty().area() * data_->channels();
+    last_upload_ = { bytes, data_->size() - bytes };
+    data_->clear_dirty();
 }
 
 void ImageWidget::draw_image()
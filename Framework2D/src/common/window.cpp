@@ -4,6 +4,7 @@
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
 
+#include <cstdio>
 #include <iostream>
 
 namespace USTC_CG
@@ -128,12 +129,28 @@ bool Window::init_gui()
 
 void Window::render()
 {
+    static const int frame_zone = Profiler::instance().zone("frame");
+    static const int draw_zone = Profiler::instance().zone("draw");
+    static const int present_zone = Profiler::instance().zone("present");
+    const auto now = Profiler::Clock::now();
+    if (frame_start_ != Profiler::Clock::time_point())
+        Profiler::instance().record(frame_zone, frame_start_, now);
+    frame_start_ = now;
+
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
 
-    draw();
+    {
+        ScopedTimer timer(draw_zone);
+        draw();
+    }
+    if (ImGui::IsKeyPressed(ImGuiKey_F3, false))
+        show_profiler_ = !show_profiler_;
+    if (show_profiler_)
+        draw_profiler();
 
+    ScopedTimer timer(present_zone);
     ImGui::Render();
 
     glfwGetFramebufferSize(window_, &width_, &height_);
@@ -146,4 +163,93 @@ void Window::render()
     glfwSwapBuffers(window_);
 }
 
+void Window::draw_progress(
+    const char* action,
+    const std::string& filename,
+    float done)
+{
+    ImGui::Text("%s %s", action, filename.c_str());
+    ImGui::ProgressBar(done, ImVec2(ImGui::GetFontSize() * 20.0f, 0.0f));
+}
+
+void Window::draw_profiler()
+{
+    Profiler& profiler = Profiler::instance();
+    ImGui::SetNextWindowPos(ImVec2(10, 30), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin(
+            "Profiler",
+            &show_profiler_,
+            ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoCollapse))
+    {
+        ImGui::End();
+        return;
+    }
+
+    const int frame_zone = profiler.zone("frame");
+    const Profiler::Stats frame = profiler.stats(frame_zone);
+    ImGui::Text(
+        "Frame %.2f ms (%.0f FPS), p95 %.2f ms, p99 %.2f ms",
+        frame.mean,
+        frame.mean > 0 ? 1000.0 / frame.mean : 0.0,
+        frame.p95,
+        frame.p99);
+    const std::vector<float> frames = profiler.history(frame_zone);
+    if (!frames.empty())
+        ImGui::PlotLines(
+            "##frames",
+            frames.data(),
+            static_cast<int>(frames.size()),
+            0,
+            nullptr,
+            0.0f,
+            static_cast<float>(2 * frame.p99),
+            ImVec2(ImGui::GetFontSize() * 30.0f, ImGui::GetFontSize() * 4.0f));
+
+    // Milliseconds over the last Profiler::kHistory samples of each zone
+    if (ImGui::BeginTable("zones", 7))
+    {
+        for (const char* column :
+             { "Zone", "Last", "Mean", "p50", "p95", "p99", "Max" })
+            ImGui::TableSetupColumn(column);
+        ImGui::TableHeadersRow();
+        for (int z = 0; z < static_cast<int>(profiler.num_zones()); ++z)
+        {
+            const Profiler::Stats stats = profiler.stats(z);
+            if (z == frame_zone || stats.count == 0)
+                continue;
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(profiler.zone_name(z).c_str());
+            for (double value : { stats.last,
+                                  stats.mean,
+                                  stats.p50,
+                                  stats.p95,
+                                  stats.p99,
+                                  stats.max })
+            {
+                ImGui::TableNextColumn();
+                ImGui::Text("%.2f", value);
+            }
+        }
+        ImGui::EndTable();
+    }
+
+    if (ImGui::Button("Save trace"))
+    {
+        const char* filename = "trace.json";
+        trace_status_ = profiler.write_chrome_trace(filename)
+                            ? std::string("Saved ") + filename
+                            : std::string("Failed to write ") + filename;
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Clear"))
+        profiler.clear();
+    if (!trace_status_.empty())
+    {
+        ImGui::SameLine();
+        ImGui::TextUnformatted(trace_status_.c_str());
+    }
+    ImGui::End();
+}
+
 }  // namespace USTC_CG
\ No newline at end of file
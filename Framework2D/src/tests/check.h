@@ -0,0 +1,47 @@
+// Minimal checks for the test programs, without a test framework: a failed
+// CHECK prints where it is and the program keeps going, then main() returns
+// report(), non-zero if any check failed.
+#pragma once
+
+#include <cstdio>
+
+namespace USTC_CG
+{
+namespace test
+{
+inline int& failures()
+{
+    static int count = 0;
+    return count;
+}
+
+inline void fail(const char* expression, const char* file, int line)
+{
+    std::printf("%s:%d: CHECK(%s) failed\n", file, line, expression);
+    ++failures();
+}
+
+// Run one test case, named in the output
+template<typename Fn>
+void run(const char* name, Fn fn)
+{
+    const int before = failures();
+    fn();
+    std::printf("%s %s\n", failures() == before ? "[pass]" : "[FAIL]", name);
+}
+
+inline int report()
+{
+    if (failures() != 0)
+        std::printf("%d check(s) failed\n", failures());
+    return failures() == 0 ? 0 : 1;
+}
+}  // namespace test
+}  // namespace USTC_CG
+
+#define CHECK(expression)                                            \
+    do                                                               \
+    {                                                                \
+        if (!(expression))                                           \
+            ::USTC_CG::test::fail(#expression, __FILE__, __LINE__); \
+    } while (false)
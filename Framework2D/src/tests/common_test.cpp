@@ -0,0 +1,407 @@
+// Tests of the GL-free framework: dirty rectangles, undo history, the tile
+// scheduler and the image writers.
+#include <stb_image_write.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "check.h"
+#include "common/dirty_region.h"
+#include "common/image.h"
+#include "common/image_history.h"
+#include "common/image_io.h"
+#include "common/png_writer.h"
+#include "common/tile_scheduler.h"
+
+using namespace USTC_CG;
+
+namespace
+{
+std::string temp_path(const char* name)
+{
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+bool inside(const Tile& rect, int x, int y)
+{
+    return rect.x0 <= x && x < rect.x1 && rect.y0 <= y && y < rect.y1;
+}
+
+Image random_image(int width, int height, int channels, unsigned seed)
+{
+    Image image(width, height, channels);
+    std::mt19937 random(seed);
+    for (std::size_t i = 0; i < image.size(); ++i)
+        image.data()[i] = static_cast<unsigned char>(random());
+    return image;
+}
+
+// A smooth image, which JPEG encodes without much loss
+Image gradient_image(int width, int height, int channels)
+{
+    Image image(width, height, channels);
+    for (int y = 0; y < height; ++y)
+        for (int x = 0; x < width; ++x)
+            for (int c = 0; c < channels; ++c)
+                image.at_unchecked(x, y, c) =
+                    static_cast<unsigned char>((x * (c + 1) + y * 2) & 255);
+    return image;
+}
+
+bool same_pixels(const Image& a, const Image& b)
+{
+    return a.width() == b.width() && a.height() == b.height() &&
+           a.channels() == b.channels() &&
+           std::equal(a.data(), a.data() + a.size(), b.data());
+}
+
+void test_dirty_region()
+{
+    const int width = 300, height = 200;
+    std::mt19937 random(1);
+    for (int round = 0; round < 200; ++round)
+    {
+        DirtyRegion dirty;
+        dirty.reset(width, height);
+        CHECK(dirty.empty());
+        std::vector<Tile> added;
+        const int count = 1 + static_cast<int>(random() % 20);
+        for (int i = 0; i < count; ++i)
+        {
+            Tile rect;
+            rect.x0 = static_cast<int>(random() % (width + 40)) - 20;
+            rect.y0 = static_cast<int>(random() % (height + 40)) - 20;
+            rect.x1 = rect.x0 + static_cast<int>(random() % 60);
+            rect.y1 = rect.y0 + static_cast<int>(random() % 60);
+            dirty.add(rect);
+            added.push_back(rect);
+        }
+
+        const std::vector<Tile>& rects = dirty.rects();
+        CHECK(rects.size() <= DirtyRegion::kMaxRects);
+        std::size_t area = 0;
+        for (std::size_t i = 0; i < rects.size(); ++i)
+        {
+            // Inside the image, and disjoint
+            CHECK(!rects[i].empty());
+            CHECK(rects[i].x0 >= 0 && rects[i].y0 >= 0);
+            CHECK(rects[i].x1 <= width && rects[i].y1 <= height);
+            for (std::size_t j = i + 1; j < rects.size(); ++j)
+                CHECK(
+                    rects[i].x1 <= rects[j].x0 || rects[j].x1 <= rects[i].x0 ||
+                    rects[i].y1 <= rects[j].y0 || rects[j].y1 <= rects[i].y0);
+            area += static_cast<std::size_t>(rects[i].width()) *
+                    rects[i].height();
+        }
+        CHECK(area == dirty.area());
+        CHECK(dirty.area() <= dirty.total_area());
+
+        // Every pixel marked is covered
+        for (const Tile& rect : added)
+            for (int y = std::max(rect.y0, 0); y < std::min(rect.y1, height);
+                 ++y)
+                for (int x = std::max(rect.x0, 0);
+                     x < std::min(rect.x1, width);
+                     ++x)
+                {
+                    bool covered = false;
+                    for (const Tile& r : rects)
+                        covered = covered || inside(r, x, y);
+                    CHECK(covered);
+                }
+    }
+
+    // Touching rectangles merge into their union
+    DirtyRegion dirty;
+    dirty.reset(100, 100);
+    dirty.add({ 0, 0, 10, 10 });
+    dirty.add({ 10, 0, 20, 10 });
+    CHECK(dirty.rects().size() == 1);
+    CHECK(dirty.area() == 200);
+    // Far apart ones do not
+    dirty.add({ 50, 50, 60, 60 });
+    CHECK(dirty.rects().size() == 2);
+    // Most of the image collapses into all of it
+    dirty.add({ 0, 0, 95, 95 });
+    CHECK(dirty.whole());
+    CHECK(dirty.area() == dirty.total_area());
+    dirty.clear();
+    CHECK(dirty.empty());
+    dirty.add_all();
+    CHECK(dirty.whole());
+    // Nothing outside the image is marked
+    dirty.reset(100, 100);
+    dirty.add({ 100, 0, 120, 10 });
+    dirty.add({ -20, -20, 0, 0 });
+    CHECK(dirty.empty());
+}
+
+void test_image_history()
+{
+    const int width = 200, height = 150;
+    Image image = random_image(width, height, 4, 2);
+    ImageHistory history;
+    history.reset(image);
+    CHECK(!history.can_undo() && !history.can_redo());
+
+    // Steps of rectangles painted with one value each
+    std::vector<Image> steps = { image };
+    std::mt19937 random(3);
+    for (int i = 0; i < 10; ++i)
+    {
+        Tile rect;
+        rect.x0 = static_cast<int>(random() % width);
+        rect.y0 = static_cast<int>(random() % height);
+        rect.x1 =
+            std::min(width, rect.x0 + 1 + static_cast<int>(random() % 90));
+        rect.y1 =
+            std::min(height, rect.y0 + 1 + static_cast<int>(random() % 90));
+        const unsigned char value = static_cast<unsigned char>(random());
+        for (int y = rect.y0; y < rect.y1; ++y)
+            for (int x = rect.x0; x < rect.x1; ++x)
+                for (int c = 0; c < 4; ++c)
+                    image.at_unchecked(x, y, c) = value;
+        history.commit(image, rect);
+        steps.push_back(image);
+    }
+    CHECK(history.num_steps() == steps.size());
+    CHECK(history.step() == steps.size() - 1);
+
+    // Undo all the way, then redo all the way
+    for (std::size_t s = steps.size() - 1; s > 0; --s)
+    {
+        CHECK(history.undo(image));
+        CHECK(same_pixels(image, steps[s - 1]));
+    }
+    CHECK(!history.can_undo());
+    CHECK(!history.undo(image));
+    for (std::size_t s = 1; s < steps.size(); ++s)
+    {
+        CHECK(history.redo(image));
+        CHECK(same_pixels(image, steps[s]));
+    }
+    CHECK(!history.can_redo());
+
+    // Jump, then commit from the middle: the redo steps are dropped
+    history.go_to(image, 4);
+    CHECK(same_pixels(image, steps[4]));
+    image.at_unchecked(0, 0, 0) ^= 0xff;
+    history.commit(image);
+    CHECK(history.num_steps() == 6);
+    CHECK(!history.can_redo());
+    CHECK(history.undo(image));
+    CHECK(same_pixels(image, steps[4]));
+
+    // An unchanged commit records nothing
+    history.commit(image);
+    CHECK(history.num_steps() == 6);
+
+    // Restore discards a preview drawn over a rectangle
+    const Tile preview = { 20, 30, 120, 90 };
+    Image drawn = image;
+    for (int y = preview.y0; y < preview.y1; ++y)
+        for (int x = preview.x0; x < preview.x1; ++x)
+            drawn.at_unchecked(x, y, 1) = 7;
+    history.restore(drawn, preview);
+    CHECK(same_pixels(drawn, image));
+
+    // The steps beyond the limit are dropped, oldest first
+    history.set_max_steps(3);
+    for (int i = 0; i < 5; ++i)
+    {
+        image.at_unchecked(i, 0, 2) ^= 0xff;
+        history.commit(image, { i, 0, i + 1, 1 });
+    }
+    CHECK(history.num_steps() == 3);
+}
+
+void test_tile_scheduler()
+{
+    TileScheduler scheduler(4);
+    CHECK(scheduler.num_threads() == 4);
+
+    // Every pixel is visited exactly once, tiles of any size
+    for (int tile_size : { 1, 7, 64, 1000 })
+    {
+        const int width = 123, height = 77;
+        std::vector<std::atomic<int>> visits(width * height);
+        scheduler.parallel_for_tiles(
+            width,
+            height,
+            [&](const Tile& tile)
+            {
+                CHECK(tile.width() <= tile_size && tile.height() <= tile_size);
+                for (int y = tile.y0; y < tile.y1; ++y)
+                    for (int x = tile.x0; x < tile.x1; ++x)
+                        ++visits[y * width + x];
+            },
+            tile_size);
+        bool once = true;
+        for (const std::atomic<int>& v : visits)
+            once = once && v == 1;
+        CHECK(once);
+    }
+
+    // Ranges are split in chunks that cover [0, count) once
+    std::vector<std::atomic<int>> visits(10007);
+    scheduler.parallel_for(
+        visits.size(),
+        [&](std::size_t begin, std::size_t end)
+        {
+            CHECK(end - begin <= 100);
+            for (std::size_t i = begin; i < end; ++i)
+                ++visits[i];
+        },
+        100);
+    bool once = true;
+    for (const std::atomic<int>& v : visits)
+        once = once && v == 1;
+    CHECK(once);
+
+    // Nested calls run serially instead of dead-locking
+    std::atomic<long> sum = 0;
+    scheduler.parallel_for(
+        8,
+        [&](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t i = begin; i < end; ++i)
+                scheduler.parallel_for(
+                    10,
+                    [&](std::size_t b, std::size_t e)
+                    {
+                        for (std::size_t j = b; j < e; ++j)
+                            sum += static_cast<long>(j);
+                    },
+                    1);
+        },
+        1);
+    CHECK(sum == 8 * 45);
+
+    // An exception of a task reaches the caller, and the pool still works
+    bool thrown = false;
+    try
+    {
+        scheduler.parallel_for(
+            100,
+            [](std::size_t begin, std::size_t)
+            {
+                if (begin == 42)
+                    throw std::runtime_error("task");
+            },
+            1);
+    }
+    catch (const std::runtime_error&)
+    {
+        thrown = true;
+    }
+    CHECK(thrown);
+
+    // A caller finding the pool busy runs its job itself
+    std::atomic<bool> started = false, release = false;
+    std::thread background(
+        [&]
+        {
+            scheduler.parallel_for(
+                4,
+                [&](std::size_t, std::size_t)
+                {
+                    started = true;
+                    while (!release)
+                        std::this_thread::yield();
+                },
+                1);
+        });
+    while (!started)
+        std::this_thread::yield();
+    sum = 0;
+    scheduler.parallel_for(
+        1000,
+        [&](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t i = begin; i < end; ++i)
+                sum += static_cast<long>(i);
+        },
+        10);
+    CHECK(sum == 999 * 1000 / 2);
+    release = true;
+    background.join();
+}
+
+void test_png_writer()
+{
+    const std::string filename = temp_path("ustc_cg_test.png");
+    for (int channels = 1; channels <= 4; ++channels)
+    {
+        // Wide enough for rows to span several deflate blocks
+        const Image image = random_image(40000, 5, channels, channels);
+        PngWriter writer;
+        CHECK(writer.open(filename, image.width(), image.height(), channels));
+        CHECK(writer.write_rows(image.data(), 2));
+        for (int y = 2; y < image.height(); ++y)
+            CHECK(writer.write_rows(image.pixel_unchecked(0, y)));
+        CHECK(writer.close());
+
+        const std::shared_ptr<Image> read = load_image(filename, channels);
+        CHECK(read && same_pixels(*read, image));
+    }
+
+    // A missing row fails
+    const Image image = random_image(16, 4, 3, 9);
+    PngWriter writer;
+    CHECK(writer.open(filename, 16, 4, 3));
+    CHECK(writer.write_rows(image.data(), 3));
+    CHECK(!writer.close());
+    std::filesystem::remove(filename);
+}
+
+void test_jpg_strips()
+{
+    // The strips are whole MCU rows encoded on their own and joined with
+    // restart markers: the blocks, hence the decoded pixels, are those of
+    // one stb encoding of the whole image.
+    const std::string joined = temp_path("ustc_cg_test_strips.jpg");
+    const std::string whole = temp_path("ustc_cg_test_whole.jpg");
+    for (int quality : { 80, 95 })
+        for (int channels : { 1, 3, 4 })
+        {
+            const Image image = gradient_image(333, 517, channels);
+            int progress_calls = 0;
+            CHECK(save_image(
+                image,
+                joined,
+                quality,
+                [&](float) { ++progress_calls; }));
+            CHECK(progress_calls > 0);
+            CHECK(stbi_write_jpg(
+                whole.c_str(),
+                image.width(),
+                image.height(),
+                channels,
+                image.data(),
+                quality));
+
+            const std::shared_ptr<Image> a = load_image(joined, channels);
+            const std::shared_ptr<Image> b = load_image(whole, channels);
+            CHECK(a && b && same_pixels(*a, *b));
+        }
+    std::filesystem::remove(joined);
+    std::filesystem::remove(whole);
+}
+}  // namespace
+
+int main()
+{
+    test::run("DirtyRegion", test_dirty_region);
+    test::run("ImageHistory", test_image_history);
+    test::run("TileScheduler", test_tile_scheduler);
+    test::run("PngWriter", test_png_writer);
+    test::run("JPG strips", test_jpg_strips);
+    return test::report();
+}
@@ -0,0 +1,294 @@
+// Tests of the MiniDraw scene: the R-tree and the drawing files.
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "check.h"
+#include "scene/drawing_io.h"
+#include "scene/rtree.h"
+#include "scene/scene.h"
+
+using namespace USTC_CG;
+
+namespace
+{
+std::string temp_path(const char* name)
+{
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+Box random_box(std::mt19937& random)
+{
+    std::uniform_real_distribution<float> position(0.0f, 1000.0f);
+    std::uniform_real_distribution<float> size(0.0f, 30.0f);
+    Box box;
+    box.min_x = position(random);
+    box.min_y = position(random);
+    box.max_x = box.min_x + size(random);
+    box.max_y = box.min_y + size(random);
+    return box;
+}
+
+std::vector<int> brute_force(
+    const std::vector<Box>& boxes,
+    const std::vector<bool>& present,
+    const Box& query)
+{
+    std::vector<int> ids;
+    for (std::size_t i = 0; i < boxes.size(); ++i)
+        if (present[i] && boxes[i].intersects(query))
+            ids.push_back(static_cast<int>(i));
+    return ids;
+}
+
+std::vector<int> sorted_query(const RTree& tree, const Box& query)
+{
+    std::vector<int> ids;
+    tree.query(query, ids);
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+void test_rtree()
+{
+    std::mt19937 random(1);
+    const int count = 3000;
+    std::vector<Box> boxes(count);
+    for (Box& box : boxes)
+        box = random_box(random);
+    std::vector<bool> present(count, true);
+
+    // Inserted one by one, then half of them removed
+    RTree tree;
+    for (int i = 0; i < count; ++i)
+        tree.insert(i, boxes[i]);
+    CHECK(tree.size() == static_cast<std::size_t>(count));
+    for (int round = 0; round < 100; ++round)
+    {
+        const Box query = random_box(random);
+        CHECK(sorted_query(tree, query) == brute_force(boxes, present, query));
+    }
+    for (int i = 0; i < count; i += 2)
+    {
+        CHECK(tree.remove(i, boxes[i]));
+        present[i] = false;
+    }
+    CHECK(!tree.remove(0, boxes[0]));
+    CHECK(tree.size() == static_cast<std::size_t>(count / 2));
+    for (int round = 0; round < 100; ++round)
+    {
+        Box query = random_box(random);
+        query.max_x += 100.0f;
+        CHECK(sorted_query(tree, query) == brute_force(boxes, present, query));
+    }
+
+    // Packed in one pass
+    RTree packed;
+    packed.build(boxes);
+    std::fill(present.begin(), present.end(), true);
+    CHECK(packed.size() == static_cast<std::size_t>(count));
+    for (int round = 0; round < 100; ++round)
+    {
+        const Box query = random_box(random);
+        CHECK(
+            sorted_query(packed, query) == brute_force(boxes, present, query));
+    }
+    const Box everything = { -1.0f, -1.0f, 2000.0f, 2000.0f };
+    CHECK(sorted_query(packed, everything).size() == boxes.size());
+
+    // Clusters stand for the small items, which are not listed
+    std::vector<int> ids;
+    std::vector<Box> clusters;
+    packed.query(everything, 1000.0f, 1000.0f, ids, clusters);
+    CHECK(ids.empty() && !clusters.empty());
+    CHECK(clusters.size() < boxes.size());
+
+    packed.clear();
+    CHECK(packed.size() == 0);
+    CHECK(sorted_query(packed, everything).empty());
+}
+
+// The geometry of a scene, bottom to top, in a comparable form
+std::vector<float> flatten(const Scene& scene)
+{
+    const ShapeStore& store = scene.store();
+    std::vector<float> values;
+    for (ShapeHandle handle : scene.ordered())
+    {
+        const ShapeStore::Kind kind = store.kind(handle);
+        values.push_back(static_cast<float>(kind));
+        std::vector<ImVec2> points;
+        switch (kind)
+        {
+            case ShapeStore::kLine:
+            {
+                const ShapeStore::Line& line = store.line(handle);
+                points = { line.start, line.end };
+                break;
+            }
+            case ShapeStore::kRect:
+            {
+                const ShapeStore::Rect& rect = store.rect(handle);
+                points = { rect.start, rect.end };
+                break;
+            }
+            case ShapeStore::kEllipse:
+            {
+                const ShapeStore::Ellipse& ellipse = store.ellipse(handle);
+                points = { ellipse.center, ellipse.radii };
+                break;
+            }
+            case ShapeStore::kPolyline:
+            {
+                const ShapeStore::Polyline& polyline = store.polyline(handle);
+                const std::span<const ImVec2> span = store.points(polyline);
+                points.assign(span.begin(), span.end());
+                values.push_back(polyline.closed ? 1.0f : 0.0f);
+                values.push_back(static_cast<float>(points.size()));
+                break;
+            }
+        }
+        for (const ImVec2& point : points)
+        {
+            values.push_back(point.x);
+            values.push_back(point.y);
+        }
+    }
+    return values;
+}
+
+void test_drawing_round_trip()
+{
+    // Every kind of shape, interleaved, with removals in between and a
+    // polyline of no points
+    Scene scene;
+    std::mt19937 random(2);
+    std::uniform_real_distribution<float> coordinate(-500.0f, 500.0f);
+    auto point = [&] { return ImVec2(coordinate(random), coordinate(random)); };
+    std::vector<ShapeHandle> handles;
+    for (int i = 0; i < 400; ++i)
+    {
+        switch (i % 4)
+        {
+            case 0:
+                handles.push_back(
+                    scene.add(ShapeStore::Line{ point(), point() }));
+                break;
+            case 1:
+                handles.push_back(
+                    scene.add(ShapeStore::Rect{ point(), point() }));
+                break;
+            case 2:
+                handles.push_back(scene.add(
+                    ShapeStore::Ellipse{ point(), ImVec2(3.0f, 40.0f) }));
+                break;
+            case 3:
+            {
+                std::vector<ImVec2> points(1 + random() % 20);
+                for (ImVec2& p : points)
+                    p = point();
+                handles.push_back(scene.add_polyline(points, i % 8 == 3));
+                break;
+            }
+        }
+        if (i % 7 == 6)
+            scene.remove(handles[i - 3]);
+    }
+    scene.add_polyline({}, false);
+    const std::size_t size = scene.size();
+    CHECK(size == 400 - 400 / 7 + 1);
+
+    const std::string filename = temp_path("ustc_cg_test.mdw");
+    CHECK(save_drawing(scene, filename));
+    Scene loaded;
+    CHECK(load_drawing(filename, loaded));
+    CHECK(loaded.size() == size);
+    CHECK(flatten(loaded) == flatten(scene));
+
+    // Saved again, the file is the same
+    const std::string again = temp_path("ustc_cg_test_again.mdw");
+    CHECK(save_drawing(loaded, again));
+    std::ifstream a(filename, std::ios::binary), b(again, std::ios::binary);
+    const std::vector<char> bytes_a(std::istreambuf_iterator<char>(a), {});
+    const std::vector<char> bytes_b(std::istreambuf_iterator<char>(b), {});
+    CHECK(!bytes_a.empty() && bytes_a == bytes_b);
+    std::filesystem::remove(again);
+
+    // Broken files leave the scene as it is
+    Scene kept;
+    kept.add(ShapeStore::Line{ ImVec2(0, 0), ImVec2(1, 1) });
+    for (std::size_t cut :
+         { std::size_t(0), std::size_t(7), bytes_a.size() / 2 })
+    {
+        std::ofstream(filename, std::ios::binary)
+            .write(bytes_a.data(), static_cast<std::streamsize>(cut));
+        CHECK(!load_drawing(filename, kept));
+        CHECK(kept.size() == 1);
+    }
+    CHECK(!load_drawing(temp_path("ustc_cg_test_missing.mdw"), kept));
+    CHECK(kept.size() == 1);
+    std::filesystem::remove(filename);
+}
+
+void test_drawing_order_checked()
+{
+    Scene scene;
+    scene.add(ShapeStore::Line{ ImVec2(0, 0), ImVec2(10, 0) });
+    scene.add(ShapeStore::Line{ ImVec2(0, 5), ImVec2(10, 5) });
+    const std::string filename = temp_path("ustc_cg_test_order.mdw");
+    CHECK(save_drawing(scene, filename));
+    std::ifstream in(filename, std::ios::binary);
+    std::vector<char> bytes(std::istreambuf_iterator<char>(in), {});
+    in.close();
+
+    // Find the order section in the header (see drawing_io.h) and write
+    // ranks that are not a permutation
+    std::uint32_t sections = 0;
+    std::memcpy(&sections, bytes.data() + 8, 4);
+    std::uint64_t offset = 0;
+    for (std::uint32_t s = 0; s < sections; ++s)
+    {
+        const char* entry = bytes.data() + 16 + 24 * s;
+        std::uint32_t record_size = 0;
+        std::uint64_t count = 0;
+        std::memcpy(&record_size, entry + 4, 4);
+        std::memcpy(&count, entry + 16, 8);
+        if (record_size == 4 && count == 2)
+            std::memcpy(&offset, entry + 8, 8);
+    }
+    CHECK(offset != 0);
+    const std::uint32_t broken[][2] = {
+        { 0, 0 }, { 0, 0xffffffffu }, { 1, 2 }
+    };
+    for (const auto& ranks : broken)
+    {
+        std::memcpy(bytes.data() + offset, ranks, sizeof(ranks));
+        std::ofstream(filename, std::ios::binary)
+            .write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        Scene loaded;
+        CHECK(!load_drawing(filename, loaded));
+    }
+    const std::uint32_t swapped[2] = { 1, 0 };
+    std::memcpy(bytes.data() + offset, swapped, sizeof(swapped));
+    std::ofstream(filename, std::ios::binary)
+        .write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    Scene loaded;
+    CHECK(load_drawing(filename, loaded));
+    CHECK(loaded.size() == 2);
+    std::filesystem::remove(filename);
+}
+}  // namespace
+
+int main()
+{
+    test::run("RTree", test_rtree);
+    test::run("Drawing file round trip", test_drawing_round_trip);
+    test::run("Drawing file order", test_drawing_order_checked);
+    return test::report();
+}
@@ -0,0 +1,261 @@
+// Tests of the Poisson editing core: regions, the polygon scanline fill and
+// the two backends of the seamless cloner.
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "check.h"
+#include "common/image.h"
+#include "poisson/region.h"
+#include "poisson/seamless_cloner.h"
+#include "shapes/polygon.h"
+
+using namespace USTC_CG;
+
+namespace
+{
+// Pixels of a set of spans, as a width x height mask
+std::vector<bool> rasterize(
+    const std::vector<Region::Span>& spans,
+    int width,
+    int height)
+{
+    std::vector<bool> mask(width * height, false);
+    for (const Region::Span& span : spans)
+        for (int x = std::max(span.x0, 0); x < std::min(span.x1, width); ++x)
+            if (span.y >= 0 && span.y < height)
+                mask[span.y * width + x] = true;
+    return mask;
+}
+
+// Even-odd rule at the pixel centers, one test per pixel
+std::vector<bool> inside_polygon(
+    const std::vector<float>& xs,
+    const std::vector<float>& ys,
+    int width,
+    int height)
+{
+    std::vector<bool> mask(width * height, false);
+    const std::size_t n = xs.size();
+    for (int y = 0; y < height; ++y)
+        for (int x = 0; x < width; ++x)
+        {
+            const double cx = x + 0.5, cy = y + 0.5;
+            bool inside = false;
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                const double x0 = xs[i], y0 = ys[i];
+                const double x1 = xs[(i + 1) % n], y1 = ys[(i + 1) % n];
+                if ((y0 <= cy) == (y1 <= cy))
+                    continue;
+                const double crossing = x0 + (cy - y0) * (x1 - x0) / (y1 - y0);
+                if (crossing <= cx)
+                    inside = !inside;
+            }
+            mask[y * width + x] = inside;
+        }
+    return mask;
+}
+
+Polygon make_polygon(const std::vector<float>& xs, const std::vector<float>& ys)
+{
+    Polygon polygon(xs[0], ys[0]);
+    polygon.update(xs[1], ys[1]);
+    for (std::size_t i = 2; i < xs.size(); ++i)
+        polygon.add_control_point(xs[i], ys[i]);
+    return polygon;
+}
+
+void test_region()
+{
+    const int width = 50, height = 40;
+    std::mt19937 random(1);
+    for (int round = 0; round < 100; ++round)
+    {
+        // Overlapping, touching and clipped spans in any order
+        std::vector<Region::Span> spans;
+        for (int i = 0; i < 60; ++i)
+        {
+            Region::Span span;
+            span.y = static_cast<int>(random() % (height + 10)) - 5;
+            span.x0 = static_cast<int>(random() % (width + 10)) - 5;
+            span.x1 = span.x0 + static_cast<int>(random() % 20);
+            spans.push_back(span);
+        }
+        const Region region(spans, width, height);
+        const std::vector<bool> expected = rasterize(spans, width, height);
+        const int count = static_cast<int>(
+            std::count(expected.begin(), expected.end(), true));
+        CHECK(region.size() == count);
+        CHECK(region.empty() == (count == 0));
+
+        // Sorted, disjoint and not adjacent
+        const std::vector<Region::Span>& merged = region.spans();
+        for (std::size_t s = 1; s < merged.size(); ++s)
+            CHECK(
+                merged[s - 1].y < merged[s].y ||
+                (merged[s - 1].y == merged[s].y &&
+                 merged[s - 1].x1 < merged[s].x0));
+        CHECK(rasterize(merged, width, height) == expected);
+
+        // index() numbers the pixels row by row, pixel() inverts it
+        int k = 0;
+        for (int y = 0; y < height; ++y)
+            for (int x = 0; x < width; ++x)
+            {
+                const int index = region.index(x, y);
+                if (!expected[y * width + x])
+                {
+                    CHECK(index == -1);
+                    continue;
+                }
+                CHECK(index == k);
+                CHECK(region.pixel(k) == std::make_pair(x, y));
+                ++k;
+            }
+        CHECK(region.index(-1, 0) == -1 && region.index(0, height) == -1);
+
+        if (!region.empty())
+        {
+            const Region::Box& box = region.bounds();
+            for (int y = 0; y < height; ++y)
+                for (int x = 0; x < width; ++x)
+                    if (expected[y * width + x])
+                        CHECK(
+                            box.x0 <= x && x < box.x1 && box.y0 <= y &&
+                            y < box.y1);
+        }
+
+        Image mask(width, height, 1);
+        std::fill(mask.data(), mask.data() + mask.size(), 0);
+        region.fill(mask, 255);
+        bool filled = true;
+        for (int i = 0; i < width * height; ++i)
+            filled = filled && (mask.data()[i] == 255) == expected[i];
+        CHECK(filled);
+    }
+}
+
+void test_polygon_fill()
+{
+    const int width = 64, height = 48;
+    // An axis-aligned square covers the pixels whose center is inside
+    {
+        const Polygon square = make_polygon({ 2, 12, 12, 2 }, { 3, 3, 13, 13 });
+        const Region region(square.get_interior_spans(), width, height);
+        CHECK(region.size() == 100);
+        CHECK(region.index(2, 3) == 0 && region.index(11, 12) == 99);
+    }
+    // Random polygons, self-intersecting ones included, against a test of
+    // every pixel center
+    std::mt19937 random(2);
+    std::uniform_real_distribution<float> x_coordinate(-5.0f, width + 5.0f);
+    std::uniform_real_distribution<float> y_coordinate(-5.0f, height + 5.0f);
+    for (int round = 0; round < 200; ++round)
+    {
+        const int n = 3 + static_cast<int>(random() % 10);
+        std::vector<float> xs(n), ys(n);
+        for (int i = 0; i < n; ++i)
+        {
+            xs[i] = x_coordinate(random);
+            ys[i] = y_coordinate(random);
+        }
+        const Polygon polygon = make_polygon(xs, ys);
+        CHECK(
+            rasterize(polygon.get_interior_spans(), width, height) ==
+            inside_polygon(xs, ys, width, height));
+    }
+    // Fewer than three vertices have no interior
+    CHECK(make_polygon({ 1, 9 }, { 1, 9 }).get_interior_spans().empty());
+}
+
+Image smooth_image(int width, int height, float phase)
+{
+    Image image(width, height, 4);
+    for (int y = 0; y < height; ++y)
+        for (int x = 0; x < width; ++x)
+        {
+            for (int c = 0; c < 3; ++c)
+                image.at_unchecked(x, y, c) = static_cast<unsigned char>(
+                    127.5 +
+                    120.0 * std::sin(0.07 * x * (c + 1) + 0.05 * y + phase));
+            image.at_unchecked(x, y, 3) = 255;
+        }
+    return image;
+}
+
+int max_difference(const Image& a, const Image& b)
+{
+    int difference = 0;
+    for (std::size_t i = 0; i < a.size(); ++i)
+        difference =
+            std::max(difference, std::abs(int(a.data()[i]) - b.data()[i]));
+    return difference;
+}
+
+void test_seamless_cloner()
+{
+    const int width = 160, height = 120;
+    const Image source = smooth_image(width, height, 0.0f);
+    const Image target = smooth_image(width, height, 1.5f);
+    const Polygon polygon =
+        make_polygon({ 20, 90, 110, 60, 15 }, { 10, 15, 70, 95, 60 });
+    const Region region(polygon.get_interior_spans(), width, height);
+    CHECK(!region.empty());
+
+    // The target cloned into itself stays as it is
+    {
+        SeamlessCloner cloner;
+        CHECK(cloner.set_region(region));
+        cloner.set_source(target);
+        CHECK(cloner.ready());
+        Image result = target;
+        cloner.clone(result, 0, 0);
+        CHECK(max_difference(result, target) <= 1);
+    }
+
+    // Both backends solve the same system, for every guidance field
+    for (SeamlessCloner::Guidance guidance :
+         { SeamlessCloner::kImport,
+           SeamlessCloner::kMixed,
+           SeamlessCloner::kFlatten,
+           SeamlessCloner::kIllumination })
+        for (int offset : { 0, 17 })
+        {
+            Image results[2] = { target, target };
+            for (SeamlessCloner::Solver solver :
+                 { SeamlessCloner::kDirect, SeamlessCloner::kMultigrid })
+            {
+                SeamlessCloner cloner;
+                cloner.set_solver(solver);
+                cloner.set_guidance(guidance);
+                CHECK(cloner.set_region(region));
+                cloner.set_source(source);
+                cloner.clone(results[solver], offset, offset / 2);
+            }
+            CHECK(max_difference(results[0], results[1]) <= 2);
+            // Only the pixels of the region move
+            for (int y = 0; y < height; ++y)
+                for (int x = 0; x < width; ++x)
+                    if (region.index(x - offset, y - offset / 2) < 0)
+                        CHECK(
+                            results[0].at_unchecked(x, y, 0) ==
+                            target.at_unchecked(x, y, 0));
+        }
+
+    // An empty region is refused
+    SeamlessCloner cloner;
+    CHECK(!cloner.set_region(Region()));
+    CHECK(!cloner.ready());
+}
+}  // namespace
+
+int main()
+{
+    test::run("Region", test_region);
+    test::run("Polygon scanline fill", test_polygon_fill);
+    test::run("SeamlessCloner direct and multigrid", test_seamless_cloner);
+    return test::report();
+}
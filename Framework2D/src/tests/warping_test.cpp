@@ -0,0 +1,159 @@
+// Tests of the incremental factorization behind the RBF warper.
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "check.h"
+#include "warper/incremental_ldlt.h"
+
+using namespace USTC_CG;
+
+namespace
+{
+// Residual of A X = B relative to B
+double residual(
+    const Eigen::MatrixXd& a,
+    const Eigen::MatrixXd& x,
+    const Eigen::MatrixXd& b)
+{
+    return (a * x - b).norm() / b.norm();
+}
+
+// Factor `a` by appending its columns, one at a time
+bool append_all(IncrementalLDLT& ldlt, const Eigen::MatrixXd& a)
+{
+    for (int n = 0; n < a.rows(); ++n)
+        if (!ldlt.append(a.col(n).head(n + 1)))
+            return false;
+    return true;
+}
+
+// Multiquadric RBF matrix at random distinct centers: symmetric, indefinite
+Eigen::MatrixXd multiquadric_matrix(int n, unsigned seed)
+{
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<double> coordinate(0.0, 100.0);
+    std::vector<Eigen::Vector2d> centers(n);
+    for (Eigen::Vector2d& c : centers)
+        c = { coordinate(random), coordinate(random) };
+    Eigen::MatrixXd a(n, n);
+    for (int i = 0; i < n; ++i)
+        for (int j = 0; j < n; ++j)
+            a(i, j) =
+                std::sqrt((centers[i] - centers[j]).squaredNorm() + 25.0);
+    return a;
+}
+
+Eigen::MatrixXd without(const Eigen::MatrixXd& a, int k)
+{
+    const int n = static_cast<int>(a.rows());
+    Eigen::MatrixXd b(n - 1, n - 1);
+    for (int i = 0, bi = 0; i < n; ++i)
+    {
+        if (i == k)
+            continue;
+        for (int j = 0, bj = 0; j < n; ++j)
+            if (j != k)
+                b(bi, bj++) = a(i, j);
+        ++bi;
+    }
+    return b;
+}
+
+void test_append_solve()
+{
+    // Positive definite, and indefinite
+    const Eigen::MatrixXd m = Eigen::MatrixXd::Random(40, 40);
+    const Eigen::MatrixXd spd =
+        m * m.transpose() + 40.0 * Eigen::MatrixXd::Identity(40, 40);
+    for (const Eigen::MatrixXd& a : { spd, multiquadric_matrix(60, 2) })
+    {
+        IncrementalLDLT ldlt;
+        CHECK(append_all(ldlt, a));
+        CHECK(ldlt.size() == a.rows());
+        const Eigen::MatrixXd b = Eigen::MatrixXd::Random(a.rows(), 2);
+        Eigen::MatrixXd x = b;
+        ldlt.solve_in_place(x);
+        CHECK(residual(a, x, b) < 1e-9);
+    }
+}
+
+void test_singular()
+{
+    // Two equal centers make the bordered matrix singular: the column is
+    // refused and the factorization kept
+    Eigen::MatrixXd a = multiquadric_matrix(10, 3);
+    a.row(9) = a.row(3);
+    a.col(9) = a.col(3);
+    IncrementalLDLT ldlt;
+    for (int n = 0; n < 9; ++n)
+        CHECK(ldlt.append(a.col(n).head(n + 1)));
+    CHECK(!ldlt.append(a.col(9)));
+    CHECK(ldlt.size() == 9);
+    const Eigen::MatrixXd head = a.topLeftCorner(9, 9);
+    const Eigen::MatrixXd b = Eigen::MatrixXd::Random(9, 1);
+    Eigen::MatrixXd x = b;
+    ldlt.solve_in_place(x);
+    CHECK(residual(head, x, b) < 1e-9);
+}
+
+void test_remove()
+{
+    // Remove rows in random places, appending new ones in between: the
+    // factorization always solves the current matrix
+    const int total = 80;
+    const Eigen::MatrixXd all = multiquadric_matrix(total, 4);
+    std::vector<int> kept;
+    IncrementalLDLT ldlt;
+    std::mt19937 random(5);
+    for (int next = 0; next < total; ++next)
+    {
+        Eigen::VectorXd column(kept.size() + 1);
+        for (std::size_t i = 0; i < kept.size(); ++i)
+            column(i) = all(kept[i], next);
+        column(kept.size()) = all(next, next);
+        CHECK(ldlt.append(column));
+        kept.push_back(next);
+
+        if (next % 3 == 2)
+        {
+            const int k = static_cast<int>(random() % kept.size());
+            ldlt.remove(k);
+            kept.erase(kept.begin() + k);
+        }
+
+        const int n = static_cast<int>(kept.size());
+        CHECK(ldlt.size() == n);
+        Eigen::MatrixXd a(n, n);
+        for (int i = 0; i < n; ++i)
+            for (int j = 0; j < n; ++j)
+                a(i, j) = all(kept[i], kept[j]);
+        const Eigen::MatrixXd b = Eigen::MatrixXd::Random(n, 2);
+        Eigen::MatrixXd x = b;
+        ldlt.solve_in_place(x);
+        CHECK(residual(a, x, b) < 1e-8);
+    }
+
+    // Removing the first and the last
+    const Eigen::MatrixXd a = multiquadric_matrix(20, 6);
+    for (int k : { 0, 19 })
+    {
+        IncrementalLDLT ldlt;
+        CHECK(append_all(ldlt, a));
+        ldlt.remove(k);
+        const Eigen::MatrixXd reduced = without(a, k);
+        const Eigen::MatrixXd b = Eigen::MatrixXd::Random(19, 1);
+        Eigen::MatrixXd x = b;
+        ldlt.solve_in_place(x);
+        CHECK(residual(reduced, x, b) < 1e-9);
+    }
+}
+}  // namespace
+
+int main()
+{
+    test::run("IncrementalLDLT append and solve", test_append_solve);
+    test::run("IncrementalLDLT singular column", test_singular);
+    test::run("IncrementalLDLT remove", test_remove);
+    return test::report();
+}